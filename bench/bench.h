@@ -0,0 +1,261 @@
+#pragma once
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../src/chunk_size.h"
+
+/* a small timing harness shared by the benchmarks in bench/. each benchmark
+ * is a program of its own, so it is all in this header.
+ *
+ *     int main(int argc, char **argv)
+ *     {
+ *         bench_init(argc, argv);
+ *         bench("get_block", LOOKUPS, [&] { ... });
+ *         return bench_finish();
+ *     }
+ *
+ * bench() runs its body once to warm up, then once per sample, and reports
+ * the time per op. the median and the median absolute deviation are what to
+ * compare between runs; a sample which got descheduled moves the mean, but
+ * barely touches either of those.
+ *
+ * flags:
+ *     --json           print the results as json at the end, and nothing else
+ *     --samples n      timed runs of each body (default 10)
+ *     --filter s       only run the benchmarks with s in their name
+ */
+
+typedef std::chrono::high_resolution_clock bench_clock;
+
+struct bench_result {
+    std::string name;
+    unsigned ops;               /* per sample */
+    unsigned samples;
+    double min_ns;              /* per op, for this and the rest */
+    double median_ns;
+    double mean_ns;
+    double mad_ns;
+};
+
+struct bench_value {
+    std::string name;
+    double value;
+    std::string unit;
+};
+
+struct bench_state {
+    char const *program = "bench";
+    unsigned samples = 10;
+    char const *filter = nullptr;
+    bool json = false;
+
+    std::vector<bench_result> results;
+    std::vector<bench_value> values;
+};
+
+static bench_state bench_g;
+
+/* for results which would otherwise be thrown away, so the compiler can't
+ * throw away the work which made them too */
+static volatile unsigned bench_sink;
+
+
+static double
+bench_ms_since(bench_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+}
+
+
+static void
+bench_usage(void)
+{
+    fprintf(stderr, "usage: %s [--json] [--samples n] [--filter s]\n", bench_g.program);
+    exit(1);
+}
+
+
+static void
+bench_init(int argc, char **argv)
+{
+    char const *slash = strrchr(argv[0], '/');
+    bench_g.program = slash ? slash + 1 : argv[0];
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--json")) {
+            bench_g.json = true;
+        }
+        else if (!strcmp(argv[i], "--samples") && i + 1 < argc) {
+            bench_g.samples = (unsigned)atoi(argv[++i]);
+            if (!bench_g.samples)
+                bench_usage();
+        }
+        else if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+            bench_g.filter = argv[++i];
+        }
+        else {
+            bench_usage();
+        }
+    }
+
+    if (!bench_g.json) {
+        printf("%s: chunk size %d, %u samples\n\n", bench_g.program, CHUNK_SIZE, bench_g.samples);
+        printf("%-36s %12s %12s %12s %8s\n", "benchmark", "median", "min", "mean", "mad");
+    }
+}
+
+
+/* whether the benchmark called name is to be run */
+static bool
+bench_selected(char const *name)
+{
+    return !bench_g.filter || strstr(name, bench_g.filter);
+}
+
+
+/* ns with a unit which keeps it readable */
+static void
+bench_print_time(double ns)
+{
+    if (ns < 1e3)
+        printf(" %9.2f ns", ns);
+    else if (ns < 1e6)
+        printf(" %9.2f us", ns / 1e3);
+    else
+        printf(" %9.2f ms", ns / 1e6);
+}
+
+
+static void
+bench_record(char const *name, unsigned ops, std::vector<double> ns)
+{
+    std::sort(ns.begin(), ns.end());
+
+    bench_result r;
+    r.name = name;
+    r.ops = ops;
+    r.samples = (unsigned)ns.size();
+    r.min_ns = ns.front();
+    r.median_ns = ns[ns.size() / 2];
+
+    double sum = 0;
+    for (auto s : ns)
+        sum += s;
+    r.mean_ns = sum / ns.size();
+
+    std::vector<double> dev;
+    for (auto s : ns)
+        dev.push_back(fabs(s - r.median_ns));
+    std::sort(dev.begin(), dev.end());
+    r.mad_ns = dev[dev.size() / 2];
+
+    bench_g.results.push_back(r);
+
+    if (!bench_g.json) {
+        printf("%-36s", name);
+        bench_print_time(r.median_ns);
+        bench_print_time(r.min_ns);
+        bench_print_time(r.mean_ns);
+        printf(" %7.1f%%\n", r.median_ns > 0 ? 100.0 * r.mad_ns / r.median_ns : 0.0);
+    }
+}
+
+
+/* times body, which does ops of whatever is being measured. reset runs
+ * before each sample, untimed, for bodies which use up their setup. */
+template <class F, class R>
+void
+bench(char const *name, unsigned ops, F body, R reset)
+{
+    if (!bench_selected(name))
+        return;
+
+    reset();
+    body();
+
+    std::vector<double> ns(bench_g.samples);
+    for (auto & s : ns) {
+        reset();
+        auto start = bench_clock::now();
+        body();
+        s = 1e6 * bench_ms_since(start) / ops;
+    }
+
+    bench_record(name, ops, ns);
+}
+
+
+template <class F>
+void
+bench(char const *name, unsigned ops, F body)
+{
+    bench(name, ops, body, [] {});
+}
+
+
+/* a number which goes with the timings -- a count of chunks, say */
+static void
+bench_report(char const *name, double value, char const *unit)
+{
+    bench_g.values.push_back({ name, value, unit });
+
+    if (!bench_g.json)
+        printf("%-36s %12.0f %s\n", name, value, unit);
+}
+
+
+static void
+bench_json_string(std::string const & s)
+{
+    putchar('"');
+    for (auto c : s) {
+        if (c == '"' || c == '\\')
+            putchar('\\');
+        putchar(c);
+    }
+    putchar('"');
+}
+
+
+/* prints the json, if asked for. returns main's exit status */
+static int
+bench_finish(void)
+{
+    if (!bench_g.json)
+        return 0;
+
+    printf("{\n  \"program\": ");
+    bench_json_string(bench_g.program);
+    printf(",\n  \"chunk_size\": %d,\n  \"samples\": %u,\n  \"results\": [", CHUNK_SIZE, bench_g.samples);
+
+    for (size_t i = 0; i < bench_g.results.size(); i++) {
+        auto const & r = bench_g.results[i];
+        printf("%s\n    { \"name\": ", i ? "," : "");
+        bench_json_string(r.name);
+        printf(", \"ops\": %u, \"samples\": %u, \"min_ns\": %.3f, \"median_ns\": %.3f, "
+               "\"mean_ns\": %.3f, \"mad_ns\": %.3f }",
+               r.ops, r.samples, r.min_ns, r.median_ns, r.mean_ns, r.mad_ns);
+    }
+
+    printf("\n  ],\n  \"values\": [");
+
+    for (size_t i = 0; i < bench_g.values.size(); i++) {
+        auto const & v = bench_g.values[i];
+        printf("%s\n    { \"name\": ", i ? "," : "");
+        bench_json_string(v.name);
+        printf(", \"value\": %.17g, \"unit\": ", v.value);
+        bench_json_string(v.unit);
+        printf(" }");
+    }
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <vector>
+
+#include "../src/common.h"
+#include "../src/mesh.h"
+#include "../src/ship_space.h"
+#include "../src/simulation.h"
+#include "../src/component/component_system_manager.h"
+#include "../src/wiring/wiring.h"
+
+/* generated ships for the benchmarks: a grid of rooms, each walled on every
+ * side with a door through each wall and a grate in the floor, and a power
+ * wire down each row of rooms with a consumer in every room.
+ *
+ * ship_space never frees anything, so neither do these.
+ */
+
+struct bench_ship_params {
+    char const *name;
+    int pitch;                  /* blocks from one room's walls to the next */
+    glm::ivec3 rooms;
+};
+
+/* a pitch of 6 lines up with no chunk size, so every size pays for walls
+ * crossing its chunks */
+static bench_ship_params const bench_ships[] = {
+    { "small",  6, glm::ivec3(4, 4, 2) },
+    { "medium", 6, glm::ivec3(16, 16, 4) },
+    { "large",  6, glm::ivec3(32, 32, 4) },
+};
+
+/* the face from a to a + normal, in the gap of a door */
+struct bench_opening {
+    glm::ivec3 a;
+    glm::ivec3 b;
+    surface_index face;
+};
+
+struct bench_ship {
+    bench_ship_params params;
+    ship_space *ss;
+    glm::ivec3 size;            /* in blocks */
+
+    /* every door, as the faces which close it off from the +x or +y side:
+     * the lower one, then the upper */
+    std::vector<bench_opening> doors;
+
+    std::vector<c_entity> entities;
+};
+
+
+/* loads the meshes the mesher draws with, as sim_init does, but without
+ * the rest of the game. run from the top of the tree */
+static void
+bench_load_meshes(void)
+{
+    scaffold_sw = load_mesh("mesh/initial_scaffold.dae");
+
+    surfs_sw[surface_xp] = load_mesh("mesh/x_quad_p.dae");
+    surfs_sw[surface_xm] = load_mesh("mesh/x_quad.dae");
+    surfs_sw[surface_yp] = load_mesh("mesh/y_quad_p.dae");
+    surfs_sw[surface_ym] = load_mesh("mesh/y_quad.dae");
+    surfs_sw[surface_zp] = load_mesh("mesh/z_quad_p.dae");
+    surfs_sw[surface_zm] = load_mesh("mesh/z_quad.dae");
+
+    mesher_init();
+}
+
+
+static bool
+bench_in_ship(bench_ship const *s, glm::ivec3 p)
+{
+    return p.x >= 0 && p.y >= 0 && p.z >= 0 &&
+           p.x <= s->size.x && p.y <= s->size.y && p.z <= s->size.z;
+}
+
+
+/* a surface on face of p, and the matching one on its neighbour */
+static void
+bench_wall(bench_ship *s, glm::ivec3 p, int face, surface_type st)
+{
+    glm::ivec3 q = p + surface_index_to_normal(face);
+    if (!bench_in_ship(s, q))
+        return;
+
+    s->ss->ensure_block(p)->surfs[face] = st;
+    s->ss->ensure_block(q)->surfs[face ^ 1] = st;
+}
+
+
+/* a wire attachment for e, which is on a wire with prev unless prev is
+ * invalid_attach */
+static unsigned
+bench_attach(bench_ship *s, c_entity e, unsigned prev)
+{
+    auto type = wire_type_power;
+    auto *ss = s->ss;
+
+    auto index = (unsigned)ss->wire_attachments[type].size();
+    wire_attachment wa = { glm::mat4(1), index, 0, true };
+    ss->wire_attachments[type].push_back(wa);
+    ss->entity_to_attach_lookups[type][e].insert(index);
+
+    if (prev != invalid_attach) {
+        wire_segment seg = { prev, index };
+        ss->wire_segments[type].push_back(seg);
+    }
+
+    return index;
+}
+
+
+/* a provider at the start of each row of rooms, and a consumer in each */
+static void
+bench_wire_ship(bench_ship *s)
+{
+    glm::ivec3 rooms = s->params.rooms;
+
+    for (int z = 0; z < rooms.z; z++) {
+        for (int y = 0; y < rooms.y; y++) {
+            c_entity provider = c_entity::spawn();
+            power_provider_man.assign_entity(provider);
+            *power_provider_man.get_instance_data(provider).provided = (float)rooms.x;
+            s->entities.push_back(provider);
+
+            unsigned prev = bench_attach(s, provider, invalid_attach);
+
+            for (int x = 0; x < rooms.x; x++) {
+                c_entity consumer = c_entity::spawn();
+                power_man.assign_entity(consumer);
+                auto d = power_man.get_instance_data(consumer);
+                *d.required_power = 1;
+                *d.max_required_power = 2;
+                s->entities.push_back(consumer);
+
+                prev = bench_attach(s, consumer, prev);
+            }
+        }
+    }
+
+    attach_topo_rebuild(s->ss, wire_type_power);
+    calculate_power_wires(s->ss);
+}
+
+
+/* builds the ship, written straight into the blocks and tidied up after */
+static bench_ship *
+bench_build_ship(bench_ship_params const & params)
+{
+    bench_ship *s = new bench_ship();
+    s->params = params;
+    s->ss = new ship_space();
+    s->size = params.pitch * params.rooms;
+
+    int pitch = params.pitch;
+    int door_x = pitch / 2;
+
+    for (int x = 0; x <= s->size.x; x++) {
+        for (int y = 0; y <= s->size.y; y++) {
+            for (int z = 0; z <= s->size.z; z++) {
+                glm::ivec3 p(x, y, z);
+                glm::ivec3 r(x % pitch, y % pitch, z % pitch);
+                bool door = (r.x == door_x || r.y == door_x) && (r.z == 1 || r.z == 2);
+                if (r.x && r.y && r.z)
+                    continue;
+
+                s->ss->ensure_block(p)->type = block_support;
+
+                if (door) {
+                    /* doors in the outer hull stay shut */
+                    bool x_wall = !r.x && x > 0 && x < s->size.x;
+                    bool y_wall = !r.y && y > 0 && y < s->size.y;
+                    if (x_wall)
+                        s->doors.push_back({ p, p + glm::ivec3(1, 0, 0), surface_xp });
+                    if (y_wall)
+                        s->doors.push_back({ p, p + glm::ivec3(0, 1, 0), surface_yp });
+                    if (x_wall || y_wall)
+                        continue;
+                }
+
+                bool grate = !r.z && r.x >= 2 && r.x < pitch - 1 && r.y >= 2 && r.y < pitch - 1;
+
+                for (int axis = 0; axis < 3; axis++) {
+                    if (r[axis])
+                        continue;
+
+                    surface_type st = axis == 2 && grate ? surface_grate : surface_wall;
+                    bench_wall(s, p, 2 * axis, st);
+                    bench_wall(s, p, 2 * axis + 1, st);
+                }
+            }
+        }
+    }
+
+    for (auto ch : s->ss->chunks) {
+        ch.second->refresh_faces();
+        ch.second->blocks.compact();
+    }
+
+    s->ss->rebuild_topology();
+    bench_wire_ship(s);
+    return s;
+}
+
+
+/* drops s's entities from the component managers, which outlive it */
+static void
+bench_free_ship(bench_ship *s)
+{
+    for (auto e : s->entities) {
+        power_man.destroy_entity_instance(e);
+        power_provider_man.destroy_entity_instance(e);
+    }
+
+    delete s;
+}
+
+
+/* the component managers the generated ships use */
+static void
+bench_init_components(void)
+{
+    power_man.create_component_instance_data(8192);
+    power_provider_man.create_component_instance_data(8192);
+}
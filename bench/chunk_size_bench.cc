@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "bench_ship.h"
+
+/* compares chunk sizes on a ship shaped like ours: rebuild with each of
+ *     cmake -DNIGHTMARE_CHUNK_SIZE={8,16,32} .
+ * and run from the top of the tree, since the mesher wants the game's meshes.
+ *
+ * remesh is the time to build one chunk's render mesh on average -- what
+ * each edit costs -- and every chunk's. draw calls are the chunks with
+ * anything to draw. lookup is a get_block at a random spot in the ship.
+ */
+
+#define LOOKUPS         (4 * 1024 * 1024)
+
+
+int
+main(int argc, char **argv)
+{
+    bench_init(argc, argv);
+    bench_load_meshes();
+    bench_init_components();
+
+    bench_ship *s = bench_build_ship(bench_ships[1]);
+    ship_space *ss = s->ss;
+    unsigned num_chunks = (unsigned)ss->chunks.size();
+
+    static chunk_blocks blocks;
+    std::vector<world_vertex> verts;
+    std::vector<unsigned> indices;
+
+    unsigned draws = 0;
+    size_t num_verts = 0;
+
+    auto remesh = [&] {
+        draws = 0;
+        num_verts = 0;
+
+        for (auto ch : ss->chunks) {
+            verts.clear();
+            indices.clear();
+
+            ch.second->blocks.store(&blocks.contents[0][0][0]);
+            build_render_mesh(&blocks, &verts, &indices);
+
+            if (!indices.empty())
+                draws++;
+            num_verts += verts.size();
+        }
+    };
+
+    bench("remesh", num_chunks, remesh);
+    if (!bench_g.results.empty())
+        bench_report("remesh whole ship", bench_g.results.back().median_ns * num_chunks / 1e6, "ms");
+
+    bench_report("chunks", num_chunks, "chunks");
+    bench_report("draw calls", draws, "draws");
+    bench_report("vertices", (double)num_verts, "vertices");
+
+    std::mt19937 rng(1);
+    std::vector<glm::ivec3> points(LOOKUPS);
+    for (auto & p : points) {
+        p = glm::ivec3(rng() % s->size.x, rng() % s->size.y, rng() % s->size.z);
+    }
+
+    bench("lookup", LOOKUPS, [&] {
+        unsigned found = 0;
+        for (auto const & p : points) {
+            found += ss->get_block(p)->type == block_support;
+        }
+        bench_sink += found;
+    });
+
+    bench_free_ship(s);
+    return bench_finish();
+}
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "bench_ship.h"
+
+/* times the ship_space paths the game leans on, over ships of a few sizes:
+ *
+ *   get_block            a block at a random spot in the ship
+ *   raycast              from a random spot, in a random direction
+ *   rebuild_topology     the whole ship
+ *   add_surface          shutting a door, with update_topology_for_add_surface
+ *   remove_surface       opening one, with update_topology_for_remove_surface
+ *   render_mesh          build_render_mesh, per chunk
+ *   wiring               attach_topo_rebuild and calculate_power_wires
+ *
+ * no window or GL context is needed; run from the top of the tree, since
+ * the mesher wants the game's meshes:
+ *     ./bench_bin/ship_space_bench [--json] [--filter medium/]
+ */
+
+#define LOOKUPS         (1024 * 1024)
+#define RAYS            (256 * 1024)
+
+/* door faces shut and opened per sample, spread across the ship */
+#define DOOR_OPS        256
+
+
+static void
+bench_ship_space(bench_ship_params const & params)
+{
+    char name[64];
+    auto label = [&](char const *what) {
+        snprintf(name, sizeof(name), "%s/%s", params.name, what);
+        return name;
+    };
+
+    auto start = bench_clock::now();
+    bench_ship *s = bench_build_ship(params);
+    ship_space *ss = s->ss;
+
+    bench_report(label("chunks"), (double)ss->chunks.size(), "chunks");
+    bench_report(label("build"), bench_ms_since(start), "ms");
+
+    std::mt19937 rng(1);
+
+    std::vector<glm::ivec3> points(LOOKUPS);
+    for (auto & p : points) {
+        p = glm::ivec3(rng() % s->size.x, rng() % s->size.y, rng() % s->size.z);
+    }
+
+    bench(label("get_block"), LOOKUPS, [&] {
+        unsigned found = 0;
+        for (auto const & p : points) {
+            found += ss->get_block(p)->type == block_support;
+        }
+        bench_sink += found;
+    });
+
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<glm::vec3> origins(RAYS), dirs(RAYS);
+    for (int i = 0; i < RAYS; i++) {
+        origins[i] = glm::vec3(points[i]) + glm::vec3(0.5f);
+        dirs[i] = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(1e-3f));
+    }
+
+    bench(label("raycast"), RAYS, [&] {
+        unsigned hits = 0;
+        raycast_info rc;
+        for (int i = 0; i < RAYS; i++) {
+            ss->raycast(origins[i], dirs[i], &rc);
+            hits += rc.hit;
+        }
+        bench_sink += hits;
+    });
+
+    bench(label("rebuild_topology"), 1, [&] {
+        ss->rebuild_topology();
+    });
+
+    /* doors are two faces high, and come in pairs */
+    std::vector<bench_opening> doors;
+    size_t stride = 2 * std::max<size_t>(1, s->doors.size() / DOOR_OPS);
+    for (size_t i = 0; i + 1 < s->doors.size() && doors.size() < DOOR_OPS; i += stride) {
+        doors.push_back(s->doors[i]);
+        doors.push_back(s->doors[i + 1]);
+    }
+
+    auto set_doors = [&](surface_type st) {
+        for (auto const & d : doors) {
+            ss->set_surface(d.a, d.b, d.face, st);
+        }
+    };
+
+    bench(label("add_surface"), (unsigned)doors.size(),
+          [&] { set_doors(surface_wall); },
+          [&] { set_doors(surface_none); });
+
+    bench(label("remove_surface"), (unsigned)doors.size(),
+          [&] { set_doors(surface_none); },
+          [&] { set_doors(surface_wall); });
+
+    static chunk_blocks blocks;
+    std::vector<world_vertex> verts;
+    std::vector<unsigned> indices;
+
+    bench(label("render_mesh"), (unsigned)ss->chunks.size(), [&] {
+        for (auto ch : ss->chunks) {
+            verts.clear();
+            indices.clear();
+
+            ch.second->blocks.store(&blocks.contents[0][0][0]);
+            build_render_mesh(&blocks, &verts, &indices);
+        }
+        bench_sink += (unsigned)verts.size();
+    });
+
+    bench(label("wiring"), 1, [&] {
+        attach_topo_rebuild(ss, wire_type_power);
+        calculate_power_wires(ss);
+    });
+
+    bench_free_ship(s);
+}
+
+
+/* a filter which names a ship, like medium/, spares building the others */
+static bool
+ship_wanted(char const *name)
+{
+    char const *f = bench_g.filter;
+    if (!f || !strchr(f, '/'))
+        return true;
+
+    size_t n = strlen(name);
+    return !strncmp(f, name, n) && f[n] == '/';
+}
+
+
+int
+main(int argc, char **argv)
+{
+    bench_init(argc, argv);
+    bench_load_meshes();
+    bench_init_components();
+
+    for (auto const & params : bench_ships) {
+        if (ship_wanted(params.name))
+            bench_ship_space(params);
+    }
+
+    return bench_finish();
+}
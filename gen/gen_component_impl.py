@@ -108,8 +108,8 @@ impl_template_8="""    instance_pool.%(name)s[i.index] = instance_pool.%(name)s[
 """
 
 impl_template_9="""
-    entity_instance_map[last_entity] = i.index;
-    entity_instance_map.erase(current_entity);
+    set_instance(last_entity, i.index);
+    clear_instance(current_entity);
 
     --buffer.num;
 }
@@ -0,0 +1,208 @@
+#ifndef _WIN32
+#include <err.h> /* errx */
+#else
+#include "src/winerr.h"
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "src/common.h"
+#include "src/component/component_system_manager.h"
+#include "src/light_prop.h"
+#include "src/particle.h"
+#include "src/physics.h"
+#include "src/profiler.h"
+#include "src/ship_space.h"
+#include "src/simulation.h"
+#include "src/worker_pool.h"
+
+/* runs the game's simulation with no window and no GL context, as fast as
+ * it will go: for soak tests, throughput numbers, and CI on machines
+ * without a GPU.
+ *
+ *     ./nightmare_headless [--ship ship.en] [--seconds n] [--seed n] [--trace file]
+ *
+ * the world steps through fixed 60Hz frames, and the physics meshes are
+ * built one at a time in order, so a given ship, seed and length always
+ * ends up the same; the digest printed at the end is there to check that.
+ * nobody is at the controls -- the player stands where they start.
+ *
+ * --trace writes the frame profiler's last frames out when it finishes, for
+ * chrome://tracing.
+ */
+
+#define DEFAULT_SHIP        "ship.en"
+#define DEFAULT_SECONDS     60
+#define FRAME_DT            (1/60.0f)
+
+typedef std::chrono::high_resolution_clock headless_clock;
+
+
+static double
+seconds_since(headless_clock::time_point start)
+{
+    return std::chrono::duration<double>(headless_clock::now() - start).count();
+}
+
+
+/* builds physics for any chunk which has changed, and waits for it. with
+ * one worker, the bodies go into the world in the same order every run. */
+static void
+prepare_phys_chunks()
+{
+    for (auto const & c : ship->chunk_coords) {
+        chunk *ch = ship->get_chunk(c);
+        ch->prepare_phys(workers, c.x, c.y, c.z);
+    }
+
+    workers->wait();
+}
+
+
+/* FNV-1a, over whatever the simulation has done to the world */
+struct digest {
+    uint64_t h = 14695981039346656037ull;
+
+    void add(void const *p, size_t n)
+    {
+        auto *b = (unsigned char const *)p;
+        for (size_t i = 0; i < n; i++) {
+            h = (h ^ b[i]) * 1099511628211ull;
+        }
+    }
+
+    template <class T>
+    void add(T const *p, unsigned n)
+    {
+        add((void const *)p, n * sizeof(T));
+    }
+};
+
+
+static uint64_t
+world_digest()
+{
+    digest d;
+
+    d.add(power_man.instance_pool.powered, power_man.buffer.num);
+    d.add(door_man.instance_pool.pos, door_man.buffer.num);
+    d.add(pressure_man.instance_pool.pressure, pressure_man.buffer.num);
+    d.add(light_man.instance_pool.intensity, light_man.buffer.num);
+    d.add(particle_man->particle_pool.position, particle_man->buffer.num);
+    d.add(proj_man.projectile_pool.position, proj_man.buffer.num);
+    d.add(&pl.pos, 1);
+
+    return d.h;
+}
+
+
+static void
+usage(char const *name)
+{
+    fprintf(stderr, "usage: %s [--ship file] [--seconds n] [--seed n] [--trace file]\n", name);
+    exit(1);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    char const *ship_file = DEFAULT_SHIP;
+    float seconds = DEFAULT_SECONDS;
+    unsigned seed = 1;
+    char const *trace_file = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--ship") && i + 1 < argc)
+            ship_file = argv[++i];
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc)
+            seconds = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+            seed = (unsigned)strtoul(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+            trace_file = argv[++i];
+        else
+            usage(argv[0]);
+    }
+
+    /* the gas producers' particles are the only randomness */
+    srand(seed);
+
+    auto start = headless_clock::now();
+
+    sim_init(1);
+    sim_load_ship(ship_file);
+
+    /* the light lives on the CPU alone; there is no GPU to send it to */
+    light_prop = new light_propagator(new light_grid(ship));
+
+    prepare_phys_chunks();
+
+    printf("Ship is %d..%d %d..%d %d..%d, %zu chunks; loaded in %.2fs\n",
+            ship->mins.x, ship->maxs.x,
+            ship->mins.y, ship->maxs.y,
+            ship->mins.z, ship->maxs.z,
+            ship->chunk_coords.size(),
+            seconds_since(start));
+
+    unsigned frames = (unsigned)(seconds / FRAME_DT + 0.5f);
+    unsigned main_ticks = 0, fast_ticks = 0;
+    double main_time = 0, fast_time = 0, phys_time = 0;
+
+    start = headless_clock::now();
+
+    for (unsigned f = 0; f < frames; f++) {
+        PROFILE_FRAME();
+
+        main_tick_accum.add(FRAME_DT);
+        fast_tick_accum.add(FRAME_DT);
+
+        auto t = headless_clock::now();
+        while (main_tick_accum.tick()) {
+            sim_main_tick();
+            main_ticks++;
+        }
+        main_time += seconds_since(t);
+
+        t = headless_clock::now();
+        phy->tick_controller(FRAME_DT);
+        while (fast_tick_accum.tick()) {
+            sim_fast_tick();
+            fast_ticks++;
+        }
+        fast_time += seconds_since(t);
+
+        /* doors opening and closing change the chunks' physics */
+        t = headless_clock::now();
+        {
+            PROFILE_SCOPE("prepare_phys_chunks");
+            prepare_phys_chunks();
+        }
+        phys_time += seconds_since(t);
+    }
+
+    PROFILE_FRAME();
+
+    double wall = seconds_since(start);
+
+    printf("Simulated %.1fs in %.2fs: %.0f frames/s, %.1fx real time\n",
+            frames * FRAME_DT, wall, frames / wall, frames * FRAME_DT / wall);
+    printf("  main ticks: %u, %.3f ms each\n", main_ticks,
+            main_ticks ? 1000 * main_time / main_ticks : 0.0);
+    printf("  fast ticks: %u, %.3f ms each\n", fast_ticks,
+            fast_ticks ? 1000 * fast_time / fast_ticks : 0.0);
+    printf("  chunk physics: %.3f ms per frame\n", frames ? 1000 * phys_time / frames : 0.0);
+    printf("Digest: %016llx\n", (unsigned long long)world_digest());
+
+    if (trace_file) {
+        if (!prof.dump_trace(trace_file))
+            errx(1, "failed to write %s", trace_file);
+        printf("Wrote the last %u frames to %s\n", prof.num_frames, trace_file);
+    }
+
+    return 0;
+}
@@ -17,20 +17,26 @@
 #include "src/config.h"
 #include "src/input.h"
 #include "src/light_field.h"
+#include "src/light_prop.h"
 #include "src/mesh.h"
+#include "src/mesh_arena.h"
 #include "src/physics.h"
 #include "src/player.h"
+#include "src/profiler.h"
 #include "src/projectile/projectile.h"
 #include "src/particle.h"
 #include "src/render_data.h"
 #include "src/scopetimer.h"
 #include "src/shader.h"
 #include "src/ship_space.h"
+#include "src/simulation.h"
 #include "src/text.h"
 #include "src/textureset.h"
+#include "src/visibility.h"
 #include "src/tools/tools.h"
 #include "src/wiring/wiring.h"
 #include "src/wiring/wiring_data.h"
+#include "src/worker_pool.h"
 
 
 #define APP_NAME        "Engineer's Nightmare"
@@ -44,13 +50,19 @@
 #define MOUSE_Y_LIMIT      1.54f
 #define MAX_AXIS_PER_EVENT 128
 
-#define INITIAL_MAX_COMPONENTS 20
+/* starting size of the chunk mesh arena; it grows if a ship needs more */
+#define INITIAL_CHUNK_ARENA_VERTICES (64u * 1024)
+#define INITIAL_CHUNK_ARENA_INDICES  (96u * 1024)
+
+#define SHIP_FILENAME "ship.en"
+#define PROFILE_FILENAME "profile.json"
 
 bool exit_requested = false;
 
 bool draw_hud = true;
 bool draw_debug_text = false;
 bool draw_fps = false;
+bool draw_profiler = false;
 
 auto hfov = DEG2RAD(90.f);
 
@@ -114,16 +126,16 @@ gl_debug_callback(GLenum source __unused,
 
 frame_data *frames, *frame;
 unsigned frame_index;
+gpu_timer_stats gpu_stats;
 
-sw_mesh *scaffold_sw;
-sw_mesh *surfs_sw[6];
 GLuint simple_shader, unlit_shader, add_overlay_shader, remove_overlay_shader, ui_shader, ui_sprites_shader;
 GLuint sky_shader, unlit_instanced_shader, lit_instanced_shader, particle_shader, modelspace_uv_shader;
+GLuint chunk_shader;
 texture_set *world_textures;
 texture_set *skybox;
-ship_space *ship;
-player pl;
-physics *phy;
+mesh_arena *chunk_arena;
+frustum view_frustum;
+chunk_visibility visibility;
 unsigned char const *keys;
 unsigned int mouse_buttons[input_mouse_buttons_count];
 int mouse_axes[input_mouse_axes_count];
@@ -134,7 +146,6 @@ sprite_renderer *ui_sprites;
 light_field *light;
 
 sw_mesh *door_sw;
-hw_mesh *door_hw;
 
 extern hw_mesh *projectile_hw;
 extern sw_mesh *projectile_sw;
@@ -149,257 +160,6 @@ extern hw_mesh *wire_hw_meshes[num_wire_types];
 
 sprite_metrics unlit_ui_slot_sprite, lit_ui_slot_sprite;
 
-projectile_linear_manager proj_man;
-particle_manager *particle_man;
-
-glm::mat4
-mat_block_face(glm::ivec3 p, int face)
-{
-    auto norm = glm::vec3(surface_index_to_normal(face));
-    auto pos = glm::vec3(p) + glm::vec3(0.5f) + 0.5f * norm;
-    return mat_rotate_mesh(pos, -norm);
-}
-
-
-struct entity_type
-{
-    /* static */
-    char const *name;
-    char const *mesh;
-    int material;
-    bool placed_on_surface;
-    int height;
-
-    /* loader loop does these */
-    sw_mesh *sw;
-    hw_mesh *hw;
-    btTriangleMesh *phys_mesh;
-    btCollisionShape *phys_shape;
-};
-
-
-entity_type entity_types[] = {
-    { "Door", "mesh/single_door_frame.dae", 2, false, 2 },
-    { "Frobnicator", "mesh/frobnicator.dae", 3, false, 1 },
-    { "Light", "mesh/panel_4x4.dae", 8, true, 1 },
-    { "Warning Light", "mesh/warning_light.dae", 8, true, 1 },
-    { "Display Panel", "mesh/panel_4x4.dae", 7, true, 1 },
-    { "Switch", "mesh/panel_1x1.dae", 9, true, 1 },
-    { "Plaidnicator", "mesh/frobnicator.dae", 13, false, 1 },
-    { "Pressure Sensor 1", "mesh/panel_1x1.dae", 12, true, 1 },
-    { "Pressure Sensor 2", "mesh/panel_1x1.dae", 14, true, 1 },
-    { "Sensor Comparator", "mesh/panel_1x1.dae", 13, true, 1 },
-    { "Proximity Sensor", "mesh/panel_1x1.dae", 3, true, 1 },
-    { "Flashlight", "mesh/no_place.dae", 3, true, 1 },
-};
-
-
-c_entity spawn_entity(glm::ivec3 p, unsigned type, int face) {
-    auto ce = c_entity::spawn();
-
-    auto mat = mat_block_face(p, face);
-
-    auto et = &entity_types[type];
-
-    type_man.assign_entity(ce);
-    auto type_comp = type_man.get_instance_data(ce);
-    *type_comp.type = type;
-
-    physics_man.assign_entity(ce);
-    auto physics = physics_man.get_instance_data(ce);
-    *physics.rigid = nullptr;
-    build_static_physics_rb_mat(&mat, et->phys_shape, physics.rigid);
-
-    /* so that we can get back to the entity from a phys raycast */
-    /* TODO: these should really come from a dense pool rather than the generic allocator */
-    auto per = new phys_ent_ref;
-    per->ce = ce;
-    (*physics.rigid)->setUserPointer(per);
-
-    surface_man.assign_entity(ce);
-    auto surface = surface_man.get_instance_data(ce);
-    *surface.block = p;
-    *surface.face = face;
-
-    pos_man.assign_entity(ce);
-    auto pos = pos_man.get_instance_data(ce);
-    *pos.position = p;
-    *pos.mat = mat;
-
-    /* hack to not render a mesh for the flashlight */
-    /* todo: handle entities that don't need to be rendered*/
-    if (type != 11) {
-        render_man.assign_entity(ce);
-        auto render = render_man.get_instance_data(ce);
-        *render.mesh = et->hw;
-    }
-
-    // door
-    if (type == 0) {
-        power_man.assign_entity(ce);
-        auto power = power_man.get_instance_data(ce);
-        *power.powered = false;
-        *power.required_power = 8;
-        *power.max_required_power = 8;
-
-        door_man.assign_entity(ce);
-        auto door = door_man.get_instance_data(ce);
-        *door.mesh = door_hw;
-        *door.pos = 1.0f;
-        *door.desired_pos = 1.0f;
-        *door.height = et->height;
-
-        reader_man.assign_entity(ce);
-        auto reader = reader_man.get_instance_data(ce);
-        *reader.name = "desired state";
-        reader.source->id = 0;
-        *reader.desc = nullptr;
-        *reader.data = 1.0f;
-    }
-    // frobnicator
-    else if (type == 1) {
-        power_man.assign_entity(ce);
-        auto power = power_man.get_instance_data(ce);
-        *power.powered = false;
-        *power.required_power = 12;
-        *power.max_required_power = 12;
-
-        gas_man.assign_entity(ce);
-        auto gas = gas_man.get_instance_data(ce);
-        *gas.flow_rate = 0.1f;
-        *gas.max_pressure = 1.0f;
-        *gas.enabled = true;
-    }
-    // light
-    else if (type == 2) {
-        power_man.assign_entity(ce);
-        auto power = power_man.get_instance_data(ce);
-        *power.powered = false;
-        *power.required_power = 6;
-        *power.max_required_power = 6;
-
-        light_man.assign_entity(ce);
-        auto light = light_man.get_instance_data(ce);
-        *light.intensity = 1.0f;
-        *light.requested_intensity = 1.0f;
-
-        reader_man.assign_entity(ce);
-        auto reader = reader_man.get_instance_data(ce);
-        *reader.name = "light brightness";
-        reader.source->id = 0;
-        *reader.desc = nullptr;
-        *reader.data = 1.0f;
-    }
-    // warning light
-    else if (type == 3) {
-        power_man.assign_entity(ce);
-        auto power = power_man.get_instance_data(ce);
-        *power.powered = false;
-        *power.required_power = 6;
-        *power.max_required_power = 6;
-
-        light_man.assign_entity(ce);
-        auto light = light_man.get_instance_data(ce);
-        *light.intensity = 1.0f;
-        *light.requested_intensity = 1.0f;
-
-        reader_man.assign_entity(ce);
-        auto reader = reader_man.get_instance_data(ce);
-        *reader.name = "light brightness";
-        reader.source->id = 0;
-        *reader.desc = comms_msg_type_sensor_comparison_state;      // temp until we have discriminator tool
-        *reader.data = 1.0f;
-    }
-    // display panel
-    else if (type == 4) {
-        power_man.assign_entity(ce);
-        auto power = power_man.get_instance_data(ce);
-        *power.powered = false;
-        *power.required_power = 4;
-        *power.max_required_power = 4;
-
-        light_man.assign_entity(ce);
-        auto light = light_man.get_instance_data(ce);
-        *light.intensity = 0.15f;
-        *light.requested_intensity = 0.15f;
-
-        reader_man.assign_entity(ce);
-        auto reader = reader_man.get_instance_data(ce);
-        *reader.name = "light brightness";
-        reader.source->id = 0;
-        *reader.desc = nullptr;
-        *reader.data = 0.15f;
-    }
-    // switch
-    else if (type == 5) {
-        switch_man.assign_entity(ce);
-        auto sw = switch_man.get_instance_data(ce);
-        *sw.enabled = true;
-    }
-    // plaidnicator
-    else if (type == 6) {
-        power_provider_man.assign_entity(ce);
-        auto power_provider = power_provider_man.get_instance_data(ce);
-        *power_provider.max_provided = 12;
-        *power_provider.provided = 12;
-    }
-    // pressure sensor 1
-    else if (type == 7) {
-        pressure_man.assign_entity(ce);
-        auto pressure = pressure_man.get_instance_data(ce);
-        *pressure.pressure = 0.0f;
-        *pressure.type = 1;
-    }
-    // pressure sensor 2
-    else if (type == 8) {
-        pressure_man.assign_entity(ce);
-        auto pressure = pressure_man.get_instance_data(ce);
-        *pressure.pressure = 0.0f;
-        *pressure.type = 2;
-    }
-    // sensor comparator
-    else if (type == 9) {
-        comparator_man.assign_entity(ce);
-        auto comparator = comparator_man.get_instance_data(ce);
-        *comparator.compare_epsilon = 0.0001f;
-    }
-    // proximity sensor
-    else if (type == 10) {
-        power_man.assign_entity(ce);
-        auto power = power_man.get_instance_data(ce);
-        *power.powered = false;
-        *power.required_power = 1;
-        *power.max_required_power = 1;
-
-        proximity_man.assign_entity(ce);
-        auto proximity_sensor = proximity_man.get_instance_data(ce);
-        *proximity_sensor.range = 5;
-        *proximity_sensor.is_detected = false;
-    }
-    // flashlight
-    else if (type == 11) {
-        power_man.assign_entity(ce);
-        auto power = power_man.get_instance_data(ce);
-        *power.powered = false; /* Flashlight starts off */
-        *power.required_power = 0;
-        *power.max_required_power = 0;
-
-        light_man.assign_entity(ce);
-        auto light = light_man.get_instance_data(ce);
-        *light.intensity = 0.75f;
-        *light.requested_intensity = 0.75f;
-
-        reader_man.assign_entity(ce);
-        auto reader = reader_man.get_instance_data(ce);
-        *reader.name = "flashlight brightness";
-        reader.source->id = 0;
-        *reader.desc = nullptr;
-        *reader.data = 0.75f;
-    }
-
-    return ce;
-}
-
 
 void
 use_action_on_entity(ship_space *ship, c_entity ce) {
@@ -443,123 +203,34 @@ place_entity_attaches(raycast_info* rc, int index, c_entity e, unsigned entity_t
 }
 
 
-void
-set_light_level(int x, int y, int z, int level)
-{
-    if (x < 0 || x >= 128) return;
-    if (y < 0 || y >= 128) return;
-    if (z < 0 || z >= 128) return;
-
-    int p = x + y * 128 + z * 128 * 128;
-    if (level < 0) level = 0;
-    if (level > 255) level = 255;
-    light->data[p] = level;
-}
+/* the light window moves in steps of this many chunks, so walking about
+ * doesn't slide it every frame */
+#define LIGHT_WINDOW_STEP   (LIGHT_MAP_SIZE / 4)
 
 
-unsigned char
-get_light_level(int x, int y, int z)
+/* where the light window should start, to keep the player well inside it */
+glm::ivec3
+light_window_origin()
 {
-    if (x < 0 || x >= 128) return 0;
-    if (y < 0 || y >= 128) return 0;
-    if (z < 0 || z >= 128) return 0;
+    glm::ivec3 ch;
+    split_block_coord(get_coord_containing(pl.pos), nullptr, &ch);
 
-    return light->data[x + y*128 + z*128*128];
+    /* floor to a whole step; LIGHT_WINDOW_STEP is a power of two */
+    glm::ivec3 step = ch & glm::ivec3(~(LIGHT_WINDOW_STEP - 1));
+    return step - glm::ivec3(LIGHT_MAP_SIZE / 2 - LIGHT_WINDOW_STEP / 2);
 }
 
 
-const int light_atten = 50;
-/* as far as we can ever light from a light source */
-const int max_light_prop = (255 + light_atten - 1) / light_atten;
-
-bool need_lightfield_update = false;
-glm::ivec3 lightfield_update_mins;
-glm::ivec3 lightfield_update_maxs;
-
-
+/* moves the GPU's window onto the light to follow the player, and sends up
+ * whatever the last main tick relit. the light itself covers the whole
+ * ship, and doesn't care where the window is. */
 void
-mark_lightfield_update(glm::ivec3 center)
+upload_lightfield()
 {
-    glm::ivec3 half_extent = glm::ivec3(max_light_prop, max_light_prop, max_light_prop);
-    if (need_lightfield_update) {
-        lightfield_update_mins = center - half_extent;
-        lightfield_update_maxs = center + half_extent;
-    }
-    else {
-        lightfield_update_mins = glm::min(lightfield_update_mins,
-                center - half_extent);
-        lightfield_update_maxs = glm::max(lightfield_update_maxs,
-                center + half_extent);
-        need_lightfield_update = true;
-    }
-}
+    light->move_window(light_window_origin());
 
-
-void
-update_lightfield()
-{
-    if (!need_lightfield_update) {
-        /* nothing to do here */
-        return;
-    }
-
-    /* TODO: opt for case where we're JUST adding light -- no need to clear & rebuild */
-    /* This is general enough to cope with occluders & lights being added and removed. */
-
-    /* 1. remove all existing light in the box */
-    for (int k = lightfield_update_mins.z; k <= lightfield_update_maxs.z; k++)
-        for (int j = lightfield_update_mins.y; j <= lightfield_update_maxs.y; j++)
-            for (int i = lightfield_update_mins.x; i <= lightfield_update_maxs.x; i++)
-                set_light_level(i, j, k, 0);
-
-    /* 2. inject sources. the box is guaranteed to be big enough for max propagation
-     * for all sources we'll add here. */
-    for (auto i = 0u; i < light_man.buffer.num; i++) {
-        auto ce = light_man.instance_pool.entity[i];
-        auto pos = get_coord_containing(*pos_man.get_instance_data(ce).position);
-        auto powered = *power_man.get_instance_data(ce).powered;
-        if (powered) {
-            set_light_level(pos.x, pos.y, pos.z, std::max(
-                        (int)get_light_level(pos.x, pos.y, pos.z), (int)(255 * light_man.instance_pool.intensity[i])));
-        }
-    }
-
-    /* 3. propagate max_light_prop times. this is guaranteed to be enough to cover
-     * the sources' area of influence. */
-    for (int pass = 0; pass < max_light_prop; pass++) {
-        for (int k = lightfield_update_mins.z; k <= lightfield_update_maxs.z; k++) {
-            for (int j = lightfield_update_mins.y; j <= lightfield_update_maxs.y; j++) {
-                for (int i = lightfield_update_mins.x; i <= lightfield_update_maxs.x; i++) {
-                    int level = get_light_level(i, j, k);
-
-                    block *b = ship->get_block(glm::ivec3(i, j, k));
-                    if (!b)
-                        continue;
-
-                    if (light_permeable(b->surfs[surface_xm]))
-                        level = std::max(level, get_light_level(i - 1, j, k) - light_atten);
-                    if (light_permeable(b->surfs[surface_xp]))
-                        level = std::max(level, get_light_level(i + 1, j, k) - light_atten);
-
-                    if (light_permeable(b->surfs[surface_ym]))
-                        level = std::max(level, get_light_level(i, j - 1, k) - light_atten);
-                    if (light_permeable(b->surfs[surface_yp]))
-                        level = std::max(level, get_light_level(i, j + 1, k) - light_atten);
-
-                    if (light_permeable(b->surfs[surface_zm]))
-                        level = std::max(level, get_light_level(i, j, k - 1) - light_atten);
-                    if (light_permeable(b->surfs[surface_zp]))
-                        level = std::max(level, get_light_level(i, j, k + 1) - light_atten);
-
-                    set_light_level(i, j, k, level);
-                }
-            }
-        }
-    }
-
-    /* All done. */
+    /* only the bricks which changed go to the GPU */
     light->upload();
-    need_lightfield_update = false;
 }
 
 
@@ -593,38 +264,19 @@ void
 prepare_chunks()
 {
     /* walk all the chunks -- TODO: only walk chunks that might contribute to the view */
-    for (int k = ship->mins.z; k <= ship->maxs.z; k++) {
-        for (int j = ship->mins.y; j <= ship->maxs.y; j++) {
-            for (int i = ship->mins.x; i <= ship->maxs.x; i++) {
-                chunk *ch = ship->get_chunk(glm::ivec3(i, j, k));
-                if (ch) {
-                    ch->prepare_render();
-                    ch->prepare_phys(i, j, k);
-                }
-            }
-        }
+    for (auto const & c : ship->chunk_coords) {
+        chunk *ch = ship->get_chunk(c);
+        ch->prepare_render(workers, chunk_arena);
+        ch->prepare_phys(workers, c.x, c.y, c.z);
     }
+
+    /* swap in whatever the workers have finished since last time */
+    workers->run_completions();
 }
 
 void
 init()
 {
-    gas_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
-    light_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
-    physics_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
-    pos_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
-    power_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
-    power_provider_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
-    render_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
-    surface_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
-    switch_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
-    type_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
-    door_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
-    reader_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
-    proximity_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
-
-    proj_man.create_projectile_data(1000);
-
     printf("%s starting up.\n", APP_NAME);
     printf("OpenGL version: %.1f\n", epoxy_gl_version() / 10.0f);
 
@@ -647,10 +299,10 @@ init()
     glEnable(GL_DEPTH_TEST);
     glPolygonOffset(-0.1f, -0.1f);
 
-    mesher_init();
+    /* everything but the ship, which has to wait for the entity meshes */
+    sim_init(0);
 
-    particle_man = new particle_manager();
-    particle_man->create_particle_data(1000);
+    chunk_arena = new mesh_arena(INITIAL_CHUNK_ARENA_VERTICES, INITIAL_CHUNK_ARENA_INDICES);
 
     projectile_sw = load_mesh("mesh/sphere.dae");
     for (auto i = 0u; i < projectile_sw->num_vertices; ++i) {
@@ -679,27 +331,16 @@ init()
     set_mesh_material(door_sw, 2);  /* TODO: paint a new texture for this one */
     door_hw = upload_mesh(door_sw);
 
-    scaffold_sw = load_mesh("mesh/initial_scaffold.dae");
-
-    surfs_sw[surface_xp] = load_mesh("mesh/x_quad_p.dae");
-    surfs_sw[surface_xm] = load_mesh("mesh/x_quad.dae");
-    surfs_sw[surface_yp] = load_mesh("mesh/y_quad_p.dae");
-    surfs_sw[surface_ym] = load_mesh("mesh/y_quad.dae");
-    surfs_sw[surface_zp] = load_mesh("mesh/z_quad_p.dae");
-    surfs_sw[surface_zm] = load_mesh("mesh/z_quad.dae");
-
     for (int i = 0; i < 6; i++)
         surfs_hw[i] = upload_mesh(surfs_sw[i]);
 
-    for (auto i = 0u; i < sizeof(entity_types) / sizeof(entity_types[0]); i++) {
+    for (auto i = 0u; i < num_entity_types; i++) {
         auto t = &entity_types[i];
-        t->sw = load_mesh(t->mesh);
-        set_mesh_material(t->sw, t->material);
         t->hw = upload_mesh(t->sw);
-        build_static_physics_mesh(t->sw, &t->phys_mesh, &t->phys_shape);
     }
 
     simple_shader = load_shader("shaders/simple.vert", "shaders/simple.frag");
+    chunk_shader = load_shader("shaders/chunk.vert", "shaders/simple.frag");
     unlit_shader = load_shader("shaders/simple.vert", "shaders/unlit.frag");
     unlit_instanced_shader = load_shader("shaders/simple_instanced.vert", "shaders/unlit.frag");
     lit_instanced_shader = load_shader("shaders/simple_instanced.vert", "shaders/simple.frag");
@@ -742,36 +383,23 @@ init()
     skybox->load(4, "textures/sky_front5.png");
     skybox->load(5, "textures/sky_back6.png");
 
-    ship = ship_space::mock_ship_space();
-    if( ! ship )
-        errx(1, "Ship_space::mock_ship_space failed\n");
+    sim_load_ship(SHIP_FILENAME);
 
-    ship->rebuild_topology();
-
-    printf("Ship is %u chunks, %d..%d %d..%d %d..%d\n",
-            (unsigned) ship->chunks.size(),
+    printf("Ship is %d..%d %d..%d %d..%d\n",
             ship->mins.x, ship->maxs.x,
             ship->mins.y, ship->maxs.y,
             ship->mins.z, ship->maxs.z);
 
-    ship->validate();
-
     game_settings = load_settings(en_config_base);
     en_settings user_settings = load_settings(en_config_user);
     game_settings.merge_with(user_settings);
 
     frames = new frame_data[NUM_INFLIGHT_FRAMES];
+    for (unsigned i = 0; i < NUM_INFLIGHT_FRAMES; i++) {
+        frames[i].stats = &gpu_stats;
+    }
     frame_index = 0;
 
-    pl.angle = 0;
-    pl.elev = 0;
-    pl.pos = glm::vec3(3,2,2);
-    pl.selected_slot = 1;
-    pl.ui_dirty = true;
-    pl.disable_gravity = false;
-
-    phy = new physics(&pl);
-
     glEnable(GL_CULL_FACE);
     glFrontFace(GL_CCW);
 
@@ -781,17 +409,17 @@ init()
     unlit_ui_slot_sprite = ui_sprites->load("textures/ui-slot.png");
     lit_ui_slot_sprite = ui_sprites->load("textures/ui-slot-lit.png");
 
-    printf("World vertex size: %zu bytes\n", sizeof(vertex));
+    printf("World vertex size: %zu bytes\n", sizeof(world_vertex));
 
-    light = new light_field();
+    light = new light_field(ship);
     light->bind(1);
-
-    /* put some crap in the lightfield */
-    memset(light->data, 0, sizeof(light->data));
     light->upload();
+    light_prop = new light_propagator(&light->grid);
 
-    /* prepare the chunks -- this populates the physics data */
+    /* prepare the chunks -- this populates the physics data. don't start
+     * without it. */
     prepare_chunks();
+    workers->wait();
 }
 
 
@@ -817,7 +445,7 @@ destroy_entity(c_entity e)
 
         for (auto i = 0; i < type->height; i++) {
             auto p = b + glm::ivec3(0, 0, i);
-            block *bl = ship->get_block(p);
+            block *bl = ship->edit_block(p);
             assert(bl);
             if (bl->type == block_entity) {
                 printf("emptying %d,%d,%d on remove of ent\n", p.x, p.y, p.z);
@@ -863,6 +491,8 @@ destroy_entity(c_entity e)
     proximity_man.destroy_entity_instance(e);
 
     remove_attaches_for_entity(ship, e);
+
+    c_entity::destroy(e);
 }
 
 
@@ -891,7 +521,7 @@ remove_ents_from_surface(glm::ivec3 b, int face)
             destroy_entity(ce);
             it = ch->entities.erase(it);
 
-            block *bl = ship->get_block(p);
+            block *bl = ship->edit_block(p);
             assert(bl);
             bl->surf_space[face] = 0;   /* we've popped *everything* off, it must be empty now */
         }
@@ -921,7 +551,7 @@ struct add_block_entity_tool : tool
         }
 
         for (auto i = 0; i < entity_types[type].height; i++) {
-            block *bl = ship->get_block(rc->p + glm::ivec3(0, 0, i));
+            block const *bl = ship->get_block(rc->p + glm::ivec3(0, 0, i));
             if (bl) {
                 /* check for surface ents that would conflict */
                 for (int face = 0; face < face_count; face++)
@@ -962,7 +592,7 @@ struct add_block_entity_tool : tool
 
     void cycle_mode() override {
         do {
-            type = (type + 1) % (sizeof(entity_types) / sizeof(*entity_types));
+            type = (type + 1) % num_entity_types;
         } while (entity_types[type].placed_on_surface);
     }
 
@@ -1004,7 +634,7 @@ struct add_surface_entity_tool : tool
         if (!rc->hit)
             return false;
 
-        block *bl = rc->block;
+        block const *bl = rc->block;
 
         if (!bl)
             return false;
@@ -1014,7 +644,7 @@ struct add_surface_entity_tool : tool
         if (~bl->surfs[index] & surface_phys)
             return false;
 
-        block *other_side = ship->get_block(rc->p);
+        block const *other_side = ship->get_block(rc->p);
         unsigned short required_space = ~0; /* TODO: make this a prop of the type + subblock placement */
 
         if (other_side->surf_space[index ^ 1] & required_space) {
@@ -1031,7 +661,6 @@ struct add_surface_entity_tool : tool
 
         int index = normal_to_surface_index(rc);
 
-        block *other_side = ship->get_block(rc->p);
         unsigned short required_space = ~0; /* TODO: make this a prop of the type + subblock placement */
 
         chunk *ch = ship->get_chunk_containing(rc->p);
@@ -1043,7 +672,7 @@ struct add_surface_entity_tool : tool
         ch->entities.push_back(e);
 
         /* take the space. */
-        other_side->surf_space[index ^ 1] |= required_space;
+        ship->edit_block(rc->p)->surf_space[index ^ 1] |= required_space;
 
         /* mark lighting for rebuild around this point */
         mark_lightfield_update(rc->p);
@@ -1057,7 +686,7 @@ struct add_surface_entity_tool : tool
 
     void cycle_mode() override {
         do {
-            type = (type + 1) % (sizeof(entity_types) / sizeof(*entity_types));
+            type = (type + 1) % num_entity_types;
         } while (!entity_types[type].placed_on_surface);
     }
 
@@ -1120,7 +749,7 @@ struct remove_surface_entity_tool : tool
             return;
 
         int index = normal_to_surface_index(rc);
-        block *other_side = ship->get_block(rc->p);
+        block const *other_side = ship->get_block(rc->p);
 
         if (!other_side || !other_side->surf_space[index ^ 1]) {
             return;
@@ -1824,30 +1453,144 @@ add_text_with_outline(char const *s, float x, float y, float r = 1, float g = 1,
 }
 
 
-struct time_accumulator
+/* ui units per ms, in the profiler's graph */
+#define PROFILE_GRAPH_SCALE     4.0f
+#define PROFILE_GRAPH_MAX_MS    50.0f
+#define PROFILE_MAX_STATS       32
+
+/* the frame profiler's overlay: every zone's times, then the GPU's for each
+ * pass, and below them the frames in the ring as bars, split by outermost
+ * zone, against lines at 60Hz and 30Hz */
+void
+draw_profile_overlay()
 {
-    float period;
-    float max_period;
-    float accum;
+    static float const colors[][3] = {
+        { 0.9f, 0.3f, 0.3f }, { 0.3f, 0.9f, 0.3f }, { 0.4f, 0.5f, 1.0f }, { 0.9f, 0.9f, 0.3f },
+        { 0.9f, 0.4f, 0.9f }, { 0.3f, 0.9f, 0.9f }, { 1.0f, 0.6f, 0.2f }, { 0.7f, 0.7f, 0.7f },
+    };
+    unsigned const num_colors = sizeof(colors) / sizeof(*colors);
+
+    profile_stat stats[PROFILE_MAX_STATS];
+    unsigned n = prof.summarize(stats, PROFILE_MAX_STATS);
+
+    /* outermost zones are colored in the order they came in the newest frame */
+    auto color_of = [&](char const *name) -> float const * {
+        unsigned c = 0;
+        for (unsigned k = 0; k < n; k++) {
+            if (stats[k].depth)
+                continue;
+            if (stats[k].name == name)
+                return colors[c % num_colors];
+            c++;
+        }
+        return nullptr;
+    };
+
+    float x0 = -DEFAULT_WIDTH / 2;
+    float y = DEFAULT_HEIGHT / 2 + 36;
 
-    time_accumulator(float period, float max_period) :
-        period(period), max_period(max_period), accum(0.0f) {}
+    add_text_with_outline("zone                        avg ms   max ms", x0, y);
+    for (unsigned k = 0; k < n; k++) {
+        char buf[256];
+        y -= 16;
+        sprintf(buf, "%*s%-*s %8.2f %8.2f", stats[k].depth * 2, "",
+                28 - stats[k].depth * 2, stats[k].name, stats[k].avg_ms, stats[k].max_ms);
 
-    void add(float dt) {
-        accum = std::min(accum + dt, max_period);
+        float const *c = stats[k].depth ? nullptr : color_of(stats[k].name);
+        if (c)
+            add_text_with_outline(buf, x0, y, c[0], c[1], c[2]);
+        else
+            add_text_with_outline(buf, x0, y);
     }
 
-    bool tick()
-    {
-        if (accum >= period) {
-            accum -= period;
-            return true;
+    char buf[256];
+    float x1 = x0 + 440;
+    y = DEFAULT_HEIGHT / 2 + 36;
+    add_text_with_outline("gpu pass                    avg ms  last ms", x1, y);
+    for (unsigned i = 0; i < gpu_stats.num_passes; i++) {
+        y -= 16;
+        sprintf(buf, "%-28s %8.2f %8.2f", gpu_stats.names[i], gpu_stats.avg_ms[i], gpu_stats.last_ms[i]);
+        add_text_with_outline(buf, x1, y);
+    }
+
+    y -= 24;
+    sprintf(buf, "fence wait: %.2f ms avg, %.2f ms max; stalled %u of %u frames",
+            gpu_stats.avg_wait_ms, gpu_stats.max_wait_ms, gpu_stats.stalls, gpu_stats.frames);
+    add_text_with_outline(buf, x1, y, 1, gpu_stats.last_wait_ms > 1 ? 0.4f : 1, gpu_stats.last_wait_ms > 1 ? 0.4f : 1);
+
+    float y0 = -DEFAULT_HEIGHT / 2 - 90;
+    float graph_w = PROFILE_FRAMES * 3.0f;
+    float graph_h = PROFILE_GRAPH_MAX_MS * PROFILE_GRAPH_SCALE;
+
+    text->add_rect(x0, y0 + graph_h, graph_w, graph_h, 0.1f, 0.1f, 0.1f);
+
+    for (unsigned age = 0; age < prof.num_frames; age++) {
+        profile_frame const *f = prof.get_frame(age);
+        float x = x0 + graph_w - 3.0f * (age + 1);
+        float top = 0;
+
+        auto bar = [&](float ms, float const *c) {
+            float h = std::min(ms * PROFILE_GRAPH_SCALE, graph_h - top);
+            if (h > 0)
+                text->add_rect(x, y0 + top + h, 2, h, c[0], c[1], c[2]);
+            top += std::max(h, 0.0f);
+        };
+
+        float outer_ms = 0;
+        for (unsigned i = 0; i < f->num_zones; i++) {
+            auto const *z = &f->zones[i];
+            float const *c = z->depth ? nullptr : color_of(z->name);
+            if (!c)
+                continue;
+
+            float ms = (z->end - z->start) / 1e6f;
+            bar(ms, c);
+            outer_ms += ms;
         }
 
-        return false;
+        /* the rest of the frame */
+        static float const other[3] = { 0.35f, 0.35f, 0.35f };
+        bar((f->end - f->start) / 1e6f - outer_ms, other);
     }
-};
 
+    text->add_rect(x0, y0 + 1000 / 60.0f * PROFILE_GRAPH_SCALE, graph_w, 1, 1, 1, 1);
+    text->add_rect(x0, y0 + 1000 / 30.0f * PROFILE_GRAPH_SCALE, graph_w, 1, 1, 0.4f, 0.4f);
+}
+
+
+/* draws every visible chunk's render mesh out of the chunk arena, a batch at
+ * a time: one upload of the batch's transforms, and one multi-draw */
+void
+draw_chunks(frame_data *frame)
+{
+    glUseProgram(chunk_shader);
+    chunk_arena->bind();
+
+    auto it = ship->chunks.begin();
+    while (it != ship->chunks.end()) {
+        auto chunk_matrices = frame->alloc_aligned<glm::mat4>(INSTANCE_BATCH_SIZE);
+        arena_mesh const *meshes[INSTANCE_BATCH_SIZE];
+        auto count = 0u;
+
+        for (; it != ship->chunks.end() && count < INSTANCE_BATCH_SIZE; ++it) {
+            chunk *ch = it->second;
+            if (ch->render_chunk.mesh.empty() || !visibility.chunk_visible(it->first))
+                continue;
+
+            chunk_matrices.ptr[count] = mat_position(CHUNK_SIZE * it->first) *
+                mat_scale(glm::vec3(1.0f / WORLD_VERTEX_SCALE));
+            meshes[count] = &ch->render_chunk.mesh;
+            ++count;
+        }
+
+        if (count) {
+            chunk_matrices.bind(1, frame);
+            chunk_arena->draw_batch(meshes, count, frame);
+        }
+    }
+
+    glUseProgram(simple_shader);
+}
 
 void render() {
     float depthClearValue = 1.0f;
@@ -1858,7 +1601,10 @@ void render() {
         frame_index = 0;
     }
 
-    frame->begin();
+    {
+        PROFILE_SCOPE("fence wait");
+        frame->begin();
+    }
 
     pl.dir = glm::vec3(
         cosf(pl.angle) * cosf(pl.elev),
@@ -1884,58 +1630,86 @@ void render() {
 
     world_textures->bind(0);
 
-    prepare_chunks();
+    {
+        PROFILE_SCOPE("prepare_chunks");
+        prepare_chunks();
+    }
 
-    for (int k = ship->mins.z; k <= ship->maxs.z; k++) {
-        for (int j = ship->mins.y; j <= ship->maxs.y; j++) {
-            for (int i = ship->mins.x; i <= ship->maxs.x; i++) {
-                /* TODO: prepare all the matrices first, and do ONE upload */
-                chunk *ch = ship->get_chunk(glm::ivec3(i, j, k));
-                if (ch) {
-                    auto chunk_matrix = frame->alloc_aligned<glm::mat4>(1);
-                    *chunk_matrix.ptr = mat_position(CHUNK_SIZE * glm::ivec3(i, j, k));
-                    chunk_matrix.bind(1, frame);
-                    draw_mesh(ch->render_chunk.mesh);
-                }
-            }
-        }
+    {
+        PROFILE_SCOPE("visibility");
+        view_frustum = frustum(proj * view);
+        visibility.compute(ship, view_frustum, pl.eye);
     }
 
-    state->render(frame);
+    {
+        PROFILE_SCOPE("draw chunks");
+        gpu_timer_scope gpu(frame, "chunks");
+        draw_chunks(frame);
+    }
 
-    draw_renderables(frame);
-    glUseProgram(modelspace_uv_shader);
-    draw_doors(frame);
+    {
+        PROFILE_SCOPE("draw state");
+        gpu_timer_scope gpu(frame, "state");
+        state->render(frame);
+    }
+
+    {
+        PROFILE_SCOPE("draw entities");
+        gpu_timer_scope gpu(frame, "entities");
+        draw_renderables(frame, view_frustum, visibility);
+        glUseProgram(modelspace_uv_shader);
+        draw_doors(frame, view_frustum, visibility);
+    }
 
     /* draw the projectiles */
-    glUseProgram(unlit_instanced_shader);
-    draw_projectiles(proj_man, frame);
-    glUseProgram(lit_instanced_shader);
-    draw_attachments(ship, frame);
-    draw_segments(ship, frame);
-    glUseProgram(unlit_instanced_shader);
-    draw_attachments_on_active_wire(ship, frame);
-    draw_active_segments(ship, frame);
+    {
+        PROFILE_SCOPE("draw projectiles");
+        gpu_timer_scope gpu(frame, "projectiles");
+        glUseProgram(unlit_instanced_shader);
+        draw_projectiles(proj_man, frame);
+    }
+
+    {
+        PROFILE_SCOPE("draw wires");
+        gpu_timer_scope gpu(frame, "wires");
+        glUseProgram(lit_instanced_shader);
+        draw_attachments(ship, frame);
+        draw_segments(ship, frame);
+        glUseProgram(unlit_instanced_shader);
+        draw_attachments_on_active_wire(ship, frame);
+        draw_active_segments(ship, frame);
+    }
 
     /* draw the sky */
-    glUseProgram(sky_shader);
-    skybox->bind(0);
-    glDepthMask(GL_FALSE);
-    glDepthFunc(GL_LEQUAL);
-    glDrawArrays(GL_TRIANGLES, 0, 3);
-    glDepthFunc(GL_LESS);
+    {
+        PROFILE_SCOPE("draw sky");
+        gpu_timer_scope gpu(frame, "sky");
+        glUseProgram(sky_shader);
+        skybox->bind(0);
+        glDepthMask(GL_FALSE);
+        glDepthFunc(GL_LEQUAL);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glDepthFunc(GL_LESS);
+    }
 
     /* Draw particles with depth test on but writes off */
-    glUseProgram(particle_shader);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-    draw_particles(particle_man, frame);
-    glDisable(GL_BLEND);
+    {
+        PROFILE_SCOPE("draw particles");
+        gpu_timer_scope gpu(frame, "particles");
+        glUseProgram(particle_shader);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        draw_particles(particle_man, frame);
+        glDisable(GL_BLEND);
+    }
 
     /* Reenable depth write */
     glDepthMask(GL_TRUE);
 
     if (draw_hud) {
+        PROFILE_SCOPE("draw ui");
+        gpu_timer_scope gpu(frame, "ui");
+
         /* draw the ui */
         glDisable(GL_DEPTH_TEST);
 
@@ -1956,9 +1730,6 @@ void render() {
 }
 
 
-time_accumulator main_tick_accum(1/15.0f, 1.f);  /* 15Hz tick for game logic */
-time_accumulator fast_tick_accum(1/60.0f, 1.f);  /* 60Hz tick for motion */
-
 void
 update()
 {
@@ -1969,38 +1740,24 @@ update()
     fast_tick_accum.add(dt);
 
     /* this absolutely must run every frame */
-    state->update(dt);
+    {
+        PROFILE_SCOPE("state update");
+        state->update(dt);
+    }
 
     /* things that can run at a pretty slow rate */
     while (main_tick_accum.tick()) {
 
-        /* remove any air that someone managed to get into the outside */
+        sim_main_tick();
+
         {
-            topo_info *t = topo_find(&ship->outside_topo_info);
-            zone_info *z = ship->get_zone_info(t);
-            if (z) {
-                /* try as hard as you like, you cannot fill space with your air system */
-                z->air_amount = 0;
-            }
+            PROFILE_SCOPE("upload lightfield");
+            upload_lightfield();
         }
 
-        /* allow the entities to tick */
-        tick_readers(ship);
-        tick_gas_producers(ship);
-        tick_power_consumers(ship);
-        tick_light_components(ship);
-        tick_pressure_sensors(ship);
-        tick_sensor_comparators(ship);
-        tick_proximity_sensors(ship, &pl);
-        tick_doors(ship);
-
-        /* rebuild lighting if needed */
-        update_lightfield();
+        if (pl.ui_dirty || draw_debug_text || draw_fps || draw_profiler) {
+            PROFILE_SCOPE("rebuild ui");
 
-        calculate_power_wires(ship);
-        propagate_comms_wires(ship);
-
-        if (pl.ui_dirty || draw_debug_text || draw_fps) {
             text->reset();
             ui_sprites->reset();
 
@@ -2023,6 +1780,10 @@ update()
                 add_text_with_outline(buf[2], -DEFAULT_WIDTH / 2 + (100 - w[2]), DEFAULT_HEIGHT / 2 + 64);
             }
 
+            if (draw_profiler) {
+                draw_profile_overlay();
+            }
+
             text->upload();
 
             ui_sprites->upload();
@@ -2032,15 +1793,13 @@ update()
 
     /* character controller tick: we'd LIKE to run this off the fast_tick_accum, but it has all kinds of
      * every-frame assumptions baked in (player impulse state, etc) */
-    phy->tick_controller(dt);
+    {
+        PROFILE_SCOPE("character controller");
+        phy->tick_controller(dt);
+    }
 
     while (fast_tick_accum.tick()) {
-
-        proj_man.simulate(fast_tick_accum.period);
-        particle_man->simulate(fast_tick_accum.period);
-
-        phy->tick(fast_tick_accum.period);
-
+        sim_fast_tick();
     }
 }
 
@@ -2125,13 +1884,21 @@ struct play_state : game_state {
             add_text_with_outline(buf2, -w/2, -100);
 
             w = 0; h = 0;
-            sprintf(buf2, "full: %d fast-unify: %d fast-nosplit: %d false-split: %d",
+            sprintf(buf2, "full: %d fast-unify: %d fast-nosplit: %d fast-split: %d false-split: %d",
                     ship->num_full_rebuilds,
                     ship->num_fast_unifys,
                     ship->num_fast_nosplits,
+                    ship->num_fast_splits,
                     ship->num_false_splits);
             text->measure(buf2, &w, &h);
             add_text_with_outline(buf2, -w/2, -150);
+
+            w = 0; h = 0;
+            sprintf(buf2, "chunks visible: %u tested: %u",
+                    visibility.num_visible,
+                    visibility.num_tested);
+            text->measure(buf2, &w, &h);
+            add_text_with_outline(buf2, -w/2, -175);
         }
 
         unsigned num_tools = sizeof(tools) / sizeof(tools[0]);
@@ -2351,6 +2118,10 @@ struct menu_state : game_state
     menu_state() : items() {
         items.push_back(menu_item("Resume Game", []{ set_game_state(create_play_state()); }));
         items.push_back(menu_item("Settings", []{ set_game_state(create_menu_settings_state()); }));
+        items.push_back(menu_item("Save Ship", []{
+            if (!ship->save(SHIP_FILENAME, describe_entity))
+                printf("Failed to save %s\n", SHIP_FILENAME);
+        }));
         items.push_back(menu_item("Exit Game", []{ exit_requested = true; }));
     }
 
@@ -2525,6 +2296,18 @@ handle_input()
     if (wnd.has_focus) {
         set_inputs(keys, mouse_buttons, mouse_axes, game_settings.bindings.bindings);
         state->handle_input();
+
+        if (get_input(action_profiler)->just_active) {
+            draw_profiler = !draw_profiler;
+            pl.ui_dirty = true;
+        }
+
+        if (get_input(action_profile_dump)->just_active) {
+            if (prof.dump_trace(PROFILE_FILENAME))
+                printf("Wrote the last %u frames to %s\n", prof.num_frames, PROFILE_FILENAME);
+            else
+                printf("Failed to write %s\n", PROFILE_FILENAME);
+        }
     }
 }
 
@@ -2533,6 +2316,8 @@ void
 run()
 {
     for (;;) {
+        PROFILE_FRAME();
+
         auto sdl_buttons = SDL_GetRelativeMouseState(nullptr, nullptr);
         mouse_buttons[EN_MOUSE_BUTTON(input_mouse_left)]      = sdl_buttons & EN_SDL_BUTTON(input_mouse_left);
         mouse_buttons[EN_MOUSE_BUTTON(input_mouse_middle)]    = sdl_buttons & EN_SDL_BUTTON(input_mouse_middle);
@@ -2598,11 +2383,20 @@ run()
         /* SDL_PollEvent above has already pumped the input, so current key state is available */
         handle_input();
 
-        update();
+        {
+            PROFILE_SCOPE("update");
+            update();
+        }
 
-        render();
+        {
+            PROFILE_SCOPE("render");
+            render();
+        }
 
-        SDL_GL_SwapWindow(wnd.ptr);
+        {
+            PROFILE_SCOPE("swap");
+            SDL_GL_SwapWindow(wnd.ptr);
+        }
 
         if (exit_requested) return;
     }
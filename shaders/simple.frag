@@ -7,7 +7,8 @@ in vec3 ws_pos;
 in vec3 ws_norm;
 
 layout(binding=0) uniform sampler2DArray s_albedo;
-layout(binding=1) uniform sampler3D s_light_field;
+layout(binding=1) uniform usampler3D s_light_map;
+layout(binding=2) uniform sampler3D s_light_atlas;
 
 layout(location=0) out vec4 color;
 
@@ -15,6 +16,43 @@ const float ambientAmount = 0.1;
 const float light_step = -0.5;
 const float light_pos_quantize_factor = 4;
 
+/* must match LIGHT_MAP_SIZE and LIGHT_ATLAS_BRICKS. CHUNK_SIZE and
+ * CHUNK_SHIFT come from load_shader() */
+const int light_map_size = 32;
+const uint light_atlas_bricks = 16u;
+const int chunk_size = CHUNK_SIZE;
+const int chunk_shift = CHUNK_SHIFT;
+
+/* light at block p: the brick map gives the chunk's slot in the atlas + 1,
+ * and the brick there is stored z fastest */
+float light_at(ivec3 p)
+{
+    uint slot = texelFetch(s_light_map, (p >> chunk_shift) & (light_map_size - 1), 0).x;
+    if (slot == 0u)
+        return 0.0;
+
+    slot -= 1u;
+    ivec3 brick = ivec3(slot % light_atlas_bricks,
+                        slot / light_atlas_bricks % light_atlas_bricks,
+                        slot / (light_atlas_bricks * light_atlas_bricks));
+    return texelFetch(s_light_atlas, brick * chunk_size + (p & (chunk_size - 1)).zyx, 0).x;
+}
+
+/* trilinear between block centers, as sampling a single light texture was */
+float sample_light(vec3 pos)
+{
+    vec3 f = pos - 0.5;
+    ivec3 p = ivec3(floor(f));
+    vec3 t = f - vec3(p);
+
+    return mix(
+        mix(mix(light_at(p + ivec3(0, 0, 0)), light_at(p + ivec3(1, 0, 0)), t.x),
+            mix(light_at(p + ivec3(0, 1, 0)), light_at(p + ivec3(1, 1, 0)), t.x), t.y),
+        mix(mix(light_at(p + ivec3(0, 0, 1)), light_at(p + ivec3(1, 0, 1)), t.x),
+            mix(light_at(p + ivec3(0, 1, 1)), light_at(p + ivec3(1, 1, 1)), t.x), t.y),
+        t.z);
+}
+
 void main(void)
 {
     /* lighting */
@@ -22,7 +60,7 @@ void main(void)
     /* quantize for stylized look */
     light_lookup_pos = round(light_lookup_pos * light_pos_quantize_factor) / light_pos_quantize_factor;
     float light = mix(
-		texture(s_light_field, light_lookup_pos / textureSize(s_light_field, 0)).x,
+		sample_light(light_lookup_pos),
 		1.0,
 		ambientAmount);
 
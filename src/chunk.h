@@ -1,21 +1,93 @@
 #pragma once
 
 #include "block.h"
+#include "chunk_size.h"
 #include "fixed_cube.h"
-#include "mesh.h"
+#include "mesh_arena.h"
+#include "palette_cube.h"
 #include "component/c_entity.h"
 
+#include <stdint.h>
+#include <memory>
 #include <vector>
 
-#define CHUNK_SIZE 8
+#define CHUNK_VOLUME (CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE)
+
+/* a chunk's blocks spelled out in full, as the meshers and the ship file want them */
+typedef fixed_cube<block, CHUNK_SIZE> chunk_blocks;
+
+#define FACE_MASK_WORDS ((CHUNK_VOLUME + 63) / 64)
+
+/* which faces of a chunk's blocks let air and light through, a bit per
+ * block per face, in the blocks' own [x][y][z] order.
+ *
+ * the air and light passes only want one bit of each surface, and reading
+ * it from here rather than from the blocks keeps them from dragging whole
+ * block structs through the cache. derived from the blocks' surfaces, so
+ * anything which writes those must go through chunk::set_surface(), or
+ * call chunk::refresh_faces() when it is done.
+ */
+struct chunk_faces {
+    uint64_t air[face_count][FACE_MASK_WORDS];
+    uint64_t light[face_count][FACE_MASK_WORDS];
+
+    /* i is the block's index into the chunk's fixed_cubes */
+    bool air_open(unsigned i, int face) const
+    {
+        return (air[face][i >> 6] >> (i & 63)) & 1;
+    }
+
+    bool light_open(unsigned i, int face) const
+    {
+        return (light[face][i >> 6] >> (i & 63)) & 1;
+    }
+
+    /* whether air passes every face of every block */
+    bool all_air_open() const
+    {
+        for (int face = 0; face < face_count; face++) {
+            for (int w = 0; w < FACE_MASK_WORDS; w++) {
+                if (~air[face][w])
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    void set(unsigned i, int face, surface_type st)
+    {
+        uint64_t bit = 1ull << (i & 63);
+
+        if (air_permeable(st))
+            air[face][i >> 6] |= bit;
+        else
+            air[face][i >> 6] &= ~bit;
+
+        if (light_permeable(st))
+            light[face][i >> 6] |= bit;
+        else
+            light[face][i >> 6] &= ~bit;
+    }
+};
+
+/* index of within-chunk block coordinates (x, y, z) into a chunk's fixed_cubes */
+static inline unsigned
+chunk_block_index(int x, int y, int z)
+{
+    return (x * CHUNK_SIZE + y) * CHUNK_SIZE + z;
+}
 
 class btTriangleMesh;
 class btCollisionShape;
 class btRigidBody;
+struct worker_pool;
 
 struct render_chunk {
-    hw_mesh *mesh = nullptr;
+    arena_mesh mesh;
     bool valid = false;
+    bool pending = false;   /* a rebuild is in flight on a worker */
+    uint8_t opaque_faces = 0;   /* see chunk_opaque_faces() */
 };
 
 struct phys_chunk {
@@ -23,6 +95,14 @@ struct phys_chunk {
     btCollisionShape *phys_shape = nullptr;
     btRigidBody *phys_body = nullptr;
     bool valid = false;
+    bool pending = false;   /* a rebuild is in flight on a worker */
+};
+
+/* light levels of each block, for light_grid. kept with the chunk so that
+ * light reaches anywhere the ship does */
+struct light_chunk {
+    fixed_cube<unsigned char, CHUNK_SIZE> levels;
+    bool dirty = false;     /* changed since light_grid::clear_dirty() */
 };
 
 struct topo_info {
@@ -36,20 +116,102 @@ struct chunk {
      * we have 8^3 blocks
      * this means a chunk represents
      * 8m^3
+     *
+     * most chunks are empty space, or close to it, so the blocks are kept
+     * palette-compressed until something writes to them.
      */
-    fixed_cube<block, CHUNK_SIZE> blocks;
-    fixed_cube<topo_info, CHUNK_SIZE> topo;
+    palette_cube<block, CHUNK_SIZE> blocks;
+    chunk_faces faces;
+
+    /* each block's node in the atmo topology. while air passes every face in
+     * the chunk, its blocks are all one piece, and share topo_shared; topo is
+     * only allocated once a surface might divide them. see topo_at() */
+    std::unique_ptr<fixed_cube<topo_info, CHUNK_SIZE>> topo;
+    topo_info topo_shared;
 
     /* rendering information */
     struct render_chunk render_chunk;
     struct phys_chunk phys_chunk;
+    struct light_chunk light_chunk;
 
     /* entities */
     std::vector<c_entity> entities;
 
-    void prepare_render();
-    void prepare_phys(int x, int y, int z);
+    chunk()
+    {
+        /* every block starts with no surfaces, so every face is open */
+        memset(&faces, 0xff, sizeof(faces));
+
+        topo_shared.p = &topo_shared;
+        topo_shared.rank = 0;
+        topo_shared.size = 0;
+    }
+
+    /* the topo_info of the block at flat index i */
+    topo_info * topo_at(unsigned i)
+    {
+        return topo ? &topo->contents[0][0][0] + i : &topo_shared;
+    }
+
+    /* gives each block its own topo_info, starting out as a copy of the
+     * shared one. topo_shared is left as it was, so anything which still
+     * points at it keeps finding the same root */
+    void split_topo()
+    {
+        if (topo)
+            return;
+
+        auto *t = new fixed_cube<topo_info, CHUNK_SIZE>();
+        topo_info *cells = &t->contents[0][0][0];
+        for (unsigned i = 0; i < CHUNK_VOLUME; i++) {
+            cells[i] = topo_shared;
+        }
+
+        topo.reset(t);
+    }
+
+    /* sets face of the block at within-chunk coordinates (x, y, z),
+     * keeping faces in step */
+    void set_surface(int x, int y, int z, int face, surface_type st)
+    {
+        if (blocks.get(x, y, z)->surfs[face] == st)
+            return;
+
+        if (!air_permeable(st))
+            split_topo();
+
+        blocks.edit(x, y, z)->surfs[face] = st;
+        faces.set(chunk_block_index(x, y, z), face, st);
+    }
+
+    /* rederives faces from the blocks, after writing to them directly */
+    void refresh_faces()
+    {
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            for (int y = 0; y < CHUNK_SIZE; y++) {
+                for (int z = 0; z < CHUNK_SIZE; z++) {
+                    block const *bl = blocks.get(x, y, z);
+                    for (int face = 0; face < face_count; face++) {
+                        faces.set(chunk_block_index(x, y, z), face, bl->surfs[face]);
+                    }
+                }
+            }
+        }
+
+        if (!faces.all_air_open())
+            split_topo();
+    }
+
+    /* queue rebuilds of the render and physics meshes on pool, if they are stale.
+     * the new meshes are swapped in by pool->run_completions(); the render
+     * mesh goes into arena */
+    void prepare_render(worker_pool *pool, mesh_arena *arena);
+    void prepare_phys(worker_pool *pool, int x, int y, int z);
 };
 
 /* must be called once before the mesher can be used */
 void mesher_init();
+
+/* the render mesh of a chunk's blocks, as prepare_render() builds it on a
+ * worker, relative to the chunk */
+void build_render_mesh(chunk_blocks *blocks, std::vector<world_vertex> *out, std::vector<unsigned> *indices);
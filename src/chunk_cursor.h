@@ -0,0 +1,169 @@
+#pragma once
+
+#include "ship_space.h"
+
+/* the 3x3x3 block of chunks around a centre chunk
+ *
+ * slots are filled from the ship the first time they are asked for, so
+ * a walk which never leaves the centre chunk costs one lookup, and one
+ * which does touches each neighbouring chunk once.
+ */
+struct chunk_neighborhood {
+    ship_space *ship;
+    glm::ivec3 center;
+    unsigned loaded;            /* bit per slot */
+    chunk *slots[27];
+
+    chunk_neighborhood(ship_space *ship, glm::ivec3 center)
+        : ship(ship), center(center), loaded(0)
+    {
+    }
+
+    /* returns the chunk at offset (dx, dy, dz) from the centre, each in -1..1, or null */
+    chunk * get(int dx, int dy, int dz)
+    {
+        int slot = (dx + 1) * 9 + (dy + 1) * 3 + (dz + 1);
+        if (!(loaded & (1u << slot))) {
+            slots[slot] = ship->get_chunk(center + glm::ivec3(dx, dy, dz));
+            loaded |= 1u << slot;
+        }
+
+        return slots[slot];
+    }
+};
+
+/* walks the blocks of one chunk in memory order, resolving the six face
+ * neighbours of the current block without going back through ship_space.
+ *
+ *     for (chunk_cursor c(ship, ch); c.valid(); c.next()) {
+ *         block const *bl = c.get_block();
+ *         block const *above = c.neighbor_block(surface_zp);
+ *         ...
+ *     }
+ *
+ * neighbours within the chunk are found by pointer arithmetic; those across
+ * a chunk boundary go through the neighbourhood.
+ */
+struct chunk_cursor {
+    chunk_neighborhood nb;
+    chunk *ch;
+    int x, y, z;        /* within-chunk block coordinates */
+    int index;          /* flat index into the chunk's fixed_cubes */
+
+    /* fixed_cube is [x][y][z], so z is the fastest-moving axis */
+    enum {
+        stride_x = CHUNK_SIZE * CHUNK_SIZE,
+        stride_y = CHUNK_SIZE,
+        stride_z = 1,
+    };
+
+    /* a cursor over the whole of the chunk at chunk coordinates c */
+    chunk_cursor(ship_space *ship, glm::ivec3 c)
+        : nb(ship, c), ch(nb.get(0, 0, 0)), x(0), y(0), z(0), index(0)
+    {
+    }
+
+    /* a cursor parked on the single block at block coordinates p.
+     * if p is not within any chunk, the cursor is not valid.
+     */
+    static chunk_cursor
+    at_block(ship_space *ship, glm::ivec3 p)
+    {
+        glm::ivec3 c, b;
+        split_block_coord(p, &b, &c);
+
+        chunk_cursor cur(ship, c);
+        cur.x = b.x;
+        cur.y = b.y;
+        cur.z = b.z;
+        cur.index = b.x * stride_x + b.y * stride_y + b.z * stride_z;
+        return cur;
+    }
+
+    bool valid() const
+    {
+        return ch && index < CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+    }
+
+    void next()
+    {
+        index++;
+        if (++z == CHUNK_SIZE) {
+            z = 0;
+            if (++y == CHUNK_SIZE) {
+                y = 0;
+                ++x;
+            }
+        }
+    }
+
+    /* block coordinates of the current block */
+    glm::ivec3 pos() const
+    {
+        return CHUNK_SIZE * nb.center + glm::ivec3(x, y, z);
+    }
+
+    block const * get_block() const
+    {
+        return ch->blocks.at(index);
+    }
+
+    topo_info * get_topo() const
+    {
+        return ch->topo_at(index);
+    }
+
+    /* the block across face from the current one, or null if there is
+     * no chunk there */
+    block const * neighbor_block(int face)
+    {
+        int off;
+        chunk *c = neighbor(face, &off);
+        return c ? c->blocks.at(off) : nullptr;
+    }
+
+    /* the topo_info across face from the current one. like
+     * ship_space::get_topo_info, this is the outside if there is no chunk there */
+    topo_info * neighbor_topo(int face)
+    {
+        int off;
+        chunk *c = neighbor(face, &off);
+        return c ? c->topo_at(off) : &nb.ship->outside_topo_info;
+    }
+
+private:
+    /* finds the chunk containing the neighbour across face, and the
+     * neighbour's flat index within it */
+    chunk * neighbor(int face, int *off)
+    {
+        switch (face) {
+        case surface_xp:
+            if (x < CHUNK_SIZE - 1) { *off = index + stride_x; return ch; }
+            *off = index - (CHUNK_SIZE - 1) * stride_x;
+            return nb.get(1, 0, 0);
+        case surface_xm:
+            if (x > 0) { *off = index - stride_x; return ch; }
+            *off = index + (CHUNK_SIZE - 1) * stride_x;
+            return nb.get(-1, 0, 0);
+        case surface_yp:
+            if (y < CHUNK_SIZE - 1) { *off = index + stride_y; return ch; }
+            *off = index - (CHUNK_SIZE - 1) * stride_y;
+            return nb.get(0, 1, 0);
+        case surface_ym:
+            if (y > 0) { *off = index - stride_y; return ch; }
+            *off = index + (CHUNK_SIZE - 1) * stride_y;
+            return nb.get(0, -1, 0);
+        case surface_zp:
+            if (z < CHUNK_SIZE - 1) { *off = index + stride_z; return ch; }
+            *off = index - (CHUNK_SIZE - 1) * stride_z;
+            return nb.get(0, 0, 1);
+        case surface_zm:
+            if (z > 0) { *off = index - stride_z; return ch; }
+            *off = index + (CHUNK_SIZE - 1) * stride_z;
+            return nb.get(0, 0, -1);
+        }
+
+        assert(!"bad face");
+        return nullptr;
+    }
+};
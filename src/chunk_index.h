@@ -0,0 +1,138 @@
+#pragma once
+
+#include <assert.h>
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+struct chunk;
+
+/* mixes a coordinate triple into a well-distributed hash.
+ * nearby coordinates must land far apart -- ships are dense boxes of chunks,
+ * and the open-addressed chunk_index degrades badly on clustered hashes.
+ */
+static inline uint64_t
+hash_ivec3(glm::ivec3 v)
+{
+    uint64_t h = (uint64_t)(uint32_t)v.x * 0x9e3779b97f4a7c15ull;
+    h ^= (uint64_t)(uint32_t)v.y * 0xc2b2ae3d27d4eb4full;
+    h ^= (uint64_t)(uint32_t)v.z * 0x165667b19e3779f9ull;
+
+    /* murmur3 finalizer */
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+/* flat open-addressed map from chunk coordinates to chunks
+ *
+ * lookups probe linearly through one contiguous array rather than chasing
+ * std::unordered_map's per-node allocations, and the most recent hit is
+ * cached, since the volumetric passes ask for the same chunk many times
+ * in a row.
+ *
+ * entries are never removed; chunks live as long as the ship does.
+ * iteration yields (coordinate, chunk) pairs, in no particular order.
+ *
+ * get() updates the lookup cache, so concurrent readers must use find().
+ */
+struct chunk_index {
+    typedef std::pair<glm::ivec3, chunk *> entry;
+
+    chunk_index() : slots(16), count(0), cached_key(), cached(nullptr) {}
+
+    /* returns the chunk at chunk coordinates v, or null */
+    chunk * get(glm::ivec3 v)
+    {
+        if (cached && cached_key == v)
+            return cached;
+
+        chunk *ch = find(v);
+        if (ch) {
+            cached_key = v;
+            cached = ch;
+        }
+
+        return ch;
+    }
+
+    /* as get(), without touching the cache */
+    chunk * find(glm::ivec3 v) const
+    {
+        size_t mask = slots.size() - 1;
+        for (size_t i = (size_t)hash_ivec3(v) & mask; ; i = (i + 1) & mask) {
+            entry const & e = slots[i];
+            if (!e.second)
+                return nullptr;
+            if (e.first == v)
+                return e.second;
+        }
+    }
+
+    /* adds chunk ch at v. v must not already be present. */
+    void insert(glm::ivec3 v, chunk *ch)
+    {
+        assert(ch);
+
+        /* keep the load factor under 1/2 so probe runs stay short */
+        if ((count + 1) * 2 > slots.size())
+            grow();
+
+        place(v, ch);
+        count++;
+    }
+
+    size_t size() const { return count; }
+
+    struct iterator {
+        entry *p, *end;
+
+        iterator(entry *p, entry *end) : p(p), end(end) { skip(); }
+
+        void skip() { while (p != end && !p->second) ++p; }
+
+        entry & operator*() const { return *p; }
+        entry * operator->() const { return p; }
+        iterator & operator++() { ++p; skip(); return *this; }
+        iterator operator++(int) { iterator it = *this; ++*this; return it; }
+        bool operator==(iterator const & other) const { return p == other.p; }
+        bool operator!=(iterator const & other) const { return p != other.p; }
+    };
+
+    iterator begin() { return iterator(slots.data(), slots.data() + slots.size()); }
+    iterator end() { return iterator(slots.data() + slots.size(), slots.data() + slots.size()); }
+
+private:
+    std::vector<entry> slots;   /* power-of-two sized; empty slots have a null chunk */
+    size_t count;
+
+    glm::ivec3 cached_key;
+    chunk *cached;
+
+    void place(glm::ivec3 v, chunk *ch)
+    {
+        size_t mask = slots.size() - 1;
+        size_t i = (size_t)hash_ivec3(v) & mask;
+        while (slots[i].second) {
+            assert(!(slots[i].first == v) || !"chunk inserted twice");
+            i = (i + 1) & mask;
+        }
+
+        slots[i] = entry(v, ch);
+    }
+
+    void grow()
+    {
+        std::vector<entry> old(slots.size() * 2);
+        old.swap(slots);
+
+        for (auto const & e : old) {
+            if (e.second)
+                place(e.first, e.second);
+        }
+    }
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+/* blocks along each side of a chunk. a power of two from 4 to 32; pick
+ * another at build time with -DCHUNK_SIZE=n (cmake -DNIGHTMARE_CHUNK_SIZE=n).
+ *
+ * ship files only load into a build with the chunk size they were saved
+ * from.
+ */
+#ifndef CHUNK_SIZE
+#define CHUNK_SIZE 8
+#endif
+
+/* log2(CHUNK_SIZE), so block coordinates split with a shift and a mask */
+#if CHUNK_SIZE == 4
+#define CHUNK_SHIFT 2
+#elif CHUNK_SIZE == 8
+#define CHUNK_SHIFT 3
+#elif CHUNK_SIZE == 16
+#define CHUNK_SHIFT 4
+#elif CHUNK_SIZE == 32
+#define CHUNK_SHIFT 5
+#else
+#error "CHUNK_SIZE must be 4, 8, 16 or 32"
+#endif
+
+#define CHUNK_MASK (CHUNK_SIZE - 1)
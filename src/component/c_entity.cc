@@ -0,0 +1,45 @@
+#include <assert.h>
+#include <vector>
+
+#include "c_entity.h"
+
+
+/* by index: its current generation. index 0 is never handed out, so that
+ * no entity has id 0 */
+static std::vector<unsigned> entity_generations(1);
+static std::vector<unsigned> free_entity_indices;
+
+
+c_entity
+c_entity::spawn()
+{
+    unsigned index;
+
+    if (!free_entity_indices.empty()) {
+        index = free_entity_indices.back();
+        free_entity_indices.pop_back();
+    }
+    else {
+        index = (unsigned)entity_generations.size();
+        assert(index <= ENTITY_INDEX_MASK || !"out of entity indices");
+        entity_generations.push_back(0);
+    }
+
+    c_entity e = { (entity_generations[index] << ENTITY_INDEX_BITS) | index };
+    return e;
+}
+
+
+void
+c_entity::destroy(c_entity e)
+{
+    auto index = e.index();
+
+    /* already destroyed */
+    if (!index || index >= entity_generations.size() ||
+        entity_generations[index] != e.generation())
+        return;
+
+    entity_generations[index] = (entity_generations[index] + 1) & (~0u >> ENTITY_INDEX_BITS);
+    free_entity_indices.push_back(index);
+}
@@ -1,10 +1,24 @@
 #pragma once
 
-static unsigned entities_id_ref = 1;
+/* an entity's id is an index, which the component managers look it up by,
+ * and a generation, bumped each time the index is given back. a handle to a
+ * destroyed entity then never finds whichever entity has its index now.
+ * id 0 is no entity.
+ */
+#define ENTITY_INDEX_BITS   20
+#define ENTITY_INDEX_MASK   ((1u << ENTITY_INDEX_BITS) - 1)
 
 struct c_entity {
     unsigned id;
 
+    unsigned index() const {
+        return id & ENTITY_INDEX_MASK;
+    }
+
+    unsigned generation() const {
+        return id >> ENTITY_INDEX_BITS;
+    }
+
     bool operator==(c_entity const &other) const {
         return this->id == other.id;
     }
@@ -13,8 +27,8 @@ struct c_entity {
         return this->id < other.id;
     }
 
-    static c_entity spawn() {
-        c_entity e = { entities_id_ref++ };
-        return e;
-    }
+    static c_entity spawn();
+
+    /* gives e's index back, once every manager has dropped e's instance */
+    static void destroy(c_entity e);
 };
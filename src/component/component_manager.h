@@ -1,6 +1,8 @@
 #pragma once
 
+#include <assert.h>
 #include <unordered_map>
+#include <vector>
 #include <glm/glm.hpp>
 
 #include "c_entity.h"
@@ -29,28 +31,48 @@ struct component_manager {
         void *buffer;
     } buffer;
 
-    std::unordered_map<c_entity, unsigned> entity_instance_map;
+    /* a sparse set: by entity index, the entity which has an instance here
+     * and where it is. a stale handle doesn't match the entity stored */
+    struct entity_slot {
+        c_entity entity;
+        unsigned index;
+    };
+
+    std::vector<entity_slot> entity_slots;
 
     virtual void create_component_instance_data(unsigned count) = 0;
 
     void assign_entity(c_entity e) {
         auto i = make_instance(buffer.num);
-        entity_instance_map[e] = i.index;
+        set_instance(e, i.index);
         entity(e);
         ++buffer.num;
     }
 
     virtual void entity(c_entity e) = 0;
 
-    bool exists(c_entity  e) {
-        return entity_instance_map.find(e) != entity_instance_map.end();
+    bool exists(c_entity e) const {
+        auto i = e.index();
+        return e.id && i < entity_slots.size() && entity_slots[i].entity == e;
+    }
+
+    instance lookup(c_entity e) const {
+        assert(exists(e));
+        return make_instance(entity_slots[e.index()].index);
+    }
+
+    void set_instance(c_entity e, unsigned index) {
+        if (e.index() >= entity_slots.size())
+            entity_slots.resize(e.index() + 1, { { 0 }, 0 });
+        entity_slots[e.index()] = { e, index };
     }
 
-    instance lookup(c_entity e) {
-        return make_instance(entity_instance_map.find(e)->second);
+    void clear_instance(c_entity e) {
+        if (exists(e))
+            entity_slots[e.index()].entity.id = 0;
     }
 
-    instance make_instance(unsigned i) {
+    instance make_instance(unsigned i) const {
         return { i };
     }
 
@@ -55,15 +55,20 @@ tick_gas_producers(ship_space *ship)
         if (attaches != comms_attaches.end()) {
             std::unordered_set<unsigned> visited_wires;
             for (auto const & sea : attaches->second) {
-                auto wire_index = attach_topo_find(ship, comms, sea);
+                auto wire_index = attach_topo_peek(ship, comms, sea);
                 if (visited_wires.find(wire_index) != visited_wires.end()) {
                     continue;
                 }
 
-                auto const & wire = ship->comms_wires[wire_index];
-
                 visited_wires.insert(wire_index);
 
+                /* find, not [], which would add to the map under the other ticks */
+                auto wire_it = ship->comms_wires.find(wire_index);
+                if (wire_it == ship->comms_wires.end()) {
+                    continue;
+                }
+                auto const & wire = wire_it->second;
+
                 /* now that we have the wire, see if it has any msgs for us */
                 /* todo: origin discrimination */
                 for (auto msg : wire.read_buffer) {
@@ -139,14 +144,16 @@ set_door_state(ship_space *ship, c_entity ce, surface_type s)
         auto yp = glm::ivec3(pos.x, pos.y + 1, pos.z);
 
         /* we'll be calling ensure in set/remove surfaces anyway */
+        /* read both before set_surface writes to the block */
         auto bl = ship->ensure_block(pos);
-        auto surfs = bl->surfs;
+        auto yp_surf = bl->surfs[surface_yp];
+        auto ym_surf = bl->surfs[surface_ym];
 
-        if (surfs[surface_yp] == from_surface) {
+        if (yp_surf == from_surface) {
             ship->set_surface(pos, yp, surface_yp, s);
         }
 
-        if (surfs[surface_ym] == from_surface) {
+        if (ym_surf == from_surface) {
             ship->set_surface(pos, ym, surface_ym, s);
         }
 
@@ -203,7 +210,13 @@ tick_doors(ship_space *ship)
 
 void
 tick_power_consumers(ship_space *ship) {
-    for (auto i = 0u; i < power_man.buffer.num; i++) {
+    tick_power_consumers(ship, 0, power_man.buffer.num);
+}
+
+
+void
+tick_power_consumers(ship_space *ship, unsigned begin, unsigned end) {
+    for (auto i = begin; i < end; i++) {
         auto ce = power_man.instance_pool.entity[i];
 
         if (power_man.instance_pool.max_required_power[i] == 0 &&
@@ -218,9 +231,14 @@ tick_power_consumers(ship_space *ship) {
         }
 
         for (auto sea : attaches->second) {
-            auto wire_index = attach_topo_find(ship, wire_type_power, sea);
+            auto wire_index = attach_topo_peek(ship, wire_type_power, sea);
 
-            auto const & wire = ship->power_wires[wire_index];
+            /* not worked out until after the first tick */
+            auto wire_it = ship->power_wires.find(wire_index);
+            if (wire_it == ship->power_wires.end()) {
+                continue;
+            }
+            auto const & wire = wire_it->second;
 
             if (wire.total_power >= wire.total_draw && wire.total_power > 0) {
                 power_man.instance_pool.powered[i] = true;
@@ -316,15 +334,19 @@ tick_sensor_comparators(ship_space *ship) {
 
         std::unordered_set<unsigned> visited_wires;
         for (auto sea : attaches->second) {
-            auto wire_index = attach_topo_find(ship, type, sea);
+            auto wire_index = attach_topo_peek(ship, type, sea);
             if (visited_wires.find(wire_index) != visited_wires.end()) {
                 continue;
             }
 
-            auto const & wire = ship->comms_wires[wire_index];
-
             visited_wires.insert(wire_index);
 
+            auto wire_it = ship->comms_wires.find(wire_index);
+            if (wire_it == ship->comms_wires.end()) {
+                continue;
+            }
+            auto const & wire = wire_it->second;
+
             /* now that we have the wire, see if it has any msgs for us */
             /* todo: origin discrimination */
             for (auto msg : wire.read_buffer) {
@@ -446,7 +468,13 @@ tick_proximity_sensors(ship_space *ship, player *pl) {
 
 void
 tick_readers(ship_space *ship) {
-    for (auto i = 0u; i < reader_man.buffer.num; i++) {
+    tick_readers(ship, 0, reader_man.buffer.num);
+}
+
+
+void
+tick_readers(ship_space *ship, unsigned begin, unsigned end) {
+    for (auto i = begin; i < end; i++) {
         auto ce = reader_man.instance_pool.entity[i];
 
         auto & comms_attaches = ship->entity_to_attach_lookups[wire_type_comms];
@@ -456,8 +484,12 @@ tick_readers(ship_space *ship) {
         }
 
         for (auto sea : attaches->second) {
-            auto wire_index = attach_topo_find(ship, wire_type_comms, sea);
-            auto const & wire = ship->comms_wires[wire_index];
+            auto wire_index = attach_topo_peek(ship, wire_type_comms, sea);
+            auto wire_it = ship->comms_wires.find(wire_index);
+            if (wire_it == ship->comms_wires.end()) {
+                continue;
+            }
+            auto const & wire = wire_it->second;
 
             for (auto msg : wire.read_buffer) {
                 /* if we're filtering by source, and missed -- skip this one. */
@@ -482,14 +514,22 @@ tick_readers(ship_space *ship) {
 }
 
 
+/* entity meshes carry no bounds of their own, but none reach much further
+ * than this from their origin */
+#define ENTITY_CULL_RADIUS 2.0f
+
+
 void
-draw_renderables(frame_data *frame)
+draw_renderables(frame_data *frame, frustum const & f, chunk_visibility const & vis)
 {
     for (auto i = 0u; i < render_man.buffer.num; i++) {
         auto ce = render_man.instance_pool.entity[i];
         auto & mesh = render_man.instance_pool.mesh[i];
         auto & mat = *pos_man.get_instance_data(ce).mat;
 
+        if (!vis.sphere_visible(f, glm::vec3(mat[3]), ENTITY_CULL_RADIUS))
+            continue;
+
         auto entity_matrix = frame->alloc_aligned<glm::mat4>(1);
         *entity_matrix.ptr = mat;
         entity_matrix.bind(1, frame);
@@ -500,7 +540,7 @@ draw_renderables(frame_data *frame)
 
 
 void
-draw_doors(frame_data *frame)
+draw_doors(frame_data *frame, frustum const & f, chunk_visibility const & vis)
 {
     for (auto i = 0u; i < door_man.buffer.num; i++) {
         auto ce = door_man.instance_pool.entity[i];
@@ -513,6 +553,9 @@ draw_doors(frame_data *frame)
         mat[3][1] += pos * mat[0][1];
         mat[3][2] += pos * mat[0][2];
 
+        if (!vis.sphere_visible(f, glm::vec3(mat[3]), ENTITY_CULL_RADIUS))
+            continue;
+
         auto entity_matrix = frame->alloc_aligned<glm::mat4>(1);
         *entity_matrix.ptr = mat;
         entity_matrix.bind(1, frame);
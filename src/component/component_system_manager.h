@@ -6,6 +6,7 @@
 #include "../render_data.h"
 #include "../ship_space.h"
 #include "../player.h"
+#include "../visibility.h"
 #include "sensor_comparator_component.h"
 #include "gas_production_component.h"
 #include "light_component.h"
@@ -54,6 +55,10 @@ tick_doors(ship_space *ship);
 void
 tick_power_consumers(ship_space *ship);
 
+/* just instances [begin, end), which touch nothing of each other's */
+void
+tick_power_consumers(ship_space *ship, unsigned begin, unsigned end);
+
 void
 tick_light_components(ship_space *ship);
 
@@ -66,14 +71,17 @@ tick_sensor_comparators(ship_space *ship);
 void
 tick_readers(ship_space *ship);
 
+void
+tick_readers(ship_space *ship, unsigned begin, unsigned end);
+
 void
 tick_proximity_sensors(ship_space *ship, player *pl);
 
 void
-draw_renderables(frame_data *frame);
+draw_renderables(frame_data *frame, frustum const & f, chunk_visibility const & vis);
 
 void
-draw_doors(frame_data *frame);
+draw_doors(frame_data *frame, frustum const & f, chunk_visibility const & vis);
 
 void
 set_door_state(ship_space *ship, c_entity ce, surface_type s);
@@ -55,8 +55,8 @@ door_component_manager::destroy_instance(instance i) {
     instance_pool.desired_pos[i.index] = instance_pool.desired_pos[last_index];
     instance_pool.height[i.index] = instance_pool.height[last_index];
 
-    entity_instance_map[last_entity] = i.index;
-    entity_instance_map.erase(current_entity);
+    set_instance(last_entity, i.index);
+    clear_instance(current_entity);
 
     --buffer.num;
 }
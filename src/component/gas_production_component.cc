@@ -55,8 +55,8 @@ gas_production_component_manager::destroy_instance(instance i) {
     instance_pool.max_pressure[i.index] = instance_pool.max_pressure[last_index];
     instance_pool.enabled[i.index] = instance_pool.enabled[last_index];
 
-    entity_instance_map[last_entity] = i.index;
-    entity_instance_map.erase(current_entity);
+    set_instance(last_entity, i.index);
+    clear_instance(current_entity);
 
     --buffer.num;
 }
@@ -47,8 +47,8 @@ light_component_manager::destroy_instance(instance i) {
     instance_pool.intensity[i.index] = instance_pool.intensity[last_index];
     instance_pool.requested_intensity[i.index] = instance_pool.requested_intensity[last_index];
 
-    entity_instance_map[last_entity] = i.index;
-    entity_instance_map.erase(current_entity);
+    set_instance(last_entity, i.index);
+    clear_instance(current_entity);
 
     --buffer.num;
 }
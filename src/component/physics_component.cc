@@ -43,8 +43,8 @@ physics_component_manager::destroy_instance(instance i) {
     instance_pool.entity[i.index] = instance_pool.entity[last_index];
     instance_pool.rigid[i.index] = instance_pool.rigid[last_index];
 
-    entity_instance_map[last_entity] = i.index;
-    entity_instance_map.erase(current_entity);
+    set_instance(last_entity, i.index);
+    clear_instance(current_entity);
 
     --buffer.num;
 }
@@ -51,8 +51,8 @@ power_component_manager::destroy_instance(instance i) {
     instance_pool.powered[i.index] = instance_pool.powered[last_index];
     instance_pool.max_required_power[i.index] = instance_pool.max_required_power[last_index];
 
-    entity_instance_map[last_entity] = i.index;
-    entity_instance_map.erase(current_entity);
+    set_instance(last_entity, i.index);
+    clear_instance(current_entity);
 
     --buffer.num;
 }
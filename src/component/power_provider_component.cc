@@ -47,8 +47,8 @@ power_provider_component_manager::destroy_instance(instance i) {
     instance_pool.max_provided[i.index] = instance_pool.max_provided[last_index];
     instance_pool.provided[i.index] = instance_pool.provided[last_index];
 
-    entity_instance_map[last_entity] = i.index;
-    entity_instance_map.erase(current_entity);
+    set_instance(last_entity, i.index);
+    clear_instance(current_entity);
 
     --buffer.num;
 }
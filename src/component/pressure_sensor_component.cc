@@ -47,8 +47,8 @@ pressure_sensor_component_manager::destroy_instance(instance i) {
     instance_pool.pressure[i.index] = instance_pool.pressure[last_index];
     instance_pool.type[i.index] = instance_pool.type[last_index];
 
-    entity_instance_map[last_entity] = i.index;
-    entity_instance_map.erase(current_entity);
+    set_instance(last_entity, i.index);
+    clear_instance(current_entity);
 
     --buffer.num;
 }
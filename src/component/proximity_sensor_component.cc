@@ -47,8 +47,8 @@ proximity_sensor_component_manager::destroy_instance(instance i) {
     instance_pool.range[i.index] = instance_pool.range[last_index];
     instance_pool.is_detected[i.index] = instance_pool.is_detected[last_index];
 
-    entity_instance_map[last_entity] = i.index;
-    entity_instance_map.erase(current_entity);
+    set_instance(last_entity, i.index);
+    clear_instance(current_entity);
 
     --buffer.num;
 }
@@ -55,8 +55,8 @@ reader_component_manager::destroy_instance(instance i) {
     instance_pool.desc[i.index] = instance_pool.desc[last_index];
     instance_pool.data[i.index] = instance_pool.data[last_index];
 
-    entity_instance_map[last_entity] = i.index;
-    entity_instance_map.erase(current_entity);
+    set_instance(last_entity, i.index);
+    clear_instance(current_entity);
 
     --buffer.num;
 }
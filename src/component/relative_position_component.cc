@@ -47,8 +47,8 @@ relative_position_component_manager::destroy_instance(instance i) {
     instance_pool.position[i.index] = instance_pool.position[last_index];
     instance_pool.mat[i.index] = instance_pool.mat[last_index];
 
-    entity_instance_map[last_entity] = i.index;
-    entity_instance_map.erase(current_entity);
+    set_instance(last_entity, i.index);
+    clear_instance(current_entity);
 
     --buffer.num;
 }
@@ -47,8 +47,8 @@ sensor_comparator_component_manager::destroy_instance(instance i) {
     instance_pool.compare_result[i.index] = instance_pool.compare_result[last_index];
     instance_pool.compare_epsilon[i.index] = instance_pool.compare_epsilon[last_index];
 
-    entity_instance_map[last_entity] = i.index;
-    entity_instance_map.erase(current_entity);
+    set_instance(last_entity, i.index);
+    clear_instance(current_entity);
 
     --buffer.num;
 }
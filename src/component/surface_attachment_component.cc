@@ -47,8 +47,8 @@ surface_attachment_component_manager::destroy_instance(instance i) {
     instance_pool.block[i.index] = instance_pool.block[last_index];
     instance_pool.face[i.index] = instance_pool.face[last_index];
 
-    entity_instance_map[last_entity] = i.index;
-    entity_instance_map.erase(current_entity);
+    set_instance(last_entity, i.index);
+    clear_instance(current_entity);
 
     --buffer.num;
 }
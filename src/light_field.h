@@ -1,36 +1,240 @@
 #pragma once
 
+#include <vector>
 
+#include "light_prop.h"
+#include "ship_space.h"
+
+/* chunks on each axis covered by the brick map. must match the shaders */
+#define LIGHT_MAP_SIZE      32
+
+/* bricks on each of x and y of the atlas; it grows along z as needed.
+ * must match the shaders */
+#define LIGHT_ATLAS_BRICKS  16
+
+
+/* the GPU copy of a light_grid.
+ *
+ * each chunk's levels go up as a CHUNK_SIZE^3 brick in a slot of the atlas,
+ * laid out as they are in the chunk -- z fastest. the brick map is an
+ * indirection texture over a window of LIGHT_MAP_SIZE^3 chunks around the
+ * player, holding each chunk's slot + 1, or 0 if it has none. it is
+ * toroidal: chunk c lives at c mod LIGHT_MAP_SIZE on each axis, so the
+ * shaders look chunks up straight from world positions.
+ *
+ * only chunks in the window hold slots. moving the window frees the slots
+ * of chunks which leave it, and uploads those which come in.
+ */
 struct light_field {
-    GLuint texobj;
-    unsigned char data[128*128*128];
+    GLuint map_tex;
+    GLuint atlas_tex;
+    int atlas_unit;
+    unsigned atlas_layers;      /* of bricks, along z */
+
+    light_grid grid;
+    glm::ivec3 origin;          /* of the window, in chunk coordinates */
+
+    explicit light_field(ship_space *ship)
+        : map_tex(0), atlas_tex(0), atlas_unit(0), atlas_layers(0),
+          grid(ship), origin(0),
+          map(LIGHT_MAP_SIZE * LIGHT_MAP_SIZE * LIGHT_MAP_SIZE), map_dirty(true)
+    {
+        glGenTextures(1, &map_tex);
+        glBindTexture(GL_TEXTURE_3D, map_tex);
+        glTexStorage3D(GL_TEXTURE_3D, 1, GL_R16UI, LIGHT_MAP_SIZE, LIGHT_MAP_SIZE, LIGHT_MAP_SIZE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    light_field() : texobj(0) {
-        glGenTextures(1, &texobj);
-        glBindTexture(GL_TEXTURE_3D, texobj);
-        glTexStorage3D(GL_TEXTURE_3D, 1, GL_R8, 128, 128, 128);
+        grow_atlas();
     }
 
+    /* binds the brick map to texunit, and the atlas to the unit after it */
     void bind(int texunit)
     {
         glActiveTexture(GL_TEXTURE0 + texunit);
-        glBindTexture(GL_TEXTURE_3D, texobj);
+        glBindTexture(GL_TEXTURE_3D, map_tex);
+
+        atlas_unit = texunit + 1;
+        glActiveTexture(GL_TEXTURE0 + atlas_unit);
+        glBindTexture(GL_TEXTURE_3D, atlas_tex);
+    }
+
+    bool in_window(glm::ivec3 ch) const
+    {
+        glm::ivec3 o = ch - origin;
+        return o.x >= 0 && o.x < LIGHT_MAP_SIZE &&
+               o.y >= 0 && o.y < LIGHT_MAP_SIZE &&
+               o.z >= 0 && o.z < LIGHT_MAP_SIZE;
     }
 
+    /* slides the window to start at chunk coordinates o */
+    void move_window(glm::ivec3 o)
+    {
+        if (o == origin)
+            return;
+
+        glm::ivec3 old_origin = origin;
+        origin = o;
+
+        /* each cell of the map stands for the one chunk in the window which
+         * lands on it. cells whose chunk has changed start again. */
+        for (int z = 0; z < LIGHT_MAP_SIZE; z++) {
+            for (int y = 0; y < LIGHT_MAP_SIZE; y++) {
+                for (int x = 0; x < LIGHT_MAP_SIZE; x++) {
+                    glm::ivec3 cell(x, y, z);
+                    glm::ivec3 ch = window_chunk(origin, cell);
+                    if (ch == window_chunk(old_origin, cell))
+                        continue;
+
+                    uint16_t & m = map[map_index(ch)];
+                    if (m) {
+                        free_slots.push_back(m - 1u);
+                        m = 0;
+                        map_dirty = true;
+                    }
+
+                    chunk *c = grid.ship->chunks.get(ch);
+                    if (c && is_lit(c))
+                        upload_brick(ch, c);
+                }
+            }
+        }
+    }
+
+    /* uploads the bricks of chunks in the window which have changed since
+     * the last upload, and the map if any chunk has gained or lost a slot */
     void upload()
     {
-        /* TODO: toroidal addressing + partial updates, to make these uploads VERY small */
-        /* TODO: experiment with buffer texture rather than 3D, so we can have the light field
-         * persistently mapped in our address space */
+        for (auto ch : grid.dirty_chunks) {
+            /* chunks outside the window go up when it reaches them */
+            if (!in_window(ch))
+                continue;
+
+            chunk *c = grid.ship->chunks.get(ch);
+            if (c)
+                upload_brick(ch, c);
+        }
+
+        grid.clear_dirty();
+
+        if (map_dirty) {
+            /* DSA would be nice -- for now, we'll just disturb the tex0 binding */
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_3D, map_tex);
+
+            glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0,
+                            LIGHT_MAP_SIZE, LIGHT_MAP_SIZE, LIGHT_MAP_SIZE,
+                            GL_RED_INTEGER,
+                            GL_UNSIGNED_SHORT,
+                            map.data());
+
+            map_dirty = false;
+        }
+    }
+
+private:
+    std::vector<uint16_t> map;          /* CPU copy of map_tex */
+    std::vector<unsigned> free_slots;
+    bool map_dirty;
+
+    static int wrap(int v)
+    {
+        return v & (LIGHT_MAP_SIZE - 1);
+    }
+
+    static size_t map_index(glm::ivec3 ch)
+    {
+        return wrap(ch.x) + (size_t)LIGHT_MAP_SIZE * (wrap(ch.y) + (size_t)LIGHT_MAP_SIZE * wrap(ch.z));
+    }
+
+    /* the chunk in the window starting at o which lands on cell */
+    static glm::ivec3 window_chunk(glm::ivec3 o, glm::ivec3 cell)
+    {
+        return o + glm::ivec3(wrap(cell.x - o.x), wrap(cell.y - o.y), wrap(cell.z - o.z));
+    }
+
+    static bool is_lit(chunk *c)
+    {
+        auto const & levels = c->light_chunk.levels.contents;
+        unsigned char const *p = &levels[0][0][0];
+        for (size_t i = 0; i < sizeof(levels); i++) {
+            if (p[i])
+                return true;
+        }
+
+        return false;
+    }
+
+    static glm::ivec3 slot_offset(unsigned slot)
+    {
+        return CHUNK_SIZE * glm::ivec3(slot % LIGHT_ATLAS_BRICKS,
+                                       slot / LIGHT_ATLAS_BRICKS % LIGHT_ATLAS_BRICKS,
+                                       slot / (LIGHT_ATLAS_BRICKS * LIGHT_ATLAS_BRICKS));
+    }
+
+    /* doubles the atlas along z. existing slots keep their place, so every
+     * brick in use is put back where it was. */
+    void grow_atlas()
+    {
+        unsigned old_layers = atlas_layers;
+        atlas_layers = old_layers ? old_layers * 2 : 4;
+
+        if (atlas_tex)
+            glDeleteTextures(1, &atlas_tex);
+
+        glGenTextures(1, &atlas_tex);
+        glBindTexture(GL_TEXTURE_3D, atlas_tex);
+        glTexStorage3D(GL_TEXTURE_3D, 1, GL_R8,
+                       LIGHT_ATLAS_BRICKS * CHUNK_SIZE,
+                       LIGHT_ATLAS_BRICKS * CHUNK_SIZE,
+                       atlas_layers * CHUNK_SIZE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        /* hand out low slots first */
+        unsigned per_layer = LIGHT_ATLAS_BRICKS * LIGHT_ATLAS_BRICKS;
+        for (unsigned slot = per_layer * atlas_layers; slot-- > per_layer * old_layers; ) {
+            free_slots.push_back(slot);
+        }
+
+        for (int z = 0; z < LIGHT_MAP_SIZE; z++) {
+            for (int y = 0; y < LIGHT_MAP_SIZE; y++) {
+                for (int x = 0; x < LIGHT_MAP_SIZE; x++) {
+                    glm::ivec3 ch = window_chunk(origin, glm::ivec3(x, y, z));
+                    if (map[map_index(ch)])
+                        upload_brick(ch, grid.ship->chunks.get(ch));
+                }
+            }
+        }
+
+        if (atlas_unit) {
+            glActiveTexture(GL_TEXTURE0 + atlas_unit);
+            glBindTexture(GL_TEXTURE_3D, atlas_tex);
+        }
+    }
+
+    /* uploads c's levels into its slot, giving it one if it has none */
+    void upload_brick(glm::ivec3 ch, chunk *c)
+    {
+        uint16_t & m = map[map_index(ch)];
+        if (!m) {
+            if (free_slots.empty())
+                grow_atlas();
+
+            m = (uint16_t)(free_slots.back() + 1);
+            free_slots.pop_back();
+            map_dirty = true;
+        }
+
+        glm::ivec3 o = slot_offset(m - 1u);
 
-        /* DSA would be nice -- for now, we'll just disturb the tex0 binding */
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_3D, texobj);
+        glBindTexture(GL_TEXTURE_3D, atlas_tex);
 
-        glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0,
-                        128, 128, 128,
+        glTexSubImage3D(GL_TEXTURE_3D, 0, o.x, o.y, o.z,
+                        CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE,
                         GL_RED,
                         GL_UNSIGNED_BYTE,
-                        data);
+                        c->light_chunk.levels.contents);
     }
 };
@@ -0,0 +1,116 @@
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIGHT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include "light_kernel.h"
+#include "light_prop.h"
+
+
+/* where each block takes light from through face f, relative to itself */
+static const int face_offsets[face_count] = {
+    LIGHT_PAD * LIGHT_PAD, -LIGHT_PAD * LIGHT_PAD,
+    LIGHT_PAD, -LIGHT_PAD,
+    1, -1,
+};
+
+/* the chunk's blocks lie between these; anything else in between is halo */
+static const int first_block = light_pad::index(1, 1, 1);
+static const int end_block = light_pad::index(CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE) + 1;
+
+
+void
+light_pad::load_faces(chunk_faces const *faces)
+{
+    memset(open, 0, sizeof(open));
+
+    for (int f = 0; f < face_count; f++) {
+        unsigned bi = 0;
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            for (int y = 0; y < CHUNK_SIZE; y++) {
+                uint8_t *row = &open[f][index(x + 1, y + 1, 1)];
+                for (int z = 0; z < CHUNK_SIZE; z++, bi++) {
+                    row[z] = faces->light_open(bi, f) ? 0xff : 0;
+                }
+            }
+        }
+    }
+}
+
+
+bool
+light_sweep_scalar(light_pad *pad)
+{
+    bool changed = false;
+
+    for (int i = first_block; i < end_block; i++) {
+        uint8_t old = pad->levels[i];
+        uint8_t level = old;
+
+        for (int f = 0; f < face_count; f++) {
+            int n = pad->levels[i + face_offsets[f]] - LIGHT_ATTEN;
+            if (n > level && pad->open[f][i])
+                level = (uint8_t)n;
+        }
+
+        if (level != old) {
+            pad->levels[i] = level;
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+
+bool
+light_sweep(light_pad *pad)
+{
+    /* the blocks are swept a vector at a time, halo and all. the halo's
+     * faces are all closed, so it comes out as it went in. */
+#if defined(__AVX2__)
+    __m256i atten = _mm256_set1_epi8(LIGHT_ATTEN);
+    int changed = 0;
+
+    for (int i = first_block; i < end_block; i += 32) {
+        __m256i old = _mm256_loadu_si256((__m256i const *)(pad->levels + i));
+        __m256i level = old;
+
+        for (int f = 0; f < face_count; f++) {
+            __m256i n = _mm256_loadu_si256((__m256i const *)(pad->levels + i + face_offsets[f]));
+            __m256i open = _mm256_loadu_si256((__m256i const *)(pad->open[f] + i));
+            level = _mm256_max_epu8(level, _mm256_and_si256(_mm256_subs_epu8(n, atten), open));
+        }
+
+        _mm256_storeu_si256((__m256i *)(pad->levels + i), level);
+        changed |= ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(level, old));
+    }
+
+    return changed != 0;
+#elif defined(LIGHT_SSE2)
+    __m128i atten = _mm_set1_epi8(LIGHT_ATTEN);
+    int changed = 0;
+
+    for (int i = first_block; i < end_block; i += 16) {
+        __m128i old = _mm_loadu_si128((__m128i const *)(pad->levels + i));
+        __m128i level = old;
+
+        for (int f = 0; f < face_count; f++) {
+            __m128i n = _mm_loadu_si128((__m128i const *)(pad->levels + i + face_offsets[f]));
+            __m128i open = _mm_loadu_si128((__m128i const *)(pad->open[f] + i));
+            level = _mm_max_epu8(level, _mm_and_si128(_mm_subs_epu8(n, atten), open));
+        }
+
+        _mm_storeu_si128((__m128i *)(pad->levels + i), level);
+        changed |= _mm_movemask_epi8(_mm_cmpeq_epi8(level, old)) ^ 0xffff;
+    }
+
+    return changed != 0;
+#else
+    return light_sweep_scalar(pad);
+#endif
+}
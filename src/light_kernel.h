@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "block.h"
+#include "chunk.h"
+
+/* a chunk with a one-block halo on each side */
+#define LIGHT_PAD           (CHUNK_SIZE + 2)
+#define LIGHT_PAD_VOLUME    (LIGHT_PAD * LIGHT_PAD * LIGHT_PAD)
+
+/* room past the end of the grid for the widest vector to run over */
+#define LIGHT_PAD_ALLOC     (LIGHT_PAD_VOLUME + 32)
+
+/* a chunk's light levels, and its neighbours' along each side, laid out as
+ * in fixed_cube -- x slowest, z fastest -- with the chunk's block (x,y,z) at
+ * (x+1,y+1,z+1).
+ *
+ * open[f] is 0xff where a block can take light through its face f, and 0
+ * elsewhere. halo blocks have no open faces, so a sweep never changes them.
+ */
+struct light_pad {
+    alignas(32) uint8_t levels[LIGHT_PAD_ALLOC];
+    alignas(32) uint8_t open[face_count][LIGHT_PAD_ALLOC];
+
+    static int index(int x, int y, int z)
+    {
+        return (x * LIGHT_PAD + y) * LIGHT_PAD + z;
+    }
+
+    /* fills in open[] from the chunk's light bitplanes */
+    void load_faces(chunk_faces const *faces);
+};
+
+/* one in-place pass of level = max(level, neighbour - LIGHT_ATTEN) through
+ * every open face of every block. returns whether anything changed; repeat
+ * until it doesn't for the chunk's light given its halo.
+ *
+ * uses AVX2 or SSE2 where the compiler allows it.
+ */
+bool light_sweep(light_pad *pad);
+
+/* as light_sweep, one block at a time */
+bool light_sweep_scalar(light_pad *pad);
@@ -0,0 +1,283 @@
+#include <string.h>
+#include <unordered_set>
+
+#include "light_kernel.h"
+#include "light_prop.h"
+#include "ship_space.h"
+
+
+unsigned char
+light_grid::get(glm::ivec3 p)
+{
+    glm::ivec3 bl, ch;
+    split_block_coord(p, &bl, &ch);
+
+    chunk *c = ship->get_chunk(ch);
+    if (!c)
+        return 0;
+
+    return *c->light_chunk.levels.get(bl.x, bl.y, bl.z);
+}
+
+
+void
+light_grid::set(glm::ivec3 p, int level)
+{
+    glm::ivec3 bl, ch;
+    split_block_coord(p, &bl, &ch);
+
+    chunk *c = ship->get_chunk(ch);
+    if (!c)
+        return;
+
+    if (level < 0) level = 0;
+    if (level > 255) level = 255;
+
+    unsigned char *d = c->light_chunk.levels.get(bl.x, bl.y, bl.z);
+    if (*d == level)
+        return;
+
+    *d = (unsigned char)level;
+    mark_dirty(ch, c);
+}
+
+
+void
+light_grid::mark_dirty(glm::ivec3 ch, chunk *c)
+{
+    if (!c->light_chunk.dirty) {
+        c->light_chunk.dirty = true;
+        dirty_chunks.push_back(ch);
+    }
+}
+
+
+void
+light_grid::clear_dirty()
+{
+    for (auto ch : dirty_chunks) {
+        chunk *c = ship->get_chunk(ch);
+        if (c)
+            c->light_chunk.dirty = false;
+    }
+
+    dirty_chunks.clear();
+}
+
+
+void
+light_propagator::remove(glm::ivec3 p)
+{
+    unsigned char level = get(p);
+    if (!level)
+        return;
+
+    set(p, 0);
+    remove_queue.push_back(std::make_pair(p, level));
+}
+
+
+void
+light_propagator::invalidate(glm::ivec3 p)
+{
+    /* light crossing any of p's faces may have changed, in either direction */
+    remove(p);
+    for (int face = 0; face < face_count; face++) {
+        remove(p + surface_index_to_normal(face));
+    }
+}
+
+
+void
+light_propagator::add_source(glm::ivec3 p, int level)
+{
+    sources.push_back(std::make_pair(p, level));
+}
+
+
+void
+light_propagator::propagate()
+{
+    /* 1. take out everything downhill of the removed blocks. this ignores
+     * surfaces: one which has just been added may have let light through
+     * before. anything at least as bright as the block it was reached from
+     * was lit by something else, and gets spread back out in step 3. */
+    for (size_t head = 0; head < remove_queue.size(); head++) {
+        glm::ivec3 p = remove_queue[head].first;
+        unsigned char level = remove_queue[head].second;
+
+        for (int face = 0; face < face_count; face++) {
+            glm::ivec3 q = p + surface_index_to_normal(face);
+            unsigned char ql = get(q);
+            if (!ql)
+                continue;
+
+            if (ql < level) {
+                set(q, 0);
+                remove_queue.push_back(std::make_pair(q, ql));
+            }
+            else {
+                add_queue.push_back(q);
+            }
+        }
+    }
+
+    remove_queue.clear();
+
+    /* 2. light up the sources. removal may have darkened any of them */
+    for (auto const & s : sources) {
+        if (get(s.first) < s.second) {
+            set(s.first, s.second);
+            add_queue.push_back(s.first);
+        }
+    }
+
+    sources.clear();
+
+    /* 3. spread light into any neighbour which can see p, and is darker
+     * than p's light would make it */
+    for (size_t head = 0; head < add_queue.size(); head++) {
+        glm::ivec3 p = add_queue[head];
+        int level = get(p) - LIGHT_ATTEN;
+        if (level <= 0)
+            continue;
+
+        for (int face = 0; face < face_count; face++) {
+            glm::ivec3 q = p + surface_index_to_normal(face);
+            if (get(q) >= level)
+                continue;
+
+            glm::ivec3 bl, ch;
+            split_block_coord(q, &bl, &ch);
+            chunk *c = ship->get_chunk(ch);
+            if (!c || !c->faces.light_open(chunk_block_index(bl.x, bl.y, bl.z), face ^ 1))
+                continue;
+
+            set(q, level);
+            add_queue.push_back(q);
+        }
+    }
+
+    add_queue.clear();
+}
+
+
+/* copies the layer of a neighbour's levels which touches the chunk on side
+ * face into that side of pad's halo */
+static void
+copy_layer(unsigned char const (*levels)[CHUNK_SIZE][CHUNK_SIZE], int face, light_pad *pad)
+{
+    glm::ivec3 n = surface_index_to_normal(face);
+    int src = n.x + n.y + n.z > 0 ? 0 : CHUNK_SIZE - 1;
+    int dst = n.x + n.y + n.z > 0 ? CHUNK_SIZE + 1 : 0;
+
+    for (int a = 0; a < CHUNK_SIZE; a++) {
+        for (int b = 0; b < CHUNK_SIZE; b++) {
+            if (n.x)
+                pad->levels[light_pad::index(dst, a + 1, b + 1)] = levels[src][a][b];
+            else if (n.y)
+                pad->levels[light_pad::index(a + 1, dst, b + 1)] = levels[a][src][b];
+            else
+                pad->levels[light_pad::index(a + 1, b + 1, dst)] = levels[a][b][src];
+        }
+    }
+}
+
+
+void
+light_propagator::rebuild()
+{
+    remove_queue.clear();
+    add_queue.clear();
+
+    /* 1. everything goes dark. chunks which aren't resident have no light
+     * to lose */
+    for (auto & e : ship->chunks) {
+        memset(&e.second->light_chunk.levels, 0, sizeof(e.second->light_chunk.levels));
+        grid->mark_dirty(e.first, e.second);
+    }
+
+    /* 2. the sources go in, and their chunks are swept first */
+    std::vector<glm::ivec3> work;
+    std::unordered_set<glm::ivec3, ivec3_hash> queued;
+
+    for (auto const & s : sources) {
+        if (get(s.first) < s.second)
+            set(s.first, s.second);
+
+        glm::ivec3 ch;
+        split_block_coord(s.first, nullptr, &ch);
+        if (ship->get_chunk(ch) && queued.insert(ch).second)
+            work.push_back(ch);
+    }
+
+    sources.clear();
+
+    /* 3. sweep each chunk until its light settles, given what its
+     * neighbours shine into it. any side whose edge changed lets more light
+     * into the chunk beyond, which goes back on the list. */
+    light_pad pad;
+    memset(&pad, 0, sizeof(pad));
+
+    while (!work.empty()) {
+        glm::ivec3 ch = work.back();
+        work.pop_back();
+        queued.erase(ch);
+
+        chunk *c = ship->get_chunk(ch);
+        auto & levels = c->light_chunk.levels.contents;
+
+        memset(pad.levels, 0, sizeof(pad.levels));
+        for (int face = 0; face < face_count; face++) {
+            chunk *nc = ship->chunks.get(ch + surface_index_to_normal(face));
+            if (nc)
+                copy_layer(nc->light_chunk.levels.contents, face, &pad);
+        }
+
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            for (int y = 0; y < CHUNK_SIZE; y++) {
+                memcpy(&pad.levels[light_pad::index(x + 1, y + 1, 1)], levels[x][y], CHUNK_SIZE);
+            }
+        }
+
+        pad.load_faces(&c->faces);
+
+        if (!light_sweep(&pad))
+            continue;
+
+        while (light_sweep(&pad))
+            ;
+
+        /* which sides' edges changed */
+        bool edge_changed[face_count] = {};
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            for (int y = 0; y < CHUNK_SIZE; y++) {
+                unsigned char *row = &pad.levels[light_pad::index(x + 1, y + 1, 1)];
+                if (!memcmp(row, levels[x][y], CHUNK_SIZE))
+                    continue;
+
+                edge_changed[surface_xm] |= x == 0;
+                edge_changed[surface_xp] |= x == CHUNK_SIZE - 1;
+                edge_changed[surface_ym] |= y == 0;
+                edge_changed[surface_yp] |= y == CHUNK_SIZE - 1;
+
+                for (int z = 0; z < CHUNK_SIZE; z++) {
+                    if (row[z] != levels[x][y][z]) {
+                        edge_changed[surface_zm] |= z == 0;
+                        edge_changed[surface_zp] |= z == CHUNK_SIZE - 1;
+                    }
+                }
+
+                memcpy(levels[x][y], row, CHUNK_SIZE);
+            }
+        }
+
+        grid->mark_dirty(ch, c);
+
+        for (int face = 0; face < face_count; face++) {
+            glm::ivec3 nch = ch + surface_index_to_normal(face);
+            if (edge_changed[face] && ship->get_chunk(nch) && queued.insert(nch).second)
+                work.push_back(nch);
+        }
+    }
+}
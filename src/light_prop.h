@@ -0,0 +1,95 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+
+struct chunk;
+struct ship_space;
+
+/* light lost per block travelled */
+#define LIGHT_ATTEN         50
+
+/* light levels for the whole ship, one byte per block.
+ *
+ * levels live in each chunk's light_chunk, so light reaches anywhere the
+ * ship does, including negative space. blocks with no chunk read as unlit,
+ * and ignore writes.
+ */
+struct light_grid {
+    ship_space *ship;
+
+    /* chunks whose levels changed since clear_dirty(), by chunk coordinates */
+    std::vector<glm::ivec3> dirty_chunks;
+
+    explicit light_grid(ship_space *ship) : ship(ship) {}
+
+    unsigned char get(glm::ivec3 p);
+    void set(glm::ivec3 p, int level);
+
+    /* forgets which chunks have changed, once they have been uploaded */
+    void clear_dirty();
+
+    /* the levels of chunk c, at chunk coordinates ch, have been changed
+     * behind set()'s back */
+    void mark_dirty(glm::ivec3 ch, chunk *c);
+};
+
+/* incremental light propagation over a light_grid.
+ *
+ * a block's level is the brightest of any source on it, and of each
+ * neighbour it can see through one of its own faces, less LIGHT_ATTEN.
+ *
+ * rather than clearing and re-sweeping a box around every change, light is
+ * taken out and put back with two queues, as voxel engines do:
+ *
+ *  - invalidate() zeroes a changed block and its neighbours, and queues
+ *    them for removal. the removal flood zeroes everything downhill of them
+ *    -- anything which may have been lit through them -- and queues the
+ *    brighter blocks it runs into, which were lit some other way.
+ *  - add_source() queues a light source, to raise its block to its level
+ *    once removal is done.
+ *  - propagate() runs the removal flood, puts the sources in, then spreads
+ *    light out from everything queued, only ever touching blocks whose
+ *    level goes up.
+ *
+ * so the work done is proportional to the area actually relit.
+ *
+ * when most of the ship changes at once -- after a load -- rebuild() is
+ * cheaper: it throws everything away and relights chunk by chunk, sweeping
+ * each with the vectorized kernel in light_kernel.h.
+ */
+struct light_propagator {
+    ship_space *ship;
+    light_grid *grid;
+
+    explicit light_propagator(light_grid *grid)
+        : ship(grid->ship), grid(grid)
+    {
+    }
+
+    unsigned char get(glm::ivec3 p) { return grid->get(p); }
+    void set(glm::ivec3 p, int level) { grid->set(p, level); }
+
+    /* something about the block at p has changed -- its surfaces, or a light
+     * on it. takes out any light which may have passed through it. */
+    void invalidate(glm::ivec3 p);
+
+    /* a light source of the given level sits on p. sources must be added
+     * again after any invalidate() which may have covered them; adding one
+     * which is already lit costs nothing. */
+    void add_source(glm::ivec3 p, int level);
+
+    void propagate();
+
+    /* relights the whole ship from nothing but the sources added since the
+     * last propagate(). pending invalidations are moot. */
+    void rebuild();
+
+private:
+    std::vector<std::pair<glm::ivec3, unsigned char>> remove_queue;     /* with the level removed */
+    std::vector<std::pair<glm::ivec3, int>> sources;
+    std::vector<glm::ivec3> add_queue;
+
+    void remove(glm::ivec3 p);
+};
@@ -2,7 +2,9 @@
 
 #include <glm/glm.hpp>
 #include <epoxy/gl.h>
+#include <stdint.h>
 
+#include "chunk_size.h"
 #include "wiring/wiring_data.h"
 
 struct hw_mesh {
@@ -34,6 +36,44 @@ struct vertex {
     }
 };
 
+/* fixed-point scale of world_vertex positions: 1/4096 of a block at the
+ * usual CHUNK_SIZE of 8, and coarser for larger chunks, so that a uint16_t
+ * always covers twice the width of a chunk */
+#define WORLD_VERTEX_SCALE (32768.0f / CHUNK_SIZE)
+
+/* compact vertex for chunk geometry: 12 bytes rather than vertex's 28.
+ *
+ * positions are relative to the chunk, in units of 1/WORLD_VERTEX_SCALE of a
+ * block, and are fed to the shader unnormalized -- the chunk's world matrix
+ * carries the scale back out. normals are signed-normalized bytes, which
+ * unlike packed 10:10:10:2 are safe everywhere.
+ */
+struct world_vertex {
+    uint16_t x, y, z;
+    uint16_t mat;
+    int8_t nx, ny, nz;
+    int8_t pad;
+
+    world_vertex() : x(0), y(0), z(0), mat(0), nx(0), ny(0), nz(0), pad(0) {}
+
+    explicit world_vertex(vertex const & v)
+        : x((uint16_t)(v.x * WORLD_VERTEX_SCALE + 0.5f)),
+          y((uint16_t)(v.y * WORLD_VERTEX_SCALE + 0.5f)),
+          z((uint16_t)(v.z * WORLD_VERTEX_SCALE + 0.5f)),
+          mat((uint16_t)v.mat),
+          nx(pack_snorm8(v.nx)),
+          ny(pack_snorm8(v.ny)),
+          nz(pack_snorm8(v.nz)),
+          pad(0)
+    {
+    }
+
+    static int8_t pack_snorm8(float f)
+    {
+        return (int8_t)(f * 127.0f + (f < 0 ? -0.5f : 0.5f));
+    }
+};
+
 struct sw_mesh {
     vertex *verts;
     unsigned int *indices;
@@ -0,0 +1,217 @@
+#include <epoxy/gl.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "mesh_arena.h"
+
+
+mesh_arena::mesh_arena(unsigned vertex_capacity, unsigned index_capacity)
+    : vbo(0), ibo(0), vao(0), draw_id_bo(0), multi_draw(false),
+      vertex_ranges(vertex_capacity), index_ranges(index_capacity)
+{
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertex_capacity * sizeof(world_vertex), nullptr, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &ibo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+    glBufferData(GL_COPY_WRITE_BUFFER, index_capacity * sizeof(unsigned), nullptr, GL_DYNAMIC_DRAW);
+
+    /* base_instance in an indirect command is only honored with ARB_base_instance;
+     * without it every chunk would get draw id 0 */
+    multi_draw = epoxy_gl_version() >= 43 ||
+        (epoxy_has_gl_extension("GL_ARB_multi_draw_indirect") &&
+         epoxy_has_gl_extension("GL_ARB_base_instance"));
+
+    printf("mesh_arena: multi-draw indirect %s\n", multi_draw ? "enabled" : "not available");
+
+    GLuint draw_ids[INSTANCE_BATCH_SIZE];
+    for (auto i = 0u; i < INSTANCE_BATCH_SIZE; i++) {
+        draw_ids[i] = i;
+    }
+
+    glGenBuffers(1, &draw_id_bo);
+    glBindBuffer(GL_ARRAY_BUFFER, draw_id_bo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(draw_ids), draw_ids, GL_STATIC_DRAW);
+
+    glGenVertexArrays(1, &vao);
+    setup_vao();
+}
+
+
+mesh_arena::~mesh_arena()
+{
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ibo);
+    glDeleteBuffers(1, &draw_id_bo);
+    glDeleteVertexArrays(1, &vao);
+}
+
+
+void
+mesh_arena::setup_vao()
+{
+    glBindVertexArray(vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(world_vertex), (GLvoid const *)offsetof(world_vertex, x));
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_SHORT, sizeof(world_vertex), (GLvoid const *)offsetof(world_vertex, mat));
+
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_BYTE, GL_TRUE, sizeof(world_vertex), (GLvoid const *)offsetof(world_vertex, nx));
+
+    /* without multi-draw, attribute 3 is left disabled and draw_batch sets
+     * its current value before each draw instead */
+    if (multi_draw) {
+        glBindBuffer(GL_ARRAY_BUFFER, draw_id_bo);
+        glEnableVertexAttribArray(3);
+        glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(GLuint), nullptr);
+        glVertexAttribDivisor(3, 1);
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+}
+
+
+/* replaces buf with one of new_size bytes holding the first old_size bytes of it */
+static void
+grow_buffer(GLuint *buf, size_t old_size, size_t new_size)
+{
+    GLuint nbuf;
+    glGenBuffers(1, &nbuf);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, nbuf);
+    glBufferData(GL_COPY_WRITE_BUFFER, new_size, nullptr, GL_DYNAMIC_DRAW);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, *buf);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_size);
+
+    glDeleteBuffers(1, buf);
+    *buf = nbuf;
+}
+
+
+void
+mesh_arena::grow(unsigned min_vertices, unsigned min_indices)
+{
+    unsigned old_vertices = vertex_ranges.get_capacity();
+    unsigned old_indices = index_ranges.get_capacity();
+    unsigned new_vertices = old_vertices;
+    unsigned new_indices = old_indices;
+
+    while (new_vertices < min_vertices)
+        new_vertices = new_vertices ? new_vertices * 2 : min_vertices;
+    while (new_indices < min_indices)
+        new_indices = new_indices ? new_indices * 2 : min_indices;
+
+    if (new_vertices != old_vertices) {
+        grow_buffer(&vbo, old_vertices * sizeof(world_vertex), new_vertices * sizeof(world_vertex));
+        vertex_ranges.grow(new_vertices);
+    }
+
+    if (new_indices != old_indices) {
+        grow_buffer(&ibo, old_indices * sizeof(unsigned), new_indices * sizeof(unsigned));
+        index_ranges.grow(new_indices);
+    }
+
+    setup_vao();
+
+    printf("mesh_arena: grown to %u vertices, %u indices, vram_size=%.1fKB\n",
+           new_vertices, new_indices,
+           (new_vertices * sizeof(world_vertex) + new_indices * sizeof(unsigned)) / 1024.0f);
+}
+
+
+void
+mesh_arena::upload(arena_mesh *m, world_vertex const *verts, unsigned num_vertices,
+                   unsigned const *indices, unsigned num_indices)
+{
+    assert(m->empty());
+
+    if (!num_indices)
+        return;
+
+    unsigned base_vertex, first_index;
+    while ((base_vertex = vertex_ranges.alloc(num_vertices)) == range_allocator::invalid)
+        grow(vertex_ranges.get_capacity() + num_vertices, 0);
+    while ((first_index = index_ranges.alloc(num_indices)) == range_allocator::invalid)
+        grow(0, index_ranges.get_capacity() + num_indices);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, base_vertex * sizeof(world_vertex),
+                    num_vertices * sizeof(world_vertex), verts);
+
+    /* the element buffer binding is VAO state; go through the copy target
+     * rather than disturbing whatever VAO is bound */
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, first_index * sizeof(unsigned),
+                    num_indices * sizeof(unsigned), indices);
+
+    m->base_vertex = base_vertex;
+    m->num_vertices = num_vertices;
+    m->first_index = first_index;
+    m->num_indices = num_indices;
+}
+
+
+void
+mesh_arena::free(arena_mesh *m)
+{
+    if (m->empty())
+        return;
+
+    vertex_ranges.free(m->base_vertex, m->num_vertices);
+    index_ranges.free(m->first_index, m->num_indices);
+    *m = arena_mesh();
+}
+
+
+void
+mesh_arena::bind()
+{
+    glBindVertexArray(vao);
+}
+
+
+void
+mesh_arena::draw(arena_mesh const *m)
+{
+    if (m->empty())
+        return;
+
+    glDrawElementsBaseVertex(GL_TRIANGLES, m->num_indices, GL_UNSIGNED_INT,
+                             (GLvoid const *)(m->first_index * sizeof(unsigned)),
+                             m->base_vertex);
+}
+
+
+void
+mesh_arena::draw_batch(arena_mesh const * const *meshes, unsigned count, frame_data *frame)
+{
+    assert(count <= INSTANCE_BATCH_SIZE);
+
+    if (!multi_draw) {
+        for (auto i = 0u; i < count; i++) {
+            glVertexAttribI4ui(3, i, 0, 0, 0);
+            draw(meshes[i]);
+        }
+        return;
+    }
+
+    auto commands = frame->alloc_aligned<draw_elements_indirect_command>(count);
+    for (auto i = 0u; i < count; i++) {
+        auto & cmd = commands.ptr[i];
+        cmd.count = meshes[i]->num_indices;
+        cmd.instance_count = 1;
+        cmd.first_index = meshes[i]->first_index;
+        cmd.base_vertex = (GLint)meshes[i]->base_vertex;
+        cmd.base_instance = i;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, frame->bo);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                (GLvoid const *)commands.off, count, 0);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <epoxy/gl.h>
+
+#include "mesh.h"
+#include "range_allocator.h"
+#include "render_data.h"
+
+/* where one mesh lives within a mesh_arena. indices are relative to
+ * base_vertex, so a mesh can be moved about without rewriting them. */
+struct arena_mesh {
+    unsigned base_vertex = 0;
+    unsigned num_vertices = 0;
+    unsigned first_index = 0;
+    unsigned num_indices = 0;
+
+    bool empty() const { return num_indices == 0; }
+};
+
+/* one command in a GL_DRAW_INDIRECT_BUFFER, as glMultiDrawElementsIndirect reads it */
+struct draw_elements_indirect_command {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+};
+
+/* one big vertex buffer and one big index buffer, shared by many small
+ * world_vertex meshes, with a single VAO over the lot.
+ *
+ * chunk meshes come and go constantly as the ship is edited. giving each
+ * its own buffers and VAO meant a round of buffer churn per edit and a
+ * VAO switch per chunk drawn; here a rebuilt mesh goes back into a hole
+ * in the same buffers, and drawing is just bind() once, then draw() per
+ * mesh with a base vertex.
+ *
+ * the buffers double in size when they fill up.
+ *
+ * draw_batch() submits up to INSTANCE_BATCH_SIZE meshes at once, as a single
+ * glMultiDrawElementsIndirect where the driver has it. each mesh sees its
+ * position in the batch as vertex attribute 3, for picking out its
+ * transform -- see shaders/chunk.vert.
+ */
+struct mesh_arena {
+    GLuint vbo;
+    GLuint ibo;
+    GLuint vao;
+    GLuint draw_id_bo;      /* 0..INSTANCE_BATCH_SIZE-1, fed to attribute 3 per instance */
+    bool multi_draw;        /* GL_ARB_multi_draw_indirect and GL_ARB_base_instance */
+
+    mesh_arena(unsigned vertex_capacity, unsigned index_capacity);
+    ~mesh_arena();
+
+    /* copies the mesh into the arena. m must be empty. */
+    void upload(arena_mesh *m, world_vertex const *verts, unsigned num_vertices,
+                unsigned const *indices, unsigned num_indices);
+
+    /* gives m's space back to the arena, and leaves m empty */
+    void free(arena_mesh *m);
+
+    /* binds the shared VAO; do this once before draw()ing any meshes */
+    void bind();
+    void draw(arena_mesh const *m);
+
+    /* draws count <= INSTANCE_BATCH_SIZE meshes, giving meshes[i] draw id i.
+     * the indirect commands, if any, are allocated from frame. */
+    void draw_batch(arena_mesh const * const *meshes, unsigned count, frame_data *frame);
+
+private:
+    range_allocator vertex_ranges;
+    range_allocator index_ranges;
+
+    void grow(unsigned min_vertices, unsigned min_indices);
+    void setup_vao();
+};
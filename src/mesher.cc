@@ -3,8 +3,11 @@
 #include "chunk.h"
 #include "mesh.h"
 #include "physics.h"
+#include "visibility.h"
+#include "worker_pool.h"
 
 #include <glm/glm.hpp>
+#include <memory>
 #include <vector>       // HISSSSSSS
 #include <btBulletDynamicsCommon.h>
 
@@ -75,8 +78,10 @@ build_static_physics_rb_mat(glm::mat4 *m, btCollisionShape *shape, btRigidBody *
 }
 
 
+/* builds a new bullet mesh and shape from src, without touching the physics world.
+ * safe to call from a worker thread. */
 void
-build_static_physics_mesh(sw_mesh const * src, btTriangleMesh **mesh, btCollisionShape **shape)
+build_static_physics_shape(sw_mesh const * src, btTriangleMesh **mesh, btCollisionShape **shape)
 {
     btTriangleMesh *phys = NULL;
     btCollisionShape *new_shape = NULL;
@@ -105,6 +110,19 @@ build_static_physics_mesh(sw_mesh const * src, btTriangleMesh **mesh, btCollisio
         new_shape = new btEmptyShape();
     }
 
+    *shape = new_shape;
+    *mesh = phys;
+}
+
+
+void
+build_static_physics_mesh(sw_mesh const * src, btTriangleMesh **mesh, btCollisionShape **shape)
+{
+    btTriangleMesh *phys = NULL;
+    btCollisionShape *new_shape = NULL;
+
+    build_static_physics_shape(src, &phys, &new_shape);
+
     /* Throw away any old objects we've replaced. */
     if (*shape)
         delete *shape;
@@ -154,93 +172,296 @@ mesher_init()
 }
 
 
-void
-chunk::prepare_render()
+static glm::ivec3 dirs[] = {
+    glm::ivec3(1, 0, 0),
+    glm::ivec3(-1, 0, 0),
+    glm::ivec3(0, 1, 0),
+    glm::ivec3(0, -1, 0),
+    glm::ivec3(0, 0, 1),
+    glm::ivec3(0, 0, -1),
+};
+
+
+static bool
+in_chunk(glm::ivec3 p)
 {
-    if (this->render_chunk.valid)
-        return;     // nothing to do here.
+    return p.x >= 0 && p.x < CHUNK_SIZE &&
+           p.y >= 0 && p.y < CHUNK_SIZE &&
+           p.z >= 0 && p.z < CHUNK_SIZE;
+}
 
-    std::vector<vertex> verts;
-    std::vector<unsigned> indices;
 
-    for (int k = 0; k < CHUNK_SIZE; k++)
-        for (int j = 0; j < CHUNK_SIZE; j++)
-            for (int i = 0; i < CHUNK_SIZE; i++) {
-                block *b = this->blocks.get(i, j, k);
+/* like stamp_at_offset, but first scales src by scale. src is expected to span
+ * the unit cube, like the surface quads do */
+static void
+stretch_at_offset(std::vector<vertex> *verts, std::vector<unsigned> *indices,
+                  sw_mesh *src, glm::vec3 offset, glm::vec3 scale, int mat)
+{
+    unsigned index_base = (unsigned)verts->size();
 
-                if (b->type == block_support) {
-                    // TODO: block detail, variants, types, surfaces
-                    stamp_at_offset(&verts, &indices, scaffold_sw, glm::vec3(i, j, k), 1);
+    for (unsigned int i = 0; i < src->num_vertices; i++) {
+        vertex v = src->verts[i];
+        v.x = v.x * scale.x + offset.x;
+        v.y = v.y * scale.y + offset.y;
+        v.z = v.z * scale.z + offset.z;
+        v.mat = mat;
+        verts->push_back(v);
+    }
+
+    for (unsigned int i = 0; i < src->num_indices; i++)
+        indices->push_back(index_base + src->indices[i]);
+}
+
+
+/* greedy meshing of a chunk's surfaces.
+ *
+ * key returns, for the face of the block at p, the material to draw it with,
+ * or -1 to draw nothing. for each face direction, each slice of the chunk is
+ * covered with as few rectangles of one material as possible, and each
+ * rectangle becomes a single stretched copy of the surface quad.
+ */
+static void
+mesh_surfaces(chunk_blocks *blocks, std::vector<vertex> *verts, std::vector<unsigned> *indices,
+              int (*key)(chunk_blocks *blocks, glm::ivec3 p, int face))
+{
+    int mask[CHUNK_SIZE][CHUNK_SIZE];
+
+    for (int face = 0; face < 6; face++) {
+        /* the axis this face is perpendicular to, and the two in the plane */
+        int a = face >> 1;
+        int ua = (a + 1) % 3;
+        int va = (a + 2) % 3;
+
+        for (int d = 0; d < CHUNK_SIZE; d++) {
+            for (int i = 0; i < CHUNK_SIZE; i++) {
+                for (int j = 0; j < CHUNK_SIZE; j++) {
+                    glm::ivec3 p;
+                    p[a] = d;
+                    p[ua] = i;
+                    p[va] = j;
+                    mask[i][j] = key(blocks, p, face);
                 }
+            }
 
-                for (int surf = 0; surf < 6; surf++) {
-                    if (b->surfs[surf] != surface_none) {
-                        stamp_at_offset(&verts, &indices, surfs_sw[surf], glm::vec3(i, j, k),
-                                surface_type_to_material[b->surfs[surf]]);
+            for (int j = 0; j < CHUNK_SIZE; j++) {
+                for (int i = 0; i < CHUNK_SIZE; ) {
+                    int k = mask[i][j];
+                    if (k < 0) {
+                        i++;
+                        continue;
                     }
+
+                    /* grow along u, then along v for as long as every row matches */
+                    int w = 1;
+                    while (i + w < CHUNK_SIZE && mask[i + w][j] == k)
+                        w++;
+
+                    int h = 1;
+                    for (; j + h < CHUNK_SIZE; h++) {
+                        int n = 0;
+                        while (n < w && mask[i + n][j + h] == k)
+                            n++;
+                        if (n < w)
+                            break;
+                    }
+
+                    for (int v = j; v < j + h; v++)
+                        for (int u = i; u < i + w; u++)
+                            mask[u][v] = -1;
+
+                    glm::vec3 offset, scale(1);
+                    offset[a] = (float)d;
+                    offset[ua] = (float)i;
+                    offset[va] = (float)j;
+                    scale[ua] = (float)w;
+                    scale[va] = (float)h;
+                    stretch_at_offset(verts, indices, surfs_sw[face], offset, scale, k);
+
+                    i += w;
                 }
             }
+        }
+    }
+}
 
-    /* wrap the vectors in a temporary sw_mesh */
-    sw_mesh m;
-    m.verts = &verts[0];
-    m.indices = &indices[0];
-    m.num_vertices = (unsigned)verts.size();
-    m.num_indices = (unsigned)indices.size();
 
-    // TODO: try to reuse memory
-    if (this->render_chunk.mesh) {
-        free_mesh(this->render_chunk.mesh);
-        delete this->render_chunk.mesh;
+/* a block walled in on every side can never be seen into */
+static bool
+sealed(chunk_blocks *blocks, glm::ivec3 p)
+{
+    block *b = blocks->get(p.x, p.y, p.z);
+    for (int surf = 0; surf < 6; surf++) {
+        if (b->surfs[surf] != surface_wall)
+            return false;
     }
 
-    this->render_chunk.mesh = upload_mesh(&m);
-    this->render_chunk.valid = true;
+    return true;
+}
+
+
+static int
+render_key(chunk_blocks *blocks, glm::ivec3 p, int face)
+{
+    block *b = blocks->get(p.x, p.y, p.z);
+    if (b->surfs[face] == surface_none)
+        return -1;
+
+    /* the quad faces into the neighbouring block. if that is sealed,
+     * nobody will ever be looking at it */
+    glm::ivec3 q = p + dirs[face];
+    if (in_chunk(q) && sealed(blocks, q))
+        return -1;
+
+    return surface_type_to_material[b->surfs[face]];
+}
+
+
+static int
+phys_key(chunk_blocks *blocks, glm::ivec3 p, int face)
+{
+    block *b = blocks->get(p.x, p.y, p.z);
+    if (!(b->surfs[face] & surface_phys))
+        return -1;
+
+    /* collision triangles are two-sided, so of the two identical quads back to back
+     * at an interface within the chunk, the one on the + side will do */
+    glm::ivec3 q = p + dirs[face];
+    if ((face & 1) && in_chunk(q) &&
+            blocks->get(q.x, q.y, q.z)->surfs[face ^ 1] == b->surfs[face])
+        return -1;
+
+    return 0;
 }
 
 
 void
-chunk::prepare_phys(int x, int y, int z)
+build_render_mesh(chunk_blocks *blocks, std::vector<world_vertex> *out, std::vector<unsigned> *indices)
 {
-    if (this->phys_chunk.valid)
-        return;     // nothing to do here.
+    std::vector<vertex> verts;
+
+    for (int k = 0; k < CHUNK_SIZE; k++)
+        for (int j = 0; j < CHUNK_SIZE; j++)
+            for (int i = 0; i < CHUNK_SIZE; i++) {
+                block *b = blocks->get(i, j, k);
+
+                if (b->type == block_support && !sealed(blocks, glm::ivec3(i, j, k))) {
+                    // TODO: block detail, variants, types, surfaces
+                    stamp_at_offset(&verts, indices, scaffold_sw, glm::vec3(i, j, k), 1);
+                }
+            }
 
+    mesh_surfaces(blocks, &verts, indices, render_key);
+
+    out->reserve(verts.size());
+    for (auto & v : verts)
+        out->push_back(world_vertex(v));
+}
+
+
+static void
+build_phys_mesh(chunk_blocks *blocks, btTriangleMesh **mesh, btCollisionShape **shape)
+{
     std::vector<vertex> verts;
     std::vector<unsigned> indices;
 
     for (int k = 0; k < CHUNK_SIZE; k++)
         for (int j = 0; j < CHUNK_SIZE; j++)
             for (int i = 0; i < CHUNK_SIZE; i++) {
-                block *b = this->blocks.get(i, j, k);
+                block *b = blocks->get(i, j, k);
 
                 if (b->type == block_support) {
                     // TODO: block detail, variants, types, surfaces
                     stamp_at_offset(&verts, &indices, scaffold_sw, glm::vec3(i, j, k), 1);
                 }
-
-                for (int surf = 0; surf < 6; surf++) {
-                    if (b->surfs[surf] & surface_phys) {
-                        stamp_at_offset(&verts, &indices, surfs_sw[surf], glm::vec3(i, j, k), 0);
-                    }
-                }
             }
 
+    mesh_surfaces(blocks, &verts, &indices, phys_key);
+
     /* wrap the vectors in a temporary sw_mesh */
     sw_mesh m;
-    m.verts = &verts[0];
-    m.indices = &indices[0];
+    m.verts = verts.data();
+    m.indices = indices.data();
     m.num_vertices = (unsigned)verts.size();
     m.num_indices = (unsigned)indices.size();
 
-    this->phys_chunk.valid = true;
+    build_static_physics_shape(&m, mesh, shape);
+}
+
+
+/* the mesh work happens on a worker, against a copy of the blocks taken now;
+ * only the upload comes back to the main thread. an edit made while a rebuild
+ * is in flight invalidates the chunk again, and it is rebuilt once this one lands. */
+void
+chunk::prepare_render(worker_pool *pool, mesh_arena *arena)
+{
+    if (this->render_chunk.valid || this->render_chunk.pending)
+        return;     // nothing to do here.
+
+    this->render_chunk.valid = true;
+    this->render_chunk.pending = true;
+
+    struct result {
+        chunk_blocks blocks;
+        std::vector<world_vertex> verts;
+        std::vector<unsigned> indices;
+        uint8_t opaque_faces;
+    };
+
+    auto r = std::make_shared<result>();
+    this->blocks.store(&r->blocks.contents[0][0][0]);
+
+    chunk *ch = this;
+    pool->submit(
+        [r]() {
+            build_render_mesh(&r->blocks, &r->verts, &r->indices);
+            r->opaque_faces = chunk_opaque_faces(&r->blocks);
+        },
+        [r, ch, arena]() {
+            arena->free(&ch->render_chunk.mesh);
+            arena->upload(&ch->render_chunk.mesh, r->verts.data(), (unsigned)r->verts.size(),
+                          r->indices.data(), (unsigned)r->indices.size());
+            ch->render_chunk.opaque_faces = r->opaque_faces;
+            ch->render_chunk.pending = false;
+        });
+}
 
-    build_static_physics_mesh(&m,
-        &this->phys_chunk.phys_mesh,
-        &this->phys_chunk.phys_shape);
 
-    build_static_physics_rb(x * CHUNK_SIZE,
-        y * CHUNK_SIZE,
-        z * CHUNK_SIZE,
-        this->phys_chunk.phys_shape,
-        &this->phys_chunk.phys_body);
-}
\ No newline at end of file
+void
+chunk::prepare_phys(worker_pool *pool, int x, int y, int z)
+{
+    if (this->phys_chunk.valid || this->phys_chunk.pending)
+        return;     // nothing to do here.
+
+    this->phys_chunk.valid = true;
+    this->phys_chunk.pending = true;
+
+    struct result {
+        chunk_blocks blocks;
+        btTriangleMesh *mesh;
+        btCollisionShape *shape;
+    };
+
+    auto r = std::make_shared<result>();
+    this->blocks.store(&r->blocks.contents[0][0][0]);
+
+    chunk *ch = this;
+    pool->submit(
+        [r]() {
+            build_phys_mesh(&r->blocks, &r->mesh, &r->shape);
+        },
+        [r, ch, x, y, z]() {
+            build_static_physics_rb(x * CHUNK_SIZE,
+                y * CHUNK_SIZE,
+                z * CHUNK_SIZE,
+                r->shape,
+                &ch->phys_chunk.phys_body);
+
+            /* Throw away the old objects now that the body no longer uses them. */
+            delete ch->phys_chunk.phys_shape;
+            delete ch->phys_chunk.phys_mesh;
+
+            ch->phys_chunk.phys_shape = r->shape;
+            ch->phys_chunk.phys_mesh = r->mesh;
+            ch->phys_chunk.pending = false;
+        });
+}
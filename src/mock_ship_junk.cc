@@ -13,8 +13,7 @@ static block *
 ensure_and_get_block(ship_space *ss, glm::ivec3 bl) {
     block *b = 0;
 
-    ss->ensure_block(bl);
-    b = ss->get_block(bl);
+    b = ss->ensure_block(bl);
 
     if( ! b ){
         errx(1, "ship_space::ensure_and_get_block: call to get_block failed");
@@ -76,7 +75,7 @@ ship_space::mock_ship_space(void)
         for (unsigned y=0; y < 8; ++y) {
             for (unsigned x=0; x < 8; ++x) {
                 for (int i = 0; i < 4; i++) {
-                    block *b = ss->get_block(glm::ivec3(x + block_offsets[i][0], y + block_offsets[i][1], z));
+                    block *b = ss->edit_block(glm::ivec3(x + block_offsets[i][0], y + block_offsets[i][1], z));
 
                     if( z == 0 ){
                         /* the floor */
@@ -134,5 +133,11 @@ ship_space::mock_ship_space(void)
         }
     }
 
+    /* the surfaces above were written straight into the blocks */
+    for (auto ch : ss->chunks) {
+        ch.second->refresh_faces();
+        ch.second->blocks.compact();
+    }
+
     return ss;
 }
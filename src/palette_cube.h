@@ -0,0 +1,182 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h> /* memcmp, memcpy */
+
+#include <memory>
+#include <vector>
+
+#include "fixed_cube.h"
+
+/* a 3d grid containing N^3 Ts, like fixed_cube, which stays small while
+ * most of it is the same.
+ *
+ * it is always in one of three forms:
+ *
+ *   uniform: every cell is palette[0]
+ *   palette: cell i is palette[indices[i]], for up to 256 distinct Ts
+ *   full:    a plain fixed_cube, as if this were one
+ *
+ * cells are indexed as in fixed_cube -- [x][y][z], z fastest -- and may be
+ * read in any form. writing goes through edit(), which expands to full
+ * first; compact() goes back to the smallest form which fits.
+ *
+ * pointers from get() only last until the next edit() or compact().
+ *
+ * like fixed_cube, the Ts are zeroed rather than constructed; they are also
+ * told apart with memcmp, so T must be plain old data.
+ */
+template <class T, int N>
+struct palette_cube {
+    enum { volume = N * N * N };
+
+    palette_cube() : palette(1)
+    {
+        memset(&palette[0], 0, sizeof(T));
+    }
+
+    static unsigned index(unsigned x, unsigned y, unsigned z)
+    {
+        return (x * N + y) * N + z;
+    }
+
+    /* return a const *T at coordinates (x, y, z)
+     * or null on error
+     *
+     * will check bounds
+     */
+    T const * get(unsigned int x, unsigned int y, unsigned int z) const
+    {
+        if( x >= N ||
+            y >= N ||
+            z >= N ){
+            assert(!"out of range");
+            return 0;
+        }
+
+        return at(index(x, y, z));
+    }
+
+    /* as get(), by flat index */
+    T const * at(unsigned i) const
+    {
+        if (cells)
+            return &cells->contents[0][0][0] + i;
+
+        return &palette[indices ? indices[i] : 0];
+    }
+
+    /* return a writable *T at coordinates (x, y, z), expanding to full
+     * first, or null on error */
+    T * edit(unsigned int x, unsigned int y, unsigned int z)
+    {
+        if( x >= N ||
+            y >= N ||
+            z >= N ){
+            assert(!"out of range");
+            return 0;
+        }
+
+        return edit_at(index(x, y, z));
+    }
+
+    T * edit_at(unsigned i)
+    {
+        expand();
+        return &cells->contents[0][0][0] + i;
+    }
+
+    bool uniform() const
+    {
+        return !cells && !indices;
+    }
+
+    bool full() const
+    {
+        return cells != nullptr;
+    }
+
+    void expand()
+    {
+        if (cells)
+            return;
+
+        auto *c = new fixed_cube<T, N>();
+        store(&c->contents[0][0][0]);
+        cells.reset(c);
+
+        std::vector<T>().swap(palette);
+        indices.reset();
+    }
+
+    /* replaces every cell with the volume Ts at src, in index order, in
+     * the smallest form which holds them */
+    void load(T const *src)
+    {
+        std::vector<T> pal;
+        std::unique_ptr<uint8_t[]> idx(new uint8_t[volume]);
+
+        for (unsigned i = 0; i < volume; i++) {
+            unsigned j = 0;
+            while (j < pal.size() && memcmp(&pal[j], &src[i], sizeof(T)))
+                j++;
+
+            if (j == pal.size()) {
+                if (j == 256) {
+                    /* too varied to be worth it */
+                    if (!cells)
+                        cells.reset(new fixed_cube<T, N>());
+                    memcpy(cells->contents, src, sizeof(cells->contents));
+                    std::vector<T>().swap(palette);
+                    indices.reset();
+                    return;
+                }
+
+                pal.push_back(src[i]);
+            }
+
+            idx[i] = (uint8_t)j;
+        }
+
+        palette.swap(pal);
+        palette.shrink_to_fit();
+        indices.reset(palette.size() > 1 ? idx.release() : nullptr);
+        cells.reset();
+    }
+
+    /* writes every cell out to the volume Ts at dst, in index order */
+    void store(T *dst) const
+    {
+        if (cells) {
+            memcpy(dst, cells->contents, sizeof(cells->contents));
+            return;
+        }
+
+        for (unsigned i = 0; i < volume; i++) {
+            memcpy(&dst[i], &palette[indices ? indices[i] : 0], sizeof(T));
+        }
+    }
+
+    void compact()
+    {
+        if (!cells)
+            return;
+
+        std::unique_ptr<fixed_cube<T, N>> c(std::move(cells));
+        load(&c->contents[0][0][0]);
+    }
+
+    /* bytes held outside the palette_cube itself */
+    size_t heap_size() const
+    {
+        return palette.capacity() * sizeof(T) +
+               (indices ? volume : 0) +
+               (cells ? sizeof(*cells) : 0);
+    }
+
+private:
+    std::vector<T> palette;
+    std::unique_ptr<uint8_t[]> indices;
+    std::unique_ptr<fixed_cube<T, N>> cells;
+};
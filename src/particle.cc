@@ -84,12 +84,10 @@ void particle_manager::simulate(float dt) {
     }
 }
 
+/* the vao is made when the particles are first drawn, so that they can be
+ * simulated without a GL context */
 particle_manager::particle_manager() : vao(0)
 {
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao); /* nothing to actually do here; we're pure gl_VertexID */
-    glBindVertexArray(0);
-
     buffer.buffer = nullptr;
     buffer.num = 0;
     buffer.allocated = 0;
@@ -99,6 +97,12 @@ particle_manager::particle_manager() : vao(0)
 void
 draw_particles(particle_manager *man, frame_data *frame)
 {
+    if (!man->vao) {
+        glGenVertexArrays(1, &man->vao);
+        glBindVertexArray(man->vao); /* nothing to actually do here; we're pure gl_VertexID */
+        glBindVertexArray(0);
+    }
+
     for (auto i = 0u; i < man->buffer.num; i += INSTANCE_BATCH_SIZE) {
         auto batch_size = std::min(INSTANCE_BATCH_SIZE, man->buffer.num - i);
 
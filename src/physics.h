@@ -71,6 +71,9 @@ build_static_physics_rb_mat(glm::mat4 *m, btCollisionShape *shape, btRigidBody *
 void
 build_static_physics_mesh(sw_mesh const * src, btTriangleMesh **mesh, btCollisionShape **shape);
 
+void
+build_static_physics_shape(sw_mesh const * src, btTriangleMesh **mesh, btCollisionShape **shape);
+
 
 void
 teardown_static_physics_setup(btTriangleMesh **mesh, btCollisionShape **shape, btRigidBody **rb);
@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "profiler.h"
+
+
+profiler prof;
+
+static std::chrono::steady_clock::time_point const profile_epoch = std::chrono::steady_clock::now();
+
+#define NO_ZONE     (~0u)
+
+
+uint64_t
+profile_time()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - profile_epoch).count();
+}
+
+
+static float
+zone_ms(profile_zone const *z)
+{
+    return (z->end - z->start) / 1e6f;
+}
+
+
+profiler::profiler()
+    : current(0), num_frames(0), dropped(0), running(false), depth(0), overflow(0)
+{
+}
+
+
+void
+profiler::begin_frame()
+{
+    auto now = profile_time();
+
+    if (running) {
+        profile_frame *f = &frames[current];
+
+        while (depth) {
+            unsigned i = stack[--depth];
+            if (i != NO_ZONE)
+                f->zones[i].end = now;
+        }
+        overflow = 0;
+        f->end = now;
+
+        current = (current + 1) % PROFILE_FRAMES;
+        if (num_frames < PROFILE_FRAMES - 1)
+            num_frames++;
+    }
+
+    running = true;
+    frames[current].start = now;
+    frames[current].end = now;
+    frames[current].num_zones = 0;
+}
+
+
+void
+profiler::begin(char const *name)
+{
+    if (!running)
+        return;
+
+    if (depth == PROFILE_MAX_DEPTH) {
+        overflow++;
+        dropped++;
+        return;
+    }
+
+    profile_frame *f = &frames[current];
+    if (f->num_zones == PROFILE_MAX_ZONES) {
+        stack[depth++] = NO_ZONE;
+        dropped++;
+        return;
+    }
+
+    unsigned i = f->num_zones++;
+    auto now = profile_time();
+    f->zones[i] = { name, depth, 0, now, now };
+    stack[depth++] = i;
+}
+
+
+void
+profiler::record(char const *name, unsigned thread, uint64_t start, uint64_t end)
+{
+    if (!running)
+        return;
+
+    profile_frame *f = &frames[current];
+    if (f->num_zones == PROFILE_MAX_ZONES) {
+        dropped++;
+        return;
+    }
+
+    f->zones[f->num_zones++] = { name, depth, thread, start, end };
+}
+
+
+void
+profiler::end()
+{
+    if (overflow) {
+        overflow--;
+        return;
+    }
+
+    /* begin_frame has already closed it */
+    if (!depth)
+        return;
+
+    unsigned i = stack[--depth];
+    if (i != NO_ZONE)
+        frames[current].zones[i].end = profile_time();
+}
+
+
+profile_frame const *
+profiler::get_frame(unsigned age) const
+{
+    if (age >= num_frames)
+        return nullptr;
+
+    return &frames[(current + PROFILE_FRAMES - 1 - age) % PROFILE_FRAMES];
+}
+
+
+/* the index of z's stat in out, or -1. zones mostly come in the same order
+ * every frame, so try the one after the last match first */
+static int
+find_stat(profile_stat const *out, unsigned n, profile_zone const *z, unsigned *hint)
+{
+    if (*hint < n && out[*hint].name == z->name && out[*hint].depth == z->depth)
+        return (int)(*hint)++;
+
+    for (unsigned k = 0; k < n; k++) {
+        if (out[k].name == z->name && out[k].depth == z->depth) {
+            *hint = k + 1;
+            return (int)k;
+        }
+    }
+
+    return -1;
+}
+
+
+unsigned
+profiler::summarize(profile_stat *out, unsigned max) const
+{
+    if (!num_frames)
+        return 0;
+
+    /* some zones only come up every few frames, like the main tick's; the
+     * frame with the most zones most likely has them all, in a sensible order */
+    unsigned busiest = 0;
+    for (unsigned age = 1; age < num_frames; age++) {
+        if (get_frame(age)->num_zones > get_frame(busiest)->num_zones)
+            busiest = age;
+    }
+
+    unsigned n = 0;
+    unsigned hint = 0;
+    auto add_zones = [&](profile_frame const *f) {
+        hint = 0;
+        for (unsigned i = 0; i < f->num_zones && n < max; i++) {
+            auto const *z = &f->zones[i];
+            if (find_stat(out, n, z, &hint) < 0)
+                out[n++] = { z->name, z->depth, 0, 0, 0 };
+        }
+    };
+
+    add_zones(get_frame(busiest));
+    for (unsigned age = 0; age < num_frames; age++) {
+        add_zones(get_frame(age));
+    }
+
+    /* a zone may come up more than once a frame; its time is the sum */
+    std::vector<float> total(n), frame_ms(n);
+    std::vector<unsigned> count(n);
+    std::vector<bool> present(n);
+
+    for (unsigned age = 0; age < num_frames; age++) {
+        profile_frame const *f = get_frame(age);
+        std::fill(frame_ms.begin(), frame_ms.end(), 0.0f);
+        std::fill(present.begin(), present.end(), false);
+
+        hint = 0;
+        for (unsigned i = 0; i < f->num_zones; i++) {
+            int k = find_stat(out, n, &f->zones[i], &hint);
+            if (k >= 0) {
+                frame_ms[k] += zone_ms(&f->zones[i]);
+                present[k] = true;
+            }
+        }
+
+        for (unsigned k = 0; k < n; k++) {
+            if (!present[k])
+                continue;
+
+            total[k] += frame_ms[k];
+            count[k]++;
+            if (frame_ms[k] > out[k].max_ms)
+                out[k].max_ms = frame_ms[k];
+            if (age == 0)
+                out[k].last_ms = frame_ms[k];
+        }
+    }
+
+    for (unsigned k = 0; k < n; k++) {
+        out[k].avg_ms = total[k] / count[k];
+    }
+
+    return n;
+}
+
+
+static void
+write_event(FILE *f, bool *first, char const *name, unsigned thread, uint64_t start, uint64_t end)
+{
+    fprintf(f, "%s\n{\"name\":\"", *first ? "" : ",");
+    for (char const *c = name; *c; c++) {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', f);
+        fputc(*c, f);
+    }
+    fprintf(f, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+            thread + 1, start / 1e3, (end - start) / 1e3);
+    *first = false;
+}
+
+
+bool
+profiler::dump_trace(char const *filename) const
+{
+    FILE *f = fopen(filename, "w");
+    if (!f)
+        return false;
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    bool first = true;
+    for (unsigned age = num_frames; age--; ) {
+        profile_frame const *fr = get_frame(age);
+        write_event(f, &first, "frame", 0, fr->start, fr->end);
+
+        for (unsigned i = 0; i < fr->num_zones; i++) {
+            auto const *z = &fr->zones[i];
+            write_event(f, &first, z->name, z->thread, z->start, z->end);
+        }
+    }
+
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdint.h>
+
+/* a frame profiler: named zones, nested, timed on the main thread and kept
+ * for the last PROFILE_FRAMES frames. mark them up with
+ *
+ *     PROFILE_FRAME();                 once, at the top of each frame
+ *     PROFILE_SCOPE("tick_doors");     until the end of the enclosing block
+ *
+ * zone names must be string literals: zones in different frames are matched
+ * up by the name's address. only the main thread may call these; work timed
+ * on other threads is handed back and added with record().
+ *
+ * build with -DPROFILER=0 (cmake -DNIGHTMARE_PROFILER=OFF) and the macros
+ * compile to nothing. the profiler itself is still there, but empty.
+ */
+#ifndef PROFILER
+#define PROFILER 1
+#endif
+
+#define PROFILE_FRAMES      128
+#define PROFILE_MAX_ZONES   256     /* per frame; any more are dropped */
+#define PROFILE_MAX_DEPTH   16
+
+struct profile_zone {
+    char const *name;
+    unsigned depth;             /* 0 for the outermost */
+    unsigned thread;            /* 0 for the main thread */
+    uint64_t start;             /* ns since the profiler was made */
+    uint64_t end;
+};
+
+struct profile_frame {
+    uint64_t start;
+    uint64_t end;
+    unsigned num_zones;
+    profile_zone zones[PROFILE_MAX_ZONES];     /* in the order they began */
+};
+
+/* one zone, as it has looked over the frames in the ring */
+struct profile_stat {
+    char const *name;
+    unsigned depth;
+    float avg_ms;               /* over the frames it appeared in */
+    float max_ms;
+    float last_ms;              /* in the newest frame, or 0 */
+};
+
+struct profiler {
+    profile_frame frames[PROFILE_FRAMES];
+    unsigned current;           /* the frame being recorded */
+    unsigned num_frames;        /* finished frames in the ring */
+    unsigned dropped;           /* zones which didn't fit, ever */
+
+    bool running;               /* zones before the first frame are ignored */
+    unsigned stack[PROFILE_MAX_DEPTH];
+    unsigned depth;
+    unsigned overflow;          /* zones open past the top of the stack */
+
+    profiler();
+
+    /* finishes the current frame, closing any zones left open, and starts
+     * recording the next over the oldest. call it outside of any zone */
+    void begin_frame();
+
+    void begin(char const *name);
+    void end();
+
+    /* adds a zone which has already finished, inside whichever is open.
+     * for work timed on other threads, handed back to the main thread */
+    void record(char const *name, unsigned thread, uint64_t start, uint64_t end);
+
+    /* age 0 is the newest finished frame; null past the oldest */
+    profile_frame const *get_frame(unsigned age) const;
+
+    /* fills out with each zone in the ring and its times: in order, as they
+     * came in the busiest frame, then any others. returns how many */
+    unsigned summarize(profile_stat *out, unsigned max) const;
+
+    /* writes the ring out in Chrome's trace event format, for
+     * chrome://tracing or https://ui.perfetto.dev */
+    bool dump_trace(char const *filename) const;
+};
+
+extern profiler prof;
+
+/* ns since the profiler was made; zone times are in these */
+uint64_t
+profile_time();
+
+
+struct profile_scope {
+    profile_scope(char const *name) { prof.begin(name); }
+    ~profile_scope() { prof.end(); }
+};
+
+#if PROFILER
+#define PROFILE_CONCAT2(a, b)   a ## b
+#define PROFILE_CONCAT(a, b)    PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(name)     profile_scope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define PROFILE_FRAME()         prof.begin_frame()
+#else
+#define PROFILE_SCOPE(name)     ((void)0)
+#define PROFILE_FRAME()         ((void)0)
+#endif
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+/* hands out [offset, offset+size) ranges of some fixed-size space -- a GPU
+ * buffer, typically -- without knowing anything about what lives there.
+ *
+ * free ranges are kept sorted by offset, and merged with their neighbours
+ * as they are returned, so the list stays about as long as the number of
+ * holes. allocation is first-fit.
+ */
+struct range_allocator {
+    static const unsigned invalid = ~0u;
+
+    range_allocator(unsigned capacity = 0) : capacity(0), used(0)
+    {
+        grow(capacity);
+    }
+
+    /* returns the offset of a free range of size units, or invalid if there
+     * is no hole big enough */
+    unsigned alloc(unsigned size)
+    {
+        assert(size);
+
+        for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+            if (it->size < size)
+                continue;
+
+            unsigned offset = it->offset;
+            it->offset += size;
+            it->size -= size;
+            if (!it->size)
+                free_ranges.erase(it);
+
+            used += size;
+            return offset;
+        }
+
+        return invalid;
+    }
+
+    /* returns a range previously handed out by alloc() */
+    void free(unsigned offset, unsigned size)
+    {
+        assert(size);
+        assert(offset + size <= capacity);
+
+        auto next = std::lower_bound(free_ranges.begin(), free_ranges.end(), offset,
+            [](range const & r, unsigned off) { return r.offset < off; });
+
+        assert(next == free_ranges.end() || offset + size <= next->offset);
+
+        /* merge with the hole before, the hole after, or both */
+        if (next != free_ranges.begin()) {
+            auto prev = next - 1;
+            assert(prev->offset + prev->size <= offset);
+
+            if (prev->offset + prev->size == offset) {
+                prev->size += size;
+                if (next != free_ranges.end() && prev->offset + prev->size == next->offset) {
+                    prev->size += next->size;
+                    free_ranges.erase(next);
+                }
+
+                used -= size;
+                return;
+            }
+        }
+
+        if (next != free_ranges.end() && offset + size == next->offset) {
+            next->offset = offset;
+            next->size += size;
+        }
+        else {
+            free_ranges.insert(next, range{ offset, size });
+        }
+
+        used -= size;
+    }
+
+    /* extends the space to new_capacity units; everything already handed
+     * out keeps its offset */
+    void grow(unsigned new_capacity)
+    {
+        assert(new_capacity >= capacity);
+        if (new_capacity == capacity)
+            return;
+
+        unsigned old_capacity = capacity;
+        capacity = new_capacity;
+        free(old_capacity, new_capacity - old_capacity);
+        used += new_capacity - old_capacity;
+    }
+
+    unsigned get_capacity() const { return capacity; }
+    unsigned get_used() const { return used; }
+    size_t num_free_ranges() const { return free_ranges.size(); }
+
+private:
+    struct range {
+        unsigned offset;
+        unsigned size;
+    };
+
+    std::vector<range> free_ranges;     /* sorted by offset, never adjacent */
+    unsigned capacity;
+    unsigned used;
+};
@@ -3,6 +3,7 @@
 #include <epoxy/gl.h>
 #include <stdio.h>
 #include <algorithm>
+#include <chrono>
 
 
 #define INSTANCE_BATCH_SIZE 256u        /* needs to be <= the value in the shader */
@@ -11,6 +12,57 @@
 #define FRAME_DATA_SIZE     (16u * 1024 * 1024)
 #define NUM_INFLIGHT_FRAMES 3
 
+#define GPU_MAX_TIMERS      16          /* timed passes per frame */
+#define GPU_STATS_WEIGHT    0.05f       /* of the newest frame, in the averages */
+
+
+/* the GPU's time for each render pass, read back from timer queries once
+ * their frame has retired -- so NUM_INFLIGHT_FRAMES behind -- and the time
+ * the CPU spent waiting for frames to retire. if the waits are long, the
+ * GPU is the bottleneck.
+ */
+struct gpu_timer_stats {
+    unsigned num_passes;
+    char const *names[GPU_MAX_TIMERS];     /* string literals, matched by address */
+    float last_ms[GPU_MAX_TIMERS];
+    float avg_ms[GPU_MAX_TIMERS];
+
+    unsigned frames;            /* frames retired */
+    unsigned stalls;            /* of those, how many were still in flight when reused */
+    float last_wait_ms;
+    float avg_wait_ms;
+    float max_wait_ms;
+
+    gpu_timer_stats() : num_passes(0), frames(0), stalls(0),
+        last_wait_ms(0), avg_wait_ms(0), max_wait_ms(0) {}
+
+    void add_pass(char const *name, float ms) {
+        unsigned i = 0;
+        while (i < num_passes && names[i] != name)
+            i++;
+
+        if (i == num_passes) {
+            if (num_passes == GPU_MAX_TIMERS)
+                return;
+            names[i] = name;
+            avg_ms[i] = ms;
+            num_passes++;
+        }
+
+        last_ms[i] = ms;
+        avg_ms[i] += (ms - avg_ms[i]) * GPU_STATS_WEIGHT;
+    }
+
+    void add_wait(float ms, bool stalled) {
+        frames++;
+        stalls += stalled;
+        last_wait_ms = ms;
+        avg_wait_ms += (ms - avg_wait_ms) * GPU_STATS_WEIGHT;
+        max_wait_ms = std::max(max_wait_ms, ms);
+    }
+};
+
+
 struct frame_data {
     GLuint bo;
     void *base_ptr;
@@ -18,7 +70,19 @@ struct frame_data {
     GLsync fence;
     GLint hw_align;
 
-    frame_data() : bo(0), base_ptr(0), offset(0), fence(0), hw_align(1) {
+    /* GL_TIME_ELAPSED queries around this frame's passes, in order. these
+     * can't nest, so neither can the passes */
+    GLuint queries[GPU_MAX_TIMERS];
+    char const *query_names[GPU_MAX_TIMERS];
+    unsigned num_queries;
+    bool query_open;
+
+    gpu_timer_stats *stats;     /* where the timings go, if anywhere */
+
+    frame_data() : bo(0), base_ptr(0), offset(0), fence(0), hw_align(1),
+        num_queries(0), query_open(false), stats(nullptr) {
+        glGenQueries(GPU_MAX_TIMERS, queries);
+
         glGenBuffers(1, &bo);
         glBindBuffer(GL_UNIFORM_BUFFER, bo);
         glBufferStorage(GL_UNIFORM_BUFFER, FRAME_DATA_SIZE, nullptr,
@@ -35,18 +99,52 @@ struct frame_data {
     */
     void begin() {
         if (fence) {
-            /* Wait on the fence if this frame_data might be in flight. */
-
-            /* TODO: detect case where we are getting throttled by this wait -- it suggests
-            * that either we have insufficient frame_data buffers, or that the driver is
-            * trying to run the GPU an unacceptable number of frames behind.
+            /* Wait on the fence if this frame_data might be in flight. If we often
+            * have to (stats->stalls), either we have insufficient frame_data buffers,
+            * or the GPU can't keep up.
             */
-            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            auto start = std::chrono::steady_clock::now();
+            bool stalled = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED;
+            if (stalled)
+                glClientWaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+            float wait_ms = std::chrono::duration<float, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+
             glDeleteSync(fence);
             fence = nullptr;
+
+            /* the frame has retired, so its queries have their results */
+            if (stats) {
+                stats->add_wait(wait_ms, stalled);
+
+                for (unsigned i = 0; i < num_queries; i++) {
+                    GLuint64 ns = 0;
+                    glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &ns);
+                    stats->add_pass(query_names[i], ns / 1e6f);
+                }
+            }
         }
 
         offset = 0;
+        num_queries = 0;
+    }
+
+    /* Time the GPU commands from here to end_timer() as name. Out of queries, the
+    * pass goes untimed.
+    */
+    void begin_timer(char const *name) {
+        if (num_queries == GPU_MAX_TIMERS)
+            return;
+
+        query_names[num_queries] = name;
+        glBeginQuery(GL_TIME_ELAPSED, queries[num_queries++]);
+        query_open = true;
+    }
+
+    void end_timer() {
+        if (query_open)
+            glEndQuery(GL_TIME_ELAPSED);
+        query_open = false;
     }
 
     /* Signal that all uses of this frame_data have been submitted to the hardware. */
@@ -83,3 +181,17 @@ struct frame_data {
         return a;
     }
 };
+
+
+/* a GPU timer around the enclosing block */
+struct gpu_timer_scope {
+    frame_data *frame;
+
+    gpu_timer_scope(frame_data *frame, char const *name) : frame(frame) {
+        frame->begin_timer(name);
+    }
+
+    ~gpu_timer_scope() {
+        frame->end_timer();
+    }
+};
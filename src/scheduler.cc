@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "scheduler.h"
+#include "profiler.h"
+#include "worker_pool.h"
+
+
+void
+system_scheduler::add(char const *name, unsigned reads, unsigned writes, run_fn run)
+{
+    add(name, reads, writes, count_fn(), 0,
+        [run](unsigned, unsigned) { run(); });
+}
+
+
+void
+system_scheduler::add(char const *name, unsigned reads, unsigned writes,
+                      count_fn count, unsigned grain, range_fn run)
+{
+    system s;
+    s.name = name;
+    s.reads = reads;
+    s.writes = writes;
+    s.run = run;
+    s.count = count;
+    s.grain = std::max(grain, 1u);
+    s.num_deps = 0;
+    s.last_ms = 0;
+
+    auto index = (unsigned)systems.size();
+    for (auto & e : systems) {
+        if ((e.writes & (reads | writes)) || (e.reads & writes)) {
+            e.dependents.push_back(index);
+            s.num_deps++;
+        }
+    }
+
+    systems.push_back(s);
+}
+
+
+struct scheduler_task {
+    unsigned system;
+    unsigned begin, end;
+};
+
+/* when and where a task ran */
+struct scheduler_span {
+    unsigned system;
+    unsigned thread;
+    uint64_t start, end;
+};
+
+/* one run's state. helpers still queued in the worker_pool when the run
+ * ends hold on to it, find nothing left, and leave */
+struct scheduler_run {
+    system_scheduler *sched;
+
+    std::mutex lock;
+    std::condition_variable changed;
+
+    std::deque<scheduler_task> ready;
+    std::vector<unsigned> waiting;      /* per system: systems it still waits for */
+    std::vector<unsigned> tasks_left;   /* per system */
+    unsigned systems_left;
+    unsigned next_thread;
+
+    std::vector<scheduler_span> spans;
+};
+
+
+static void finish_system(scheduler_run *r, unsigned index);
+
+
+/* queues the tasks of a system with nothing left to wait for. call with the
+ * lock held */
+static void
+release_system(scheduler_run *r, unsigned index)
+{
+    auto const & s = r->sched->systems[index];
+
+    if (!s.count) {
+        r->ready.push_back({ index, 0, 1 });
+        r->tasks_left[index] = 1;
+        return;
+    }
+
+    unsigned n = s.count();
+    if (!n) {
+        finish_system(r, index);
+        return;
+    }
+
+    for (unsigned b = 0; b < n; b += s.grain) {
+        r->ready.push_back({ index, b, std::min(n, b + s.grain) });
+        r->tasks_left[index]++;
+    }
+}
+
+
+static void
+finish_system(scheduler_run *r, unsigned index)
+{
+    r->systems_left--;
+
+    for (auto d : r->sched->systems[index].dependents) {
+        if (!--r->waiting[d])
+            release_system(r, d);
+    }
+}
+
+
+/* runs tasks as they become ready, until there are none left. the thread
+ * which called run() is thread 0 */
+static void
+run_tasks(scheduler_run *r, bool helper)
+{
+    std::unique_lock<std::mutex> g(r->lock);
+    unsigned thread = helper ? ++r->next_thread : 0;
+
+    for (;;) {
+        r->changed.wait(g, [r]() { return !r->ready.empty() || !r->systems_left; });
+        if (!r->systems_left)
+            return;
+
+        auto t = r->ready.front();
+        r->ready.pop_front();
+        auto & s = r->sched->systems[t.system];
+
+        g.unlock();
+        auto start = profile_time();
+        s.run(t.begin, t.end);
+        auto end = profile_time();
+        g.lock();
+
+        r->spans.push_back({ t.system, thread, start, end });
+
+        if (!--r->tasks_left[t.system]) {
+            finish_system(r, t.system);
+            r->changed.notify_all();
+        }
+    }
+}
+
+
+void
+system_scheduler::run(worker_pool *workers)
+{
+    auto r = std::make_shared<scheduler_run>();
+    r->sched = this;
+    r->waiting.resize(systems.size());
+    r->tasks_left.resize(systems.size());
+    r->systems_left = (unsigned)systems.size();
+    r->next_thread = 0;
+
+    {
+        std::lock_guard<std::mutex> g(r->lock);
+        for (unsigned i = 0; i < systems.size(); i++) {
+            r->waiting[i] = systems[i].num_deps;
+        }
+        for (unsigned i = 0; i < systems.size(); i++) {
+            if (!systems[i].num_deps)
+                release_system(r.get(), i);
+        }
+    }
+
+    /* this thread joins in, so the run finishes even if every worker is
+     * busy with something else */
+    unsigned helpers = workers ? workers->num_threads() : 0;
+    for (unsigned i = 0; i < helpers; i++) {
+        workers->submit([r]() { run_tasks(r.get(), true); });
+    }
+
+    run_tasks(r.get(), false);
+
+    /* every task has finished; nothing else touches the spans now */
+    std::sort(r->spans.begin(), r->spans.end(),
+              [](scheduler_span const & a, scheduler_span const & b) { return a.start < b.start; });
+
+    for (auto & s : systems) {
+        s.last_ms = 0;
+    }
+
+    for (auto const & span : r->spans) {
+        auto & s = systems[span.system];
+        s.last_ms += (span.end - span.start) / 1e6f;
+#if PROFILER
+        prof.record(s.name, span.thread, span.start, span.end);
+#endif
+    }
+}
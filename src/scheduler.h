@@ -0,0 +1,52 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+struct worker_pool;
+
+/* runs a fixed list of systems -- the game's ticks -- on the calling thread
+ * and the worker_pool together, with the same results as running them one
+ * after another in the order they were added.
+ *
+ * each system says which resources it reads and writes, as bits of a mask
+ * the caller makes up. a system waits for every earlier one it conflicts
+ * with: one which writes what it reads or writes, or reads what it writes.
+ * the rest may run at the same time.
+ *
+ * a system with a grain is split into tasks of that many of its items, and
+ * these may run at the same time too, so it must write only to the items
+ * it was given.
+ */
+struct system_scheduler {
+    typedef std::function<void()> run_fn;
+    typedef std::function<void(unsigned begin, unsigned end)> range_fn;
+    typedef std::function<unsigned()> count_fn;
+
+    struct system {
+        char const *name;       /* a string literal, for the profiler */
+        unsigned reads;
+        unsigned writes;
+
+        range_fn run;
+        count_fn count;         /* null for a system which runs whole */
+        unsigned grain;
+
+        unsigned num_deps;                  /* earlier systems it waits for */
+        std::vector<unsigned> dependents;   /* later systems which wait for it */
+
+        float last_ms;          /* over all of its tasks, last time it ran */
+    };
+
+    std::vector<system> systems;
+
+    void add(char const *name, unsigned reads, unsigned writes, run_fn run);
+
+    /* run is given [begin, end) of count() items, up to grain at a time */
+    void add(char const *name, unsigned reads, unsigned writes,
+             count_fn count, unsigned grain, range_fn run);
+
+    /* runs every system once, and returns when all have finished. workers
+     * may be null, to run everything on this thread */
+    void run(worker_pool *workers);
+};
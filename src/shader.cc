@@ -6,9 +6,21 @@
 
 #include <epoxy/gl.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "shader.h"
 #include "blob.h"
+#include "chunk_size.h"
+
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+
+/* build settings the shaders must agree with. goes in just after the
+ * #version line, which has to come first */
+static char const shader_defines[] =
+    "#define CHUNK_SIZE " STRINGIFY(CHUNK_SIZE) "\n"
+    "#define CHUNK_SHIFT " STRINGIFY(CHUNK_SHIFT) "\n"
+    "#line 2\n";
 
 static GLuint
 load_stage(GLenum stage, char const *filename)
@@ -16,8 +28,14 @@ load_stage(GLenum stage, char const *filename)
     blob content(filename);
     GLuint shader = glCreateShader(stage);
     glObjectLabel(GL_SHADER, shader, -1, filename);
-    GLint len = (GLint)content.len;
-    glShaderSource(shader, 1, (GLchar const **) &content.data, &len);
+
+    char const *src = (char const *)content.data;
+    char const *eol = (char const *)memchr(src, '\n', content.len);
+    GLint version_len = eol ? (GLint)(eol - src + 1) : (GLint)content.len;
+
+    GLchar const *parts[3] = { src, shader_defines, src + version_len };
+    GLint lens[3] = { version_len, (GLint)strlen(shader_defines), (GLint)content.len - version_len };
+    glShaderSource(shader, 3, parts, lens);
     glCompileShader(shader);
     return shader;
 }
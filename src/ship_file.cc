@@ -0,0 +1,554 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unordered_set>
+
+#include "blob.h"
+#include "common.h"
+#include "ship_file.h"
+
+
+ship_file::~ship_file()
+{
+    release_mapping();
+}
+
+
+void
+ship_file::release_mapping()
+{
+    delete mapping;
+    mapping = nullptr;
+    header = nullptr;
+    unloaded.clear();
+}
+
+
+static uint64_t
+align_to_page(uint64_t off)
+{
+    return (off + SHIP_FILE_PAGE_SIZE - 1) & ~(uint64_t)(SHIP_FILE_PAGE_SIZE - 1);
+}
+
+
+static void
+write_padding(FILE *f, uint64_t to)
+{
+    static char const zeros[SHIP_FILE_PAGE_SIZE] = { 0 };
+    uint64_t at = (uint64_t)ftell(f);
+    if (to > at) {
+        fwrite(zeros, 1, (size_t)(to - at), f);
+    }
+}
+
+
+bool
+ship_space::save(char const *filename,
+                 bool (*describe)(c_entity ce, glm::ivec3 *p, unsigned *type, int *face))
+{
+    /* we need the whole ship, and consistent topology, to write it out */
+    page_in_all_chunks();
+
+    ship_file_header h;
+    memset(&h, 0, sizeof(h));
+    h.magic = SHIP_FILE_MAGIC;
+    h.version = SHIP_FILE_VERSION;
+    h.chunk_size = CHUNK_SIZE;
+    h.block_size = sizeof(block);
+    h.mins[0] = mins.x; h.mins[1] = mins.y; h.mins[2] = mins.z;
+    h.maxs[0] = maxs.x; h.maxs[1] = maxs.y; h.maxs[2] = maxs.z;
+    h.num_chunks = (uint32_t)chunks.size();
+
+    /* number the zones. the outside is always zone 0 */
+    std::unordered_map<topo_info *, uint32_t> zone_index;
+    std::vector<ship_file_zone> zone_table;
+
+    auto add_zone = [&](topo_info *root) -> uint32_t {
+        auto it = zone_index.find(root);
+        if (it != zone_index.end())
+            return it->second;
+
+        zone_info *z = get_zone_info(root);
+        ship_file_zone fz = { root->size, z ? 1u : 0u, z ? z->air_amount : 0.0f, 0 };
+        auto index = (uint32_t)zone_table.size();
+        zone_table.push_back(fz);
+        zone_index[root] = index;
+        return index;
+    };
+
+    add_zone(topo_find(&outside_topo_info));
+
+    std::vector<ship_file_chunk> chunk_dir;
+    std::vector<uint32_t> chunk_zones;
+    chunk_zones.reserve(chunks.size() * CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE);
+
+    for (auto it = chunks.begin(); it != chunks.end(); it++) {
+        ship_file_chunk fc = { it->first.x, it->first.y, it->first.z, 0, 0, 0 };
+        chunk_dir.push_back(fc);
+
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            for (int y = 0; y < CHUNK_SIZE; y++) {
+                for (int z = 0; z < CHUNK_SIZE; z++) {
+                    chunk_zones.push_back(add_zone(topo_find(it->second->topo_at(chunk_block_index(x, y, z)))));
+                }
+            }
+        }
+    }
+
+    h.num_zones = (uint32_t)zone_table.size();
+
+    /* entities. only those placed into a chunk can be recreated. */
+    std::vector<ship_file_entity> entity_table;
+    std::unordered_map<c_entity, uint32_t> entity_index;
+
+    for (auto it = chunks.begin(); describe && it != chunks.end(); it++) {
+        for (auto ce : it->second->entities) {
+            glm::ivec3 p;
+            unsigned type;
+            int face;
+            if (!describe(ce, &p, &type, &face))
+                continue;
+
+            ship_file_entity fe = { type, p.x, p.y, p.z, (uint32_t)face };
+
+            entity_index[ce] = (uint32_t)entity_table.size();
+            entity_table.push_back(fe);
+        }
+    }
+
+    h.num_entities = (uint32_t)entity_table.size();
+
+    /* wiring */
+    std::vector<ship_file_attach> attach_tables[num_wire_types];
+    std::vector<ship_file_entity_attach> entity_attach_tables[num_wire_types];
+
+    for (auto type = 0; type < num_wire_types; ++type) {
+        for (auto const & wa : wire_attachments[type]) {
+            ship_file_attach fa;
+            memcpy(fa.transform, &wa.transform[0][0], sizeof(fa.transform));
+            fa.parent = wa.parent;
+            fa.rank = wa.rank;
+            fa.fixed = wa.fixed ? 1 : 0;
+            attach_tables[type].push_back(fa);
+        }
+
+        for (auto const & lookup : entity_to_attach_lookups[type]) {
+            auto e = entity_index.find(lookup.first);
+            if (e == entity_index.end())
+                continue;
+
+            for (auto attach : lookup.second) {
+                ship_file_entity_attach fea = { e->second, attach };
+                entity_attach_tables[type].push_back(fea);
+            }
+        }
+
+        h.num_attaches[type] = (uint32_t)attach_tables[type].size();
+        h.num_segments[type] = (uint32_t)wire_segments[type].size();
+        h.num_entity_attaches[type] = (uint32_t)entity_attach_tables[type].size();
+    }
+
+    /* lay out the file */
+    uint64_t off = sizeof(h);
+    h.chunk_dir_offset = off;
+    off += sizeof(ship_file_chunk) * chunk_dir.size();
+    h.zone_offset = off;
+    off += sizeof(ship_file_zone) * zone_table.size();
+    h.entity_offset = off;
+    off += sizeof(ship_file_entity) * entity_table.size();
+    h.wire_offset = off;
+    for (auto type = 0; type < num_wire_types; ++type) {
+        off += sizeof(ship_file_attach) * attach_tables[type].size();
+        off += sizeof(wire_segment) * wire_segments[type].size();
+        off += sizeof(ship_file_entity_attach) * entity_attach_tables[type].size();
+    }
+
+    auto blocks_size = align_to_page(sizeof(fixed_cube<block, CHUNK_SIZE>));
+    auto zones_size = sizeof(uint32_t) * CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+
+    off = align_to_page(off);
+    for (auto & fc : chunk_dir) {
+        fc.blocks_offset = off;
+        off += blocks_size;
+    }
+    for (auto & fc : chunk_dir) {
+        fc.zones_offset = off;
+        off += zones_size;
+    }
+
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        printf("ship_space::save: failed to open %s\n", filename);
+        return false;
+    }
+
+    fwrite(&h, sizeof(h), 1, f);
+    fwrite(chunk_dir.data(), sizeof(ship_file_chunk), chunk_dir.size(), f);
+    fwrite(zone_table.data(), sizeof(ship_file_zone), zone_table.size(), f);
+    fwrite(entity_table.data(), sizeof(ship_file_entity), entity_table.size(), f);
+    for (auto type = 0; type < num_wire_types; ++type) {
+        fwrite(attach_tables[type].data(), sizeof(ship_file_attach), attach_tables[type].size(), f);
+        fwrite(wire_segments[type].data(), sizeof(wire_segment), wire_segments[type].size(), f);
+        fwrite(entity_attach_tables[type].data(), sizeof(ship_file_entity_attach),
+               entity_attach_tables[type].size(), f);
+    }
+
+    /* chunk payloads, in directory order. the file always has the blocks in full */
+    std::unique_ptr<chunk_blocks> blocks(new chunk_blocks());
+    for (auto const & fc : chunk_dir) {
+        write_padding(f, fc.blocks_offset);
+        chunk *ch = chunks.get(glm::ivec3(fc.x, fc.y, fc.z));
+        ch->blocks.store(&blocks->contents[0][0][0]);
+        fwrite(&blocks->contents, sizeof(blocks->contents), 1, f);
+    }
+
+    write_padding(f, chunk_dir.empty() ? off : chunk_dir[0].zones_offset);
+    fwrite(chunk_zones.data(), sizeof(uint32_t), chunk_zones.size(), f);
+
+    bool ok = !ferror(f);
+    fclose(f);
+
+    printf("ship_space::save: %s: %u chunks, %u zones, %u entities\n",
+           filename, h.num_chunks, h.num_zones, h.num_entities);
+
+    return ok;
+}
+
+
+/* whether count items of size bytes each, starting at off, lie inside a
+ * file of len bytes, and off is aligned for them */
+static bool
+in_file(size_t len, uint64_t off, uint64_t count, size_t size, size_t align)
+{
+    if (off % align || off > len)
+        return false;
+
+    return count <= (len - off) / size;
+}
+
+
+/* checks everything which load and page_in_chunk go on to read, so that a
+ * truncated or corrupt file can't take them outside the mapping. returns why
+ * the file is unusable, or null */
+static char const *
+check_ship_file(char const *base, size_t len, unsigned num_types)
+{
+    auto h = (ship_file_header const *)base;
+
+    if (h->magic != SHIP_FILE_MAGIC ||
+            h->version != SHIP_FILE_VERSION ||
+            h->chunk_size != CHUNK_SIZE ||
+            h->block_size != sizeof(block)) {
+        return "not a usable ship file";
+    }
+
+    if (!in_file(len, h->chunk_dir_offset, h->num_chunks,
+                 sizeof(ship_file_chunk), alignof(ship_file_chunk)))
+        return "chunk directory out of range";
+    if (!in_file(len, h->zone_offset, h->num_zones,
+                 sizeof(ship_file_zone), alignof(ship_file_zone)))
+        return "zone table out of range";
+    if (!in_file(len, h->entity_offset, h->num_entities,
+                 sizeof(ship_file_entity), alignof(ship_file_entity)))
+        return "entity table out of range";
+
+    /* chunks, and the zone of each of their blocks */
+    auto chunk_dir = (ship_file_chunk const *)(base + h->chunk_dir_offset);
+    std::unordered_set<glm::ivec3, ivec3_hash> chunk_coords;
+
+    for (auto i = 0u; i < h->num_chunks; i++) {
+        auto const *fc = &chunk_dir[i];
+        if (!chunk_coords.insert(glm::ivec3(fc->x, fc->y, fc->z)).second)
+            return "chunk listed twice";
+        if (!in_file(len, fc->blocks_offset, CHUNK_VOLUME, sizeof(block), alignof(block)))
+            return "chunk blocks out of range";
+        if (!in_file(len, fc->zones_offset, CHUNK_VOLUME, sizeof(uint32_t), alignof(uint32_t)))
+            return "chunk zones out of range";
+
+        /* zone 0 is the outside, which every file has */
+        auto zones = (uint32_t const *)(base + fc->zones_offset);
+        for (unsigned j = 0; j < CHUNK_VOLUME; j++) {
+            if (zones[j] && zones[j] >= h->num_zones)
+                return "block in a zone which doesn't exist";
+        }
+    }
+
+    /* only entities in a chunk can be placed */
+    auto entity_table = (ship_file_entity const *)(base + h->entity_offset);
+    for (auto i = 0u; i < h->num_entities; i++) {
+        glm::ivec3 ch;
+        split_block_coord(glm::ivec3(entity_table[i].x, entity_table[i].y, entity_table[i].z),
+                          nullptr, &ch);
+        if (!chunk_coords.count(ch))
+            return "entity outside of any chunk";
+        if (entity_table[i].face >= face_count)
+            return "entity on a face which doesn't exist";
+        if (entity_table[i].type >= num_types)
+            return "entity of a type which doesn't exist";
+    }
+
+    /* wiring. every index must land inside its own table */
+    uint64_t wire = h->wire_offset;
+    for (auto type = 0; type < num_wire_types; ++type) {
+        auto num_attaches = h->num_attaches[type];
+
+        if (!in_file(len, wire, num_attaches,
+                     sizeof(ship_file_attach), alignof(ship_file_attach)))
+            return "wire attaches out of range";
+        auto attaches = (ship_file_attach const *)(base + wire);
+        for (auto i = 0u; i < num_attaches; i++) {
+            if (attaches[i].parent >= num_attaches)
+                return "wire attach parent out of range";
+        }
+        wire += sizeof(ship_file_attach) * num_attaches;
+
+        if (!in_file(len, wire, h->num_segments[type],
+                     sizeof(wire_segment), alignof(wire_segment)))
+            return "wire segments out of range";
+        auto segments = (wire_segment const *)(base + wire);
+        for (auto i = 0u; i < h->num_segments[type]; i++) {
+            if (segments[i].first >= num_attaches || segments[i].second >= num_attaches)
+                return "wire segment end out of range";
+        }
+        wire += sizeof(wire_segment) * h->num_segments[type];
+
+        if (!in_file(len, wire, h->num_entity_attaches[type],
+                     sizeof(ship_file_entity_attach), alignof(ship_file_entity_attach)))
+            return "entity attaches out of range";
+        auto entity_attaches = (ship_file_entity_attach const *)(base + wire);
+        for (auto i = 0u; i < h->num_entity_attaches[type]; i++) {
+            if (entity_attaches[i].entity >= h->num_entities ||
+                    entity_attaches[i].attach >= num_attaches)
+                return "entity attach out of range";
+        }
+        wire += sizeof(ship_file_entity_attach) * h->num_entity_attaches[type];
+    }
+
+    return nullptr;
+}
+
+
+/* clears any value in a block from a file which isn't one the game knows,
+ * so that nothing indexes a table with it. returns whether it had to */
+static bool
+sanitize_block(block *b)
+{
+    bool changed = false;
+
+    if ((unsigned)b->type > block_entity) {
+        b->type = block_empty;
+        changed = true;
+    }
+
+    for (int face = 0; face < face_count; face++) {
+        switch (b->surfs[face]) {
+        case surface_none:
+        case surface_wall:
+        case surface_door:
+        case surface_grate:
+        case surface_glass:
+            break;
+        default:
+            b->surfs[face] = surface_none;
+            changed = true;
+            break;
+        }
+    }
+
+    return changed;
+}
+
+
+ship_space *
+ship_space::load(char const *filename,
+                 c_entity (*spawn)(glm::ivec3 p, unsigned type, int face),
+                 unsigned num_types)
+{
+    struct stat st;
+    if (stat(filename, &st) != 0 || (size_t)st.st_size < sizeof(ship_file_header)) {
+        return nullptr;
+    }
+
+    auto *file = new ship_file;
+    file->mapping = new blob(filename);
+
+    char const *base = (char const *)file->mapping->data;
+    auto h = (ship_file_header const *)base;
+
+    /* without spawn the entities are skipped, so their types don't matter */
+    char const *why = check_ship_file(base, file->mapping->len, spawn ? num_types : ~0u);
+    if (why) {
+        printf("ship_space::load: %s: %s\n", filename, why);
+        delete file;
+        return nullptr;
+    }
+
+    file->header = h;
+
+    ship_space *ss = new ship_space;
+    ss->file = file;
+    ss->mins = glm::ivec3(h->mins[0], h->mins[1], h->mins[2]);
+    ss->maxs = glm::ivec3(h->maxs[0], h->maxs[1], h->maxs[2]);
+
+    auto chunk_dir = (ship_file_chunk const *)(base + h->chunk_dir_offset);
+    for (auto i = 0u; i < h->num_chunks; i++) {
+        glm::ivec3 v(chunk_dir[i].x, chunk_dir[i].y, chunk_dir[i].z);
+        file->unloaded[v] = &chunk_dir[i];
+        ss->chunk_coords.push_back(v);
+    }
+
+    /* zones. the roots are never unified with anything directly -- blocks
+     * link to them as they page in, so give them rank to stay on top. */
+    auto zone_table = (ship_file_zone const *)(base + h->zone_offset);
+    file->zone_roots.resize(h->num_zones);
+    for (auto i = 0u; i < h->num_zones; i++) {
+        topo_info *t = i ? &file->zone_roots[i] : &ss->outside_topo_info;
+        t->p = t;
+        t->rank = 1;
+        t->size = zone_table[i].size;
+
+        if (i && zone_table[i].has_air) {
+            ss->zones[t] = new zone_info(zone_table[i].air_amount);
+        }
+    }
+
+    /* wiring */
+    char const *wire = base + h->wire_offset;
+    std::vector<c_entity> entities(h->num_entities);
+
+    for (auto type = 0; type < num_wire_types; ++type) {
+        auto attaches = (ship_file_attach const *)wire;
+        for (auto i = 0u; i < h->num_attaches[type]; i++) {
+            wire_attachment wa;
+            memcpy(&wa.transform[0][0], attaches[i].transform, sizeof(attaches[i].transform));
+            wa.parent = attaches[i].parent;
+            wa.rank = attaches[i].rank;
+            wa.fixed = attaches[i].fixed != 0;
+            ss->wire_attachments[type].push_back(wa);
+        }
+        wire += sizeof(ship_file_attach) * h->num_attaches[type];
+
+        auto segments = (wire_segment const *)wire;
+        ss->wire_segments[type].assign(segments, segments + h->num_segments[type]);
+        wire += sizeof(wire_segment) * h->num_segments[type];
+
+        /* entity attaches are fixed up once the entities exist */
+        wire += sizeof(ship_file_entity_attach) * h->num_entity_attaches[type];
+    }
+
+    /* entities */
+    if (spawn) {
+        auto entity_table = (ship_file_entity const *)(base + h->entity_offset);
+        for (auto i = 0u; i < h->num_entities; i++) {
+            auto p = glm::ivec3(entity_table[i].x, entity_table[i].y, entity_table[i].z);
+            auto ce = spawn(p, entity_table[i].type, (int)entity_table[i].face);
+            entities[i] = ce;
+
+            ss->get_chunk_containing(p)->entities.push_back(ce);
+        }
+
+        wire = base + h->wire_offset;
+        for (auto type = 0; type < num_wire_types; ++type) {
+            wire += sizeof(ship_file_attach) * h->num_attaches[type];
+            wire += sizeof(wire_segment) * h->num_segments[type];
+
+            auto entity_attaches = (ship_file_entity_attach const *)wire;
+            for (auto i = 0u; i < h->num_entity_attaches[type]; i++) {
+                auto ce = entities[entity_attaches[i].entity];
+                ss->entity_to_attach_lookups[type][ce].insert(entity_attaches[i].attach);
+            }
+            wire += sizeof(ship_file_entity_attach) * h->num_entity_attaches[type];
+        }
+    }
+
+    printf("ship_space::load: %s: %u chunks, %u zones, %u entities\n",
+           filename, h->num_chunks, h->num_zones, h->num_entities);
+
+    /* a file with nothing left to page in doesn't need to stay mapped */
+    if (file->unloaded.empty()) {
+        file->release_mapping();
+    }
+
+    return ss;
+}
+
+
+bool
+ship_space::has_chunk(glm::ivec3 v) const
+{
+    if (this->chunks.find(v)) {
+        return true;
+    }
+
+    return this->file && this->file->unloaded.count(v);
+}
+
+
+chunk *
+ship_space::page_in_chunk(glm::ivec3 v)
+{
+    if (!this->file) {
+        return nullptr;
+    }
+
+    auto it = this->file->unloaded.find(v);
+    if (it == this->file->unloaded.end()) {
+        return nullptr;
+    }
+
+    /* load() has already checked the offsets and zone indices */
+    char const *base = (char const *)this->file->mapping->data;
+    ship_file_chunk const *fc = it->second;
+
+    auto *ch = new chunk();
+    chunk_blocks blocks;
+    memcpy(&blocks.contents, base + fc->blocks_offset, sizeof(blocks.contents));
+
+    /* checked here rather than in load(), which would have to read every
+     * chunk's blocks */
+    unsigned bad = 0;
+    block *b = &blocks.contents[0][0][0];
+    for (unsigned i = 0; i < CHUNK_VOLUME; i++) {
+        bad += sanitize_block(&b[i]);
+    }
+    if (bad) {
+        printf("ship_space::page_in_chunk: %d,%d,%d: emptied %u damaged blocks\n",
+               v.x, v.y, v.z, bad);
+    }
+
+    ch->blocks.load(&blocks.contents[0][0][0]);
+    ch->refresh_faces();
+
+    /* link each block straight to its zone's root. a chunk which air passes
+     * right through is all one zone, and keeps the one shared node */
+    auto zones = (uint32_t const *)(base + fc->zones_offset);
+    for (unsigned i = 0; i < CHUNK_VOLUME; i++) {
+        auto zone = zones[i];
+        topo_info *t = ch->topo_at(i);
+        t->p = zone ? &this->file->zone_roots[zone] : &this->outside_topo_info;
+        t->rank = 0;
+        t->size = 0;
+    }
+
+    this->chunks.insert(v, ch);
+    this->file->unloaded.erase(it);
+
+    if (this->file->unloaded.empty()) {
+        this->file->release_mapping();
+    }
+
+    return ch;
+}
+
+
+void
+ship_space::page_in_all_chunks()
+{
+    if (!this->file) {
+        return;
+    }
+
+    while (!this->file->unloaded.empty()) {
+        page_in_chunk(this->file->unloaded.begin()->first);
+    }
+}
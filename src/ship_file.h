@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "ship_space.h"
+
+/* on-disk ship format
+ *
+ * everything is native-endian, and the block payloads are raw copies of
+ * chunk::blocks -- a file is only accepted if it was written with the same
+ * CHUNK_SIZE and sizeof(block) as the running build.
+ *
+ *   ship_file_header
+ *   ship_file_chunk[num_chunks]            chunk directory
+ *   ship_file_zone[num_zones]              zone 0 is always the outside
+ *   ship_file_entity[num_entities]
+ *   per wire type:
+ *     ship_file_attach[num_attaches]
+ *     wire_segment[num_segments]
+ *     ship_file_entity_attach[num_entity_attaches]
+ *   (pad to SHIP_FILE_PAGE_SIZE)
+ *   per chunk: fixed_cube<block, CHUNK_SIZE>, padded to SHIP_FILE_PAGE_SIZE
+ *   per chunk: uint32_t zone index for each block, in fixed_cube order
+ *
+ * the block and zone payloads are page aligned so that mapping the file and
+ * paging a chunk in only touches the pages belonging to that chunk.
+ */
+
+#define SHIP_FILE_MAGIC         0x53504e45u     /* "ENPS" */
+#define SHIP_FILE_VERSION       1
+#define SHIP_FILE_PAGE_SIZE     4096
+
+struct ship_file_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t chunk_size;
+    uint32_t block_size;
+
+    int32_t mins[3];
+    int32_t maxs[3];
+
+    uint32_t num_chunks;
+    uint32_t num_zones;
+    uint32_t num_entities;
+    uint32_t num_attaches[num_wire_types];
+    uint32_t num_segments[num_wire_types];
+    uint32_t num_entity_attaches[num_wire_types];
+
+    uint64_t chunk_dir_offset;
+    uint64_t zone_offset;
+    uint64_t entity_offset;
+    uint64_t wire_offset;
+};
+
+struct ship_file_chunk {
+    int32_t x, y, z;
+    uint32_t pad;
+    uint64_t blocks_offset;
+    uint64_t zones_offset;
+};
+
+struct ship_file_zone {
+    int32_t size;           /* number of blocks in the zone */
+    uint32_t has_air;       /* whether there was a zone_info for this zone */
+    float air_amount;
+    uint32_t pad;
+};
+
+struct ship_file_entity {
+    uint32_t type;
+    int32_t x, y, z;
+    uint32_t face;
+};
+
+struct ship_file_attach {
+    float transform[16];
+    uint32_t parent;
+    uint32_t rank;
+    uint32_t fixed;
+};
+
+struct ship_file_entity_attach {
+    uint32_t entity;        /* index into the entity table */
+    uint32_t attach;
+};
+
+struct blob;
+
+/* a mapped ship file backing a ship_space. chunks are copied out of the
+ * mapping the first time ship_space::get_chunk asks for them.
+ */
+struct ship_file {
+    blob *mapping;
+    ship_file_header const *header;
+
+    /* chunks which have not been paged in yet */
+    std::unordered_map<glm::ivec3, ship_file_chunk const *, ivec3_hash> unloaded;
+
+    /* stand-in union-find roots for each zone in the file. blocks paged in
+     * from the file are linked directly to these. zone 0 is not used; those
+     * blocks link to ship_space::outside_topo_info instead.
+     *
+     * these outlive the mapping, and are only released by a full topology rebuild.
+     */
+    std::vector<topo_info> zone_roots;
+
+    ship_file() : mapping(nullptr), header(nullptr) {}
+    ~ship_file();
+
+    bool owns_root(topo_info const *t) const {
+        return !zone_roots.empty() &&
+            t >= &zone_roots[0] && t < &zone_roots[0] + zone_roots.size();
+    }
+
+    /* drop the mapping once every chunk has been paged in */
+    void release_mapping();
+};
@@ -1,16 +1,32 @@
 #include "ship_space.h"
+#include "ship_file.h"
+#include "chunk_cursor.h"
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
 #include <math.h>
+#include <thread>
 
 
 #define MAX_WIRE_INSTANCES 64 * 1024
 
+/* how many blocks a local split fill may visit before giving up and
+ * rebuilding the topology from scratch */
+#define MAX_SPLIT_FILL_BLOCKS 64 * 1024
+
+/* a full topology rebuild doesn't bother with another thread for fewer chunks than this */
+#define MIN_REBUILD_CHUNKS_PER_THREAD 8
 
 /* create an empty ship_space */
 ship_space::ship_space(void)
-    : mins(), maxs(),
-      num_full_rebuilds(0), num_fast_unifys(0), num_fast_nosplits(0), num_false_splits(0)
+    : mins(), maxs(), file(nullptr),
+      num_full_rebuilds(0), num_fast_unifys(0), num_fast_nosplits(0),
+      num_fast_splits(0), num_false_splits(0)
 {
+    outside_topo_info.p = &outside_topo_info;
+    outside_topo_info.rank = 0;
+    outside_topo_info.size = 0;
+
     /* start rather large */
     power_wires.reserve(MAX_WIRE_INSTANCES);
 
@@ -21,41 +37,12 @@ ship_space::ship_space(void)
 }
 
 
-static void
-split_coord(int p, int *out_block, int *out_chunk)
-{
-    /* NOTE: There are a number of attractive-looking symmetries which are
-     * just plain wrong. */
-    int block, chunk;
-
-    if (p < 0) {
-        /* negative space is not a mirror of positive:
-         * chunk -1 spans blocks -8..-1;
-         * chunk -2 spans blocks -16..-9 */
-        chunk = (p - CHUNK_SIZE + 1) / CHUNK_SIZE;
-    } else {
-        /* positive halfspace has no rocket science. */
-        chunk = p / CHUNK_SIZE;
-    }
-
-    /* the within-chunk offset is just the difference between the minimum block
-     * in the chunk and the requested one, regardless of which halfspace we're in. */
-    block = p - CHUNK_SIZE * chunk;
-
-    /* write the outputs which were requested */
-    if (out_block)
-        *out_block = block;
-    if (out_chunk)
-        *out_chunk = chunk;
-}
-
-
 /* returns a block or null
  * finds the block at the position (x,y,z) within
  * the whole ship_space
  * will move across chunks
  */
-block *
+block const *
 ship_space::get_block(glm::ivec3 block)
 {
     /* Within Block coordinates */
@@ -75,6 +62,21 @@ ship_space::get_block(glm::ivec3 block)
     return c->blocks.get(wb_x, wb_y, wb_z);
 }
 
+block *
+ship_space::edit_block(glm::ivec3 block)
+{
+    glm::ivec3 bl, ch;
+    split_block_coord(block, &bl, &ch);
+
+    chunk *c = this->get_chunk(ch);
+
+    if( ! c ){
+        return 0;
+    }
+
+    return c->blocks.edit(bl.x, bl.y, bl.z);
+}
+
 /* returns a topo_info or null
  * finds the topo_info at the position (x,y,z) within
  * the whole ship_space
@@ -97,7 +99,7 @@ ship_space::get_topo_info(glm::ivec3 block)
         return &this->outside_topo_info;
     }
 
-    return c->topo.get(wb_x, wb_y, wb_z);
+    return c->topo_at(chunk_block_index(wb_x, wb_y, wb_z));
 }
 
 zone_info *
@@ -131,9 +133,14 @@ ship_space::get_chunk_containing(glm::ivec3 block)
 chunk *
 ship_space::get_chunk(glm::ivec3 ch)
 {
-    auto it = this->chunks.find(ch);
-    if( it != this->chunks.end() ){
-        return it->second;
+    chunk *c = this->chunks.get(ch);
+    if( c ){
+        return c;
+    }
+
+    /* not resident, but it may still be waiting in the backing file */
+    if (this->file) {
+        return page_in_chunk(ch);
     }
 
     return nullptr;
@@ -181,7 +188,7 @@ ship_space::raycast(glm::vec3 o, glm::vec3 d, raycast_info *rc)
     int ny = 0;
     int nz = 0;
 
-    block *bl = nullptr;
+    block const *bl = nullptr;
 
     bl = this->get_block(glm::ivec3(x,y,z));
     rc->inside = bl ? bl->type != block_empty : 0;
@@ -277,7 +284,7 @@ ship_space::ensure_block(glm::ivec3 block)
     /* guarantee we have the size we need */
     this->ensure_chunk(ch);
 
-    return get_block(block);
+    return edit_block(block);
 }
 
 /* internal helper for creating chunks in a valid state.
@@ -293,16 +300,10 @@ create_chunk(ship_space *ship)
     auto *ch = new chunk();
 
     /* All the topo nodes in the new chunk should be attached
-     * to the outside node.
+     * to the outside node. The chunk is empty, so they are all
+     * the one shared node until something divides it.
      */
-    for (auto k = 0; k < CHUNK_SIZE; k++) {
-        for (auto j = 0; j < CHUNK_SIZE; j++) {
-            for (auto i = 0; i < CHUNK_SIZE; i++) {
-                topo_info *t = ch->topo.get(i, j, k);
-                t->p = &ship->outside_topo_info;
-            }
-        }
-    }
+    ch->topo_shared.p = &ship->outside_topo_info;
 
     /* Adjust the size of the outside chunk. This is currently not
      * used for anything, but the consistency is nice and the cost is negligible.
@@ -311,34 +312,102 @@ create_chunk(ship_space *ship)
     return ch;
 }
 
+static bool
+in_bounds(ship_space const *ship, glm::ivec3 v)
+{
+    return v.x >= ship->mins.x && v.y >= ship->mins.y && v.z >= ship->mins.z &&
+           v.x <= ship->maxs.x && v.y <= ship->maxs.y && v.z <= ship->maxs.z;
+}
+
+static void
+add_chunk(ship_space *ship, glm::ivec3 v, chunk *ch)
+{
+    ship->chunks.insert(v, ch);
+    ship->chunk_coords.push_back(v);
+}
+
+/* a missing chunk is treated as outside. that is only right if it really is
+ * -- if a path through missing chunks leads out of the ship's bounds. a
+ * pocket of missing chunks closed off by real ones would otherwise vent
+ * whatever room surrounds it.
+ *
+ * a new chunk at v can only close off missing chunks next to it, so flood
+ * out from each of those; any flood which cannot reach the bounds is a
+ * pocket, and gets real (empty) chunks.
+ */
+static void
+fill_enclosed_chunks(ship_space *ship, glm::ivec3 v)
+{
+    std::unordered_set<glm::ivec3, ivec3_hash> reaches_outside;
+
+    for (int i = 0; i < face_count; i++) {
+        glm::ivec3 start = v + surface_index_to_normal(i);
+        if (!in_bounds(ship, start) || ship->has_chunk(start) || reaches_outside.count(start)) {
+            continue;
+        }
+
+        std::unordered_set<glm::ivec3, ivec3_hash> seen;
+        std::vector<glm::ivec3> pocket;
+        bool escaped = false;
+
+        seen.insert(start);
+        pocket.push_back(start);
+
+        for (size_t head = 0; head < pocket.size() && !escaped; head++) {
+            for (int j = 0; j < face_count; j++) {
+                glm::ivec3 q = pocket[head] + surface_index_to_normal(j);
+                if (!in_bounds(ship, q) || reaches_outside.count(q)) {
+                    escaped = true;
+                    break;
+                }
+
+                if (seen.count(q) || ship->has_chunk(q)) {
+                    continue;
+                }
+
+                seen.insert(q);
+                pocket.push_back(q);
+            }
+        }
+
+        if (escaped) {
+            reaches_outside.insert(seen.begin(), seen.end());
+            continue;
+        }
+
+        for (auto c : pocket) {
+            add_chunk(ship, c, create_chunk(ship));
+        }
+    }
+}
+
 /* ensure that the specified chunk exists
  *
- * this will instantiate a new chunk if necessary -- any other possibly-enclosed
- * missing chunks to unconfuse the atmo system.
+ * this will instantiate a new chunk if necessary -- and any missing chunks
+ * which it encloses, to unconfuse the atmo system.
  */
 chunk *
 ship_space::ensure_chunk(glm::ivec3 v)
 {
-    /* automatically creates the entry if not present */
-    auto &ch = this->chunks[v];
-    if (!ch) {
+    /* pages the chunk in if it is still in the backing file */
+    chunk *existing = this->get_chunk(v);
+    if (existing) {
+        return existing;
+    }
+
+    if (this->chunk_coords.empty()) {
+        this->mins = v;
+        this->maxs = v;
+    }
+    else {
         this->mins = glm::min(this->mins, v);
         this->maxs = glm::max(this->maxs, v);
+    }
 
-        ch = create_chunk(this);
+    chunk *ch = create_chunk(this);
+    add_chunk(this, v, ch);
 
-        /* ensure any other missing possibly-enclosed chunks exist too */
-        for (auto k = this->mins.z + 1; k < this->maxs.z; k++) {
-            for (auto j = this->mins.y + 1; j < this->maxs.y; j++) {
-                for (auto i = this->mins.x + 1; i < this->maxs.x; i++) {
-                    auto &other_ch = this->chunks[glm::ivec3(i, j, k)];
-                    if (!other_ch) {
-                        other_ch = create_chunk(this);
-                    }
-                }
-            }
-        }
-    }
+    fill_enclosed_chunks(this, v);
 
     return ch;
 }
@@ -430,41 +499,161 @@ ship_space::update_topology_for_remove_surface(glm::ivec3 a, glm::ivec3 b)
     if (z2) { insert_zone(v, z2); }
 }
 
-static bool
-exists_alt_path(int x, int y, int z, block *a, block *b, ship_space *ship, int face)
+static glm::ivec3 dirs[] = {
+    glm::ivec3(1, 0, 0),
+    glm::ivec3(-1, 0, 0),
+    glm::ivec3(0, 1, 0),
+    glm::ivec3(0, -1, 0),
+    glm::ivec3(0, 0, 1),
+    glm::ivec3(0, 0, -1),
+};
+
+topo_info *
+ship_space::new_topo_root()
 {
-    block *c;
+    topo_roots.emplace_back();
+    topo_info *t = &topo_roots.back();
+    t->p = t;
+    t->rank = 1;
+    t->size = 0;
+    return t;
+}
 
-    if (face != surface_xp) {
-        c = ship->get_block(glm::ivec3(x+1, y, z));
-        if (air_permeable(a->surfs[surface_xp]) && air_permeable(b->surfs[surface_xp]) &&
-                (!c || air_permeable(c->surfs[face])))
-            return true;
-        c = ship->get_block(glm::ivec3(x-1, y, z));
-        if (air_permeable(a->surfs[surface_xm]) && air_permeable(b->surfs[surface_xm]) &&
-                (!c || air_permeable(c->surfs[face])))
-            return true;
+/* distributes air_amount between the zones at t1 and t2 in proportion to
+ * their sizes, creating zone_infos as needed. */
+void
+ship_space::split_zone(topo_info *t1, topo_info *t2, float air_amount)
+{
+    /* fixup the zones for the split. we want to maintain the same pressure
+     * we had on both sides, so distribute the mass */
+    zone_info *z1 = get_zone_info(t1);
+    if (!z1) {
+        z1 = zones[t1] = new zone_info(0);
     }
 
-    if (face != surface_yp) {
-        c = ship->get_block(glm::ivec3(x, y+1, z));
-        if (air_permeable(a->surfs[surface_yp]) && air_permeable(b->surfs[surface_yp]) &&
-                (!c || air_permeable(c->surfs[face])))
-            return true;
-        c = ship->get_block(glm::ivec3(x, y-1, z));
-        if (air_permeable(a->surfs[surface_ym]) && air_permeable(b->surfs[surface_ym]) &&
-                (!c || air_permeable(c->surfs[face])))
-            return true;
+    zone_info *z2 = get_zone_info(t2);
+    if (!z2) {
+        z2 = zones[t2] = new zone_info(0);
+    }
+
+    z1->air_amount = air_amount * t1->size / (t1->size + t2->size);
+    z2->air_amount = air_amount - z1->air_amount;
+}
+
+/* one side of a split fill: everything reached so far, and what is still to expand */
+struct split_fill {
+    std::unordered_set<glm::ivec3, ivec3_hash> seen;
+    std::vector<glm::ivec3> queue;
+    size_t head;
+    bool outside;       /* reached open space */
+
+    split_fill(glm::ivec3 start) : head(0), outside(false)
+    {
+        seen.insert(start);
+        queue.push_back(start);
     }
 
-    if (face != surface_zp) {
-        c = ship->get_block(glm::ivec3(x, y, z+1));
-        if (air_permeable(a->surfs[surface_zp]) && air_permeable(b->surfs[surface_zp]) &&
-                (!c || air_permeable(c->surfs[face])))
+    bool done() const { return head == queue.size(); }
+};
+
+bool
+ship_space::split_topology_locally(glm::ivec3 a, glm::ivec3 b)
+{
+    /* fill out from both sides of the new surface, always growing whichever
+     * side is smaller so far. either the fills meet, and nothing was split, or
+     * the smaller side runs out of blocks first and is exactly the piece cut off.
+     * a side which reaches the outside is unbounded, so is never the one to finish.
+     */
+    split_fill side_a(a), side_b(b);
+    split_fill *f, *other;
+
+    for (;;) {
+        if (side_a.outside && side_b.outside) {
+            num_fast_nosplits++;
             return true;
-        c = ship->get_block(glm::ivec3(x, y, z-1));
-        if (air_permeable(a->surfs[surface_zm]) && air_permeable(b->surfs[surface_zm]) &&
-                (!c || air_permeable(c->surfs[face])))
+        }
+        else if (side_a.outside || (!side_b.outside && side_b.seen.size() < side_a.seen.size())) {
+            f = &side_b;
+            other = &side_a;
+        }
+        else {
+            f = &side_a;
+            other = &side_b;
+        }
+
+        if (f->done()) {
+            break;
+        }
+
+        if (side_a.seen.size() + side_b.seen.size() > MAX_SPLIT_FILL_BLOCKS) {
+            return false;
+        }
+
+        glm::ivec3 p = f->queue[f->head++];
+        block const *bl = get_block(p);
+
+        for (int i = 0; i < 6; i++) {
+            if (!air_permeable(bl->surfs[i])) {
+                continue;
+            }
+
+            glm::ivec3 q = p + dirs[i];
+            if (other->seen.find(q) != other->seen.end()) {
+                num_fast_nosplits++;
+                return true;
+            }
+
+            if (!get_block(q)) {
+                f->outside = true;
+            }
+            else if (f->seen.insert(q).second) {
+                f->queue.push_back(q);
+            }
+        }
+    }
+
+    /* the finished side is the piece which was cut off. its blocks can only
+     * be relabelled if none of them is a parent of some block on the other
+     * side; rank 0 means a node has never had anything linked under it. */
+    for (auto p : f->seen) {
+        if (get_topo_info(p)->rank != 0) {
+            return false;
+        }
+    }
+
+    topo_info *old_root = topo_find(get_topo_info(a));
+    zone_info *zone = get_zone_info(old_root);
+
+    topo_info *new_root = new_topo_root();
+    for (auto p : f->seen) {
+        get_topo_info(p)->p = new_root;
+    }
+
+    new_root->size = (int)f->seen.size();
+    old_root->size -= new_root->size;
+
+    if (zone) {
+        split_zone(old_root, new_root, zone->air_amount);
+    }
+
+    num_fast_splits++;
+    return true;
+}
+
+static bool
+exists_alt_path(chunk_cursor *a_cur, block const *a, block const *b, int face)
+{
+    /* for each direction perpendicular to face, is there a route around the
+     * surface through the pair of blocks on that side? */
+    for (int side = 0; side < 6; side++) {
+        if ((side >> 1) == (face >> 1))
+            continue;
+
+        if (!air_permeable(a->surfs[side]) || !air_permeable(b->surfs[side]))
+            continue;
+
+        block const *c = a_cur->neighbor_block(side);
+        if (!c || air_permeable(c->surfs[face]))
             return true;
     }
 
@@ -487,11 +676,17 @@ ship_space::update_topology_for_add_surface(glm::ivec3 a, glm::ivec3 b, int face
     }
 
     /* try to quickly prove that we don't divide space */
-    if (exists_alt_path(a.x, a.y, a.z, get_block(a), get_block(b), this, face)) {
+    auto a_cur = chunk_cursor::at_block(this, a);
+    if (exists_alt_path(&a_cur, a_cur.get_block(), get_block(b), face)) {
         num_fast_nosplits++;
         return;
     }
 
+    /* most splits can be settled by filling out from both sides */
+    if (split_topology_locally(a, b)) {
+        return;
+    }
+
     /* grab our air amount data before rebuild_topology invalidates the existing zones */
     zone_info *zone = get_zone_info(topo_find(get_topo_info(a)));
     float air_amount = zone ? zone->air_amount : 0.0f;
@@ -509,167 +704,290 @@ ship_space::update_topology_for_add_surface(glm::ivec3 a, glm::ivec3 b, int face
     }
     else if (zone) {
         /* at least one side was real before this split */
+        split_zone(t1, t2, air_amount);
+    }
+}
 
-        /* fixup the zones for the split. we want to maintain the same pressure
-         * we had on both sides, so distribute the mass */
-        zone_info *z1 = get_zone_info(t1);
-        if (!z1) {
-            z1 = zones[t1] = new zone_info(0);
-        }
+/* index of within-chunk block coordinates p into a chunk's fixed_cubes */
+static inline uint32_t
+chunk_block_index(glm::ivec3 p)
+{
+    return chunk_block_index(p.x, p.y, p.z);
+}
 
-        zone_info *z2 = get_zone_info(t2);
-        if (!z2) {
-            z2 = zones[t2] = new zone_info(0);
+static inline bool
+in_chunk(glm::ivec3 p)
+{
+    return p.x >= 0 && p.x < CHUNK_SIZE &&
+           p.y >= 0 && p.y < CHUNK_SIZE &&
+           p.z >= 0 && p.z < CHUNK_SIZE;
+}
+
+/* runs f(i) for each i in [0, n), spread across the machine's cores */
+template<typename F>
+static void
+parallel_for(size_t n, F f)
+{
+    size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::min(num_threads, n / MIN_REBUILD_CHUNKS_PER_THREAD);
+
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for (size_t i; (i = next++) < n; ) {
+            f(i);
         }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; i++) {
+        threads.emplace_back(work);
+    }
 
-        z1->air_amount = air_amount * t1->size / (t1->size + t2->size);
-        z2->air_amount = air_amount - z1->air_amount;
+    work();
+
+    for (auto & t : threads) {
+        t.join();
     }
 }
 
-static glm::ivec3 dirs[] = {
-    glm::ivec3(1, 0, 0),
-    glm::ivec3(-1, 0, 0),
-    glm::ivec3(0, 1, 0),
-    glm::ivec3(0, -1, 0),
-    glm::ivec3(0, 0, 1),
-    glm::ivec3(0, 0, -1),
-};
+/* scratch union-find used by a full rebuild. nodes are indices rather than
+ * topo_infos so that the links can be atomic: node 0 is the outside, and block
+ * i of the n'th chunk is node 1 + n * CHUNK_VOLUME + i.
+ *
+ * links only ever point from a higher index to a lower one, so threads can race
+ * to unite without creating cycles, and every component ends up rooted at its
+ * lowest node -- the outside, if it is connected to it at all.
+ */
+struct topo_build {
+    std::vector<std::atomic<uint32_t>> p;
+
+    topo_build(size_t n) : p(n)
+    {
+        p[0] = 0;
+    }
+
+    uint32_t find(uint32_t x)
+    {
+        for (;;) {
+            uint32_t px = p[x].load(std::memory_order_relaxed);
+            if (px == x) {
+                return x;
+            }
 
+            /* path halving. losing the race here is harmless; px is still an ancestor */
+            uint32_t gx = p[px].load(std::memory_order_relaxed);
+            if (gx != px) {
+                p[x].compare_exchange_weak(px, gx, std::memory_order_relaxed);
+            }
+
+            x = gx;
+        }
+    }
+
+    void unite(uint32_t a, uint32_t b)
+    {
+        for (;;) {
+            a = find(a);
+            b = find(b);
+            if (a == b) {
+                return;
+            }
+
+            if (a < b) {
+                std::swap(a, b);
+            }
+
+            /* link the higher root under the lower. if a is no longer a root,
+             * someone else got there first; try again from the top */
+            if (p[a].compare_exchange_weak(a, b, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+};
 
 /* rebuild the ship topology. this is generally not the optimal thing -
  * we can dynamically rebuild parts of the topology cheaper based on
  * knowing the change that was made.
+ *
+ * the work is split by chunk across all cores: each chunk is united internally,
+ * then across its boundaries, then each block is pointed at its final root.
  */
 void
 ship_space::rebuild_topology()
 {
     num_full_rebuilds++;
 
-    /* 1/ initially, every block is its own subtree */
-    for (auto it = chunks.begin(); it != chunks.end(); it++) {
-        for (int z = 0; z < CHUNK_SIZE; z++) {
-            for (int y = 0; y < CHUNK_SIZE; y++) {
-                for (int x = 0; x < CHUNK_SIZE; x++) {
-                    topo_info *t = it->second->topo.get(x, y, z);
-                    t->p = t;
-                    t->rank = 0;
-                    t->size = 0;
+    /* 0/ everything must be resident. zones are keyed by their root, and none of
+     * the roots survive the rebuild; remember a real block in each zone so its
+     * zone_info can be carried across. */
+    page_in_all_chunks();
+
+    std::unordered_map<topo_info *, topo_info *> zone_reps;
+    if (!zones.empty()) {
+        for (auto it = chunks.begin(); it != chunks.end(); it++) {
+            for (chunk_cursor c(this, it->first); c.valid(); c.next()) {
+                topo_info *root = topo_find(c.get_topo());
+                if (zones.find(root) != zones.end() &&
+                        zone_reps.find(root) == zone_reps.end()) {
+                    zone_reps[root] = c.get_topo();
                 }
             }
         }
     }
 
-    this->outside_topo_info.p = &this->outside_topo_info;
-    this->outside_topo_info.rank = 0;
-    this->outside_topo_info.size = 0;
+    /* the old roots must stay alive until the zones have been moved across */
+    std::deque<topo_info> old_roots;
+    old_roots.swap(topo_roots);
 
-    /* 2/ combine across air-permeable interfaces */
+    std::vector<chunk_index::entry> chunk_list;
+    std::unordered_map<glm::ivec3, uint32_t, ivec3_hash> chunk_nums;
     for (auto it = chunks.begin(); it != chunks.end(); it++) {
-        for (int z = 1; z < CHUNK_SIZE - 1; z++) {
-            for (int y = 1; y < CHUNK_SIZE - 1; y++) {
-                for (int x = 1; x < CHUNK_SIZE - 1; x++) {
-                    block *bl = it->second->blocks.get(x, y, z);
+        chunk_nums[it->first] = (uint32_t)chunk_list.size();
+        chunk_list.push_back(*it);
+    }
+
+    topo_build build(1 + chunk_list.size() * CHUNK_VOLUME);
+
+    /* 1/ initially, every block is its own subtree; combine across air-permeable
+     * interfaces within each chunk */
+    parallel_for(chunk_list.size(), [&](size_t n) {
+        chunk *ch = chunk_list[n].second;
+        uint32_t base = 1 + (uint32_t)n * CHUNK_VOLUME;
+
+        for (uint32_t i = 0; i < CHUNK_VOLUME; i++) {
+            build.p[base + i].store(base + i, std::memory_order_relaxed);
+        }
+
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            for (int y = 0; y < CHUNK_SIZE; y++) {
+                for (int z = 0; z < CHUNK_SIZE; z++) {
+                    glm::ivec3 p(x, y, z);
+                    uint32_t bi = chunk_block_index(p);
 
                     for (int i = 0; i < 6; i++) {
-                        if (air_permeable(bl->surfs[i])) {
-                            glm::ivec3 offset = dirs[i];
-                            topo_unite(it->second->topo.get(x, y, z),
-                                       it->second->topo.get(x + offset.x, y + offset.y, z + offset.z));
+                        glm::ivec3 q = p + dirs[i];
+                        if (ch->faces.air_open(bi, i) && in_chunk(q)) {
+                            build.unite(base + chunk_block_index(p), base + chunk_block_index(q));
                         }
                     }
                 }
             }
         }
+    });
 
-        for (int z = 0; z < CHUNK_SIZE; z++) {
-            for (int y = 0; y < CHUNK_SIZE; y++) {
-                block *bl = it->second->blocks.get(0, y, z);
-                topo_info *to = it->second->topo.get(0, y, z);
-
-                for (int i = 0; i < 6; i++) {
-                    if (air_permeable(bl->surfs[i])) {
-                        glm::ivec3 offset = dirs[i];
-                        topo_unite(to,
-                            get_topo_info(CHUNK_SIZE * it->first + glm::ivec3(0, y, z) + offset));
-                    }
-                }
+    /* 2/ combine across air-permeable interfaces between chunks, and with the outside */
+    parallel_for(chunk_list.size(), [&](size_t n) {
+        chunk *ch = chunk_list[n].second;
+        uint32_t base = 1 + (uint32_t)n * CHUNK_VOLUME;
 
-                bl = it->second->blocks.get(CHUNK_SIZE - 1, y, z);
-                to = it->second->topo.get(CHUNK_SIZE - 1, y, z);
+        uint32_t neighbor_base[6];
+        for (int i = 0; i < 6; i++) {
+            auto it = chunk_nums.find(chunk_list[n].first + dirs[i]);
+            neighbor_base[i] = it == chunk_nums.end() ? 0 : 1 + it->second * CHUNK_VOLUME;
+        }
 
-                for (int i = 0; i < 6; i++) {
-                    if (air_permeable(bl->surfs[i])) {
-                        glm::ivec3 offset = dirs[i];
-                        topo_unite(to,
-                            get_topo_info(CHUNK_SIZE * it->first + glm::ivec3(CHUNK_SIZE - 1, y, z) + offset));
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            for (int y = 0; y < CHUNK_SIZE; y++) {
+                for (int z = 0; z < CHUNK_SIZE; z++) {
+                    glm::ivec3 p(x, y, z);
+                    if (x > 0 && x < CHUNK_SIZE - 1 && y > 0 && y < CHUNK_SIZE - 1 &&
+                            z > 0 && z < CHUNK_SIZE - 1) {
+                        continue;
                     }
-                }
 
-                bl = it->second->blocks.get(y, 0, z);
-                to = it->second->topo.get(y, 0, z);
-
-                for (int i = 0; i < 6; i++) {
-                    if (air_permeable(bl->surfs[i])) {
-                        glm::ivec3 offset = dirs[i];
-                        topo_unite(to,
-                            get_topo_info(CHUNK_SIZE * it->first + glm::ivec3(y, 0, z) + offset));
-                    }
-                }
+                    uint32_t bi = chunk_block_index(p);
 
-                bl = it->second->blocks.get(y, CHUNK_SIZE - 1, z);
-                to = it->second->topo.get(y, CHUNK_SIZE - 1, z);
+                    for (int i = 0; i < 6; i++) {
+                        glm::ivec3 q = p + dirs[i];
+                        if (!ch->faces.air_open(bi, i) || in_chunk(q)) {
+                            continue;
+                        }
 
-                for (int i = 0; i < 6; i++) {
-                    if (air_permeable(bl->surfs[i])) {
-                        glm::ivec3 offset = dirs[i];
-                        topo_unite(to,
-                            get_topo_info(CHUNK_SIZE * it->first + glm::ivec3(y, CHUNK_SIZE - 1, z) + offset));
+                        /* the outside is a single node */
+                        uint32_t other = neighbor_base[i] ?
+                            neighbor_base[i] + chunk_block_index(q - dirs[i] * CHUNK_SIZE) : 0;
+                        build.unite(base + chunk_block_index(p), other);
                     }
                 }
+            }
+        }
+    });
 
-                bl = it->second->blocks.get(y, z, 0);
-                to = it->second->topo.get(y, z, 0);
-
-                for (int i = 0; i < 6; i++) {
-                    if (air_permeable(bl->surfs[i])) {
-                        glm::ivec3 offset = dirs[i];
-                        topo_unite(to,
-                            get_topo_info(CHUNK_SIZE * it->first + glm::ivec3(y, z, 0) + offset));
-                    }
-                }
+    /* 3/ flatten, and count the blocks each chunk contributes to each root */
+    std::vector<std::vector<std::pair<uint32_t, int>>> chunk_sizes(chunk_list.size());
+    parallel_for(chunk_list.size(), [&](size_t n) {
+        uint32_t base = 1 + (uint32_t)n * CHUNK_VOLUME;
+        uint32_t roots[CHUNK_VOLUME];
 
-                bl = it->second->blocks.get(y, z, CHUNK_SIZE - 1);
-                to = it->second->topo.get(y, z, CHUNK_SIZE - 1);
+        for (uint32_t i = 0; i < CHUNK_VOLUME; i++) {
+            roots[i] = build.find(base + i);
+            build.p[base + i].store(roots[i], std::memory_order_relaxed);
+        }
 
-                for (int i = 0; i < 6; i++) {
-                    if (air_permeable(bl->surfs[i])) {
-                        glm::ivec3 offset = dirs[i];
-                        topo_unite(to,
-                            get_topo_info(CHUNK_SIZE * it->first + glm::ivec3(y, z, CHUNK_SIZE - 1) + offset));
-                    }
-                }
+        std::sort(roots, roots + CHUNK_VOLUME);
+        for (uint32_t i = 0; i < CHUNK_VOLUME; i++) {
+            if (i == 0 || roots[i] != roots[i - 1]) {
+                chunk_sizes[n].push_back(std::make_pair(roots[i], 0));
             }
+            chunk_sizes[n].back().second++;
         }
-    }
+    });
 
-    /* 3/ finalize, and accumulate sizes */
-    for (auto it = chunks.begin(); it != chunks.end(); it++) {
-        for (int z = 0; z < CHUNK_SIZE; z++) {
-            for (int y = 0; y < CHUNK_SIZE; y++) {
-                for (int x = 0; x < CHUNK_SIZE; x++) {
-                    topo_info *t = topo_find(it->second->topo.get(x, y, z));
-                    t->size++;
-                }
+    /* 4/ give each component a root which belongs to no block -- see
+     * ship_space::topo_roots -- and point every block directly at it */
+    this->outside_topo_info.p = &this->outside_topo_info;
+    this->outside_topo_info.rank = 0;
+    this->outside_topo_info.size = 0;
+
+    std::unordered_map<uint32_t, topo_info *> root_nodes;
+    root_nodes[0] = &this->outside_topo_info;
+    for (auto & sizes : chunk_sizes) {
+        for (auto & s : sizes) {
+            topo_info *&t = root_nodes[s.first];
+            if (!t) {
+                t = new_topo_root();
             }
+            t->size += s.second;
         }
     }
 
-    /* 4/ fixup zone_info */
+    parallel_for(chunk_list.size(), [&](size_t n) {
+        chunk *ch = chunk_list[n].second;
+        uint32_t base = 1 + (uint32_t)n * CHUNK_VOLUME;
+
+        /* a chunk still sharing one node is all one piece */
+        ch->topo_shared.p = root_nodes.find(build.p[base].load(std::memory_order_relaxed))->second;
+        ch->topo_shared.rank = 0;
+        ch->topo_shared.size = 0;
+
+        if (!ch->topo)
+            return;
+
+        topo_info *t = &ch->topo->contents[0][0][0];
+        for (uint32_t i = 0; i < CHUNK_VOLUME; i++) {
+            t[i].p = root_nodes.find(build.p[base + i].load(std::memory_order_relaxed))->second;
+            t[i].rank = 0;
+            t[i].size = 0;
+        }
+    });
+
+    /* 5/ fixup zone_info */
     std::unordered_map<topo_info *, zone_info *> old_zones(std::move(zones));
     for (auto it : old_zones) {
-        insert_zone(topo_find(it.first), it.second);
+        auto rep = zone_reps.find(it.first);
+        if (rep != zone_reps.end()) {
+            insert_zone(topo_find(rep->second), it.second);
+        }
+        else {
+            /* a zone with no blocks left in it */
+            delete it.second;
+        }
     }
+
+    /* nothing refers to the file's zone roots anymore */
+    delete this->file;
+    this->file = nullptr;
 }
 
 
@@ -678,39 +996,48 @@ ship_space::validate()
 {
     bool pass = true;
 
+    page_in_all_chunks();
+
     for (auto ch : chunks) {
-        for (int z = 0; z < CHUNK_SIZE; z++) {
-            for (int y = 0; y < CHUNK_SIZE; y++) {
-                for (int x = 0; x < CHUNK_SIZE; x++) {
-                    block *bl = ch.second->blocks.get(x, y, z);
-                    for (int face = 0; face < 6; face++) {
-                        glm::ivec3 offset = dirs[face];
-                        glm::ivec3 other_coord = CHUNK_SIZE * ch.first + glm::ivec3(x, y, z) + offset;
-                        block *other = get_block(other_coord);
-
-                        if (bl->surfs[face]) {
-                            /* 1/ every surface must be consistent with its far side. this implies that the
-                             *    far side *block* must also exist, so that the surface can
-                             */
-                            if (!other) {
-                                printf("validate(): %d %d %d in nonexistent chunk, but far side of surface %d exists\n",
-                                        other_coord.x, other_coord.y, other_coord.z, face ^ 1);
-                                pass = false;
-                            }
-                            else if (other->surfs[face ^ 1] != bl->surfs[face]) {
-                                printf("validate(): inconsistent surface %d %d %d face %d\n",
-                                        other_coord.x, other_coord.y, other_coord.z, face ^ 1);
-                                pass = false;
-                            }
-
-                            /* 2/ every surface must be supported by scaffolding on at least one side */
-                            if (bl->type != block_support && (!other || other->type != block_support)) {
-                                printf("validate(): %d %d %d face %d has no supporting scaffold\n",
-                                        other_coord.x - offset.x, other_coord.y - offset.y,
-                                        other_coord.z - offset.z, face);
-                                pass = false;
-                            }
-                        }
+        for (chunk_cursor c(this, ch.first); c.valid(); c.next()) {
+            block const *bl = c.get_block();
+            for (int face = 0; face < 6; face++) {
+                glm::ivec3 offset = dirs[face];
+                glm::ivec3 other_coord = c.pos() + offset;
+                block const *other = c.neighbor_block(face);
+
+                /* 0/ the chunk's face bitplanes must agree with its blocks */
+                glm::ivec3 wb;
+                split_block_coord(c.pos(), &wb, nullptr);
+                uint32_t bi = chunk_block_index(wb);
+                if (ch.second->faces.air_open(bi, face) != !!air_permeable(bl->surfs[face]) ||
+                    ch.second->faces.light_open(bi, face) != !!light_permeable(bl->surfs[face])) {
+                    printf("validate(): %d %d %d face %d out of step with its chunk's bitplanes\n",
+                            c.pos().x, c.pos().y, c.pos().z, face);
+                    pass = false;
+                }
+
+                if (bl->surfs[face]) {
+                    /* 1/ every surface must be consistent with its far side. this implies that the
+                     *    far side *block* must also exist, so that the surface can
+                     */
+                    if (!other) {
+                        printf("validate(): %d %d %d in nonexistent chunk, but far side of surface %d exists\n",
+                                other_coord.x, other_coord.y, other_coord.z, face ^ 1);
+                        pass = false;
+                    }
+                    else if (other->surfs[face ^ 1] != bl->surfs[face]) {
+                        printf("validate(): inconsistent surface %d %d %d face %d\n",
+                                other_coord.x, other_coord.y, other_coord.z, face ^ 1);
+                        pass = false;
+                    }
+
+                    /* 2/ every surface must be supported by scaffolding on at least one side */
+                    if (bl->type != block_support && (!other || other->type != block_support)) {
+                        printf("validate(): %d %d %d face %d has no supporting scaffold\n",
+                                other_coord.x - offset.x, other_coord.y - offset.y,
+                                other_coord.z - offset.z, face);
+                        pass = false;
                     }
                 }
             }
@@ -728,16 +1055,17 @@ ship_space::validate()
 /* todo: we should be able to calculate surface index */
 void
 ship_space::set_surface(glm::ivec3 a, glm::ivec3 b, surface_index index, surface_type st) {
-    auto block = ensure_block(a);
-    auto other_block = ensure_block(b);
-
-    block->surfs[index] = st;
-    get_chunk_containing(a)->render_chunk.valid = false;
-    get_chunk_containing(a)->phys_chunk.valid = false;
-
-    other_block->surfs[index ^ 1] = st;
-    get_chunk_containing(b)->render_chunk.valid = false;
-    get_chunk_containing(b)->phys_chunk.valid = false;
+    glm::ivec3 ends[2] = { a, b };
+    for (int side = 0; side < 2; side++) {
+        glm::ivec3 bl;
+        ensure_block(ends[side]);
+        split_block_coord(ends[side], &bl, nullptr);
+
+        chunk *ch = get_chunk_containing(ends[side]);
+        ch->set_surface(bl.x, bl.y, bl.z, index ^ side, st);
+        ch->render_chunk.valid = false;
+        ch->phys_chunk.valid = false;
+    }
 
     if (st != surface_none) {
         update_topology_for_add_surface(a, b, index);
@@ -1,35 +1,74 @@
 #pragma once
 
 #include <glm/glm.hpp> /* ivec3 */
+#include <deque>
 #include <set>
 #include <unordered_map>
 
 #include "block.h"
 #include "component/component_manager.h"
 #include "chunk.h"
+#include "chunk_index.h"
 #include "wiring/wiring.h"
 #include "wiring/wiring_data.h"
 #include <unordered_set>
 
 struct ivec3_hash {
   size_t operator()(const glm::ivec3 &v) const {
-      std::hash<int> h;
-      size_t hh = h(v.x);
-      hh = hh>>6 ^ hh<<2 ^ h(v.y);
-      hh = hh>>6 ^ hh<<2 ^ h(v.z);
-      return hh;
+      return (size_t)hash_ivec3(v);
   }
 };
 
+static inline void
+split_coord(int p, int *out_block, int *out_chunk)
+{
+    /* NOTE: There are a number of attractive-looking symmetries which are
+     * just plain wrong. negative space is not a mirror of positive:
+     * chunk -1 spans blocks -8..-1;
+     * chunk -2 spans blocks -16..-9
+     *
+     * an arithmetic shift rounds toward -inf, which is exactly that, and the
+     * mask then gives the offset from the minimum block in the chunk in
+     * either halfspace. */
+    int chunk = p >> CHUNK_SHIFT;
+    int block = p & CHUNK_MASK;
+
+    /* write the outputs which were requested */
+    if (out_block)
+        *out_block = block;
+    if (out_chunk)
+        *out_chunk = chunk;
+}
+
+
+/* splits block coordinates p into within-chunk block coordinates and chunk coordinates */
+static inline void
+split_block_coord(glm::ivec3 p, glm::ivec3 *out_block, glm::ivec3 *out_chunk)
+{
+    glm::ivec3 bl, ch;
+
+    split_coord(p.x, &bl.x, &ch.x);
+    split_coord(p.y, &bl.y, &ch.y);
+    split_coord(p.z, &bl.z, &ch.z);
+
+    if (out_block)
+        *out_block = bl;
+    if (out_chunk)
+        *out_chunk = ch;
+}
+
+
 struct raycast_info {
     bool hit;
     bool inside;
     glm::ivec3 bl;          /* the block we hit */
     glm::ivec3 n;           /* the face normal we hit */
     glm::ivec3 p;           /* the block along the normal */
-    struct block *block;
+    struct block const *block;
 };
 
+struct ship_file;
+
 struct zone_info {
     float air_amount;
 
@@ -38,15 +77,19 @@ struct zone_info {
 
 struct ship_space {
     /* the min and max chunk co-ords ship_space has seen for each axis
-     * this is for iteration (min_x..max_x) (inclusive)
+     * (inclusive)
      *
      * ship_space is sparse so even within this range
-     * chunks may still be null
+     * chunks may still be null -- to visit every chunk, walk chunk_coords.
      */
     glm::ivec3 mins;
     glm::ivec3 maxs;
 
-    std::unordered_map<glm::ivec3, chunk*, ivec3_hash> chunks;
+    chunk_index chunks;
+
+    /* the coordinates of every chunk the ship has, whether resident or still
+     * waiting in the backing file, in no particular order */
+    std::vector<glm::ivec3> chunk_coords;
     std::unordered_map<topo_info *, zone_info *> zones;
 
     std::vector<wire_attachment> wire_attachments[num_wire_types];
@@ -67,8 +110,16 @@ struct ship_space {
      * finds the block at the position (x,y,z) within
      * the whole ship_space
      * will move across chunks
+     *
+     * the block is only good until its chunk is next written to
+     */
+    block const * get_block(glm::ivec3 block);
+
+    /* as get_block, for writing. expands the chunk's blocks out of their
+     * compressed form. anything which changes surfaces this way must
+     * call chunk::refresh_faces() when it is done; see set_surface()
      */
-    block * get_block(glm::ivec3 block);
+    block * edit_block(glm::ivec3 block);
 
     topo_info * get_topo_info(glm::ivec3 block);
 
@@ -82,6 +133,11 @@ struct ship_space {
      */
     chunk * get_chunk(glm::ivec3 chunk);
 
+    /* whether there is a chunk at chunk coordinates (x, y, z), resident or
+     * not. unlike get_chunk, this never pages anything in.
+     */
+    bool has_chunk(glm::ivec3 chunk) const;
+
     /* returns a pointer to a new ship space
      * this ship space will have 2 x 2 rooms and will be 1 room tall
      * each room will have a floor and 4 walls of scaffolding
@@ -93,32 +149,83 @@ struct ship_space {
      */
     static ship_space * mock_ship_space(void);
 
+    /* writes this ship to filename in the format described in ship_file.h
+     * entities are written by calling describe for each one in a chunk, if
+     * provided. it fills in what spawn will be given to recreate the entity,
+     * or returns false to leave it out.
+     *
+     * returns false on error
+     */
+    bool save(char const *filename,
+              bool (*describe)(c_entity ce, glm::ivec3 *p, unsigned *type, int *face));
+
+    /* returns a pointer to a new ship space backed by filename
+     * the file is mapped rather than read; chunks are paged in
+     * by get_chunk the first time they are asked for.
+     * entities are recreated by calling spawn for each one, if provided;
+     * a file with an entity type of num_types or more is unusable.
+     *
+     * returns 0 if the file is missing or unusable
+     */
+    static ship_space * load(char const *filename,
+                             c_entity (*spawn)(glm::ivec3 p, unsigned type, int face),
+                             unsigned num_types);
+
+    /* backing file for chunks which have not been paged in yet, or null */
+    ship_file *file;
+
+    /* copies the chunk at chunk coordinates (x, y, z) in from the backing file
+     * returns null if the file has no such chunk
+     */
+    chunk * page_in_chunk(glm::ivec3 chunk);
+
+    /* pages in every chunk remaining in the backing file */
+    void page_in_all_chunks();
+
     void raycast(glm::vec3 o, glm::vec3 d, raycast_info *rc);
 
     /* ensure that the specified block_{x,y,z} can be fetched with a get_block
      *
-     * this will instantiate a new containing chunk if necessary
+     * this will instantiate a new containing chunk if necessary, and
+     * returns the block as edit_block does
      */
     block * ensure_block(glm::ivec3 block);
 
     /* ensure that the specified chunk exists
      *
-     * this will instantiate a new chunk if necessary
+     * this will instantiate a new chunk if necessary, along with any missing
+     * chunks which the new one closes off from the space around the ship
      */
     chunk * ensure_chunk(glm::ivec3 chunk);
 
     zone_info *get_zone_info(topo_info *t);
     void insert_zone(topo_info *t, zone_info *z);
+    void split_zone(topo_info *t1, topo_info *t2, float air_amount);
 
     /* topo info for open vacuum, so we know what pressure to force to zero */
     topo_info outside_topo_info;
+
+    /* union-find roots for every enclosed zone. these belong to no block, so
+     * every block's topo_info links straight to one of these (or to the outside,
+     * or to a ship_file zone root). that lets a split relabel one side without
+     * disturbing the parent links of the other. released by a full rebuild.
+     */
+    std::deque<topo_info> topo_roots;
+    topo_info * new_topo_root();
+
     void rebuild_topology();
     void update_topology_for_remove_surface(glm::ivec3 a, glm::ivec3 b);
     void update_topology_for_add_surface(glm::ivec3 a, glm::ivec3 b, int face);
 
+    /* tries to settle a possible split between a and b with a flood fill out from
+     * both sides. returns false if the fill got too big, and a full rebuild is needed.
+     */
+    bool split_topology_locally(glm::ivec3 a, glm::ivec3 b);
+
     int num_full_rebuilds;      /* number of full rebuilds (pretty slow) performed */
     int num_fast_unifys;        /* number of incremental unify operations performed */
     int num_fast_nosplits;      /* number of rebuilds avoided because we proved them spurious */
+    int num_fast_splits;        /* number of splits resolved by a local flood fill */
     int num_false_splits;       /* number of useless rebuilds taken */
 
     bool validate();
@@ -0,0 +1,510 @@
+#ifndef _WIN32
+#include <err.h> /* errx */
+#else
+#include "winerr.h"
+#endif
+
+#include <stdio.h>
+#include <vector>
+
+#include "simulation.h"
+#include "common.h"
+#include "particle.h"
+#include "physics.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include "worker_pool.h"
+#include "component/component_system_manager.h"
+#include "wiring/wiring.h"
+
+
+#define INITIAL_MAX_COMPONENTS 20
+
+ship_space *ship;
+player pl;
+physics *phy;
+worker_pool *workers;
+projectile_linear_manager proj_man;
+particle_manager *particle_man;
+
+sw_mesh *scaffold_sw;
+sw_mesh *surfs_sw[6];
+hw_mesh *door_hw;
+
+time_accumulator main_tick_accum(1/15.0f, 1.f);
+time_accumulator fast_tick_accum(1/60.0f, 1.f);
+
+/* what the entity ticks share, for the scheduler to order them by */
+enum {
+    res_readers     = 1 << 0,   /* reader data */
+    res_gas         = 1 << 1,
+    res_powered     = 1 << 2,   /* power.powered */
+    res_demand      = 1 << 3,   /* power.required_power */
+    res_lights      = 1 << 4,
+    res_comparators = 1 << 5,
+    res_proximity   = 1 << 6,
+    res_doors       = 1 << 7,
+    res_positions   = 1 << 8,   /* position and surface attachment */
+    res_wires       = 1 << 9,   /* wires, attachments and their read buffers */
+    res_comms_out   = 1 << 10,  /* comms write buffers, and the comms wire map,
+                                 * which publishing adds to */
+    res_zones       = 1 << 11,  /* blocks, topology and zones */
+    res_lightfield  = 1 << 12,  /* lightfield updates */
+    res_particles   = 1 << 13,  /* and the random sequence */
+    res_player      = 1 << 14,
+};
+
+/* readers and power consumers are split up this many at a time */
+#define TICK_GRAIN 64
+
+static system_scheduler tick_scheduler;
+
+
+glm::mat4
+mat_block_face(glm::ivec3 p, int face)
+{
+    auto norm = glm::vec3(surface_index_to_normal(face));
+    auto pos = glm::vec3(p) + glm::vec3(0.5f) + 0.5f * norm;
+    return mat_rotate_mesh(pos, -norm);
+}
+
+
+entity_type entity_types[] = {
+    { "Door", "mesh/single_door_frame.dae", 2, false, 2 },
+    { "Frobnicator", "mesh/frobnicator.dae", 3, false, 1 },
+    { "Light", "mesh/panel_4x4.dae", 8, true, 1 },
+    { "Warning Light", "mesh/warning_light.dae", 8, true, 1 },
+    { "Display Panel", "mesh/panel_4x4.dae", 7, true, 1 },
+    { "Switch", "mesh/panel_1x1.dae", 9, true, 1 },
+    { "Plaidnicator", "mesh/frobnicator.dae", 13, false, 1 },
+    { "Pressure Sensor 1", "mesh/panel_1x1.dae", 12, true, 1 },
+    { "Pressure Sensor 2", "mesh/panel_1x1.dae", 14, true, 1 },
+    { "Sensor Comparator", "mesh/panel_1x1.dae", 13, true, 1 },
+    { "Proximity Sensor", "mesh/panel_1x1.dae", 3, true, 1 },
+    { "Flashlight", "mesh/no_place.dae", 3, true, 1 },
+};
+
+unsigned const num_entity_types = sizeof(entity_types) / sizeof(entity_types[0]);
+
+
+c_entity spawn_entity(glm::ivec3 p, unsigned type, int face) {
+    auto ce = c_entity::spawn();
+
+    auto mat = mat_block_face(p, face);
+
+    auto et = &entity_types[type];
+
+    type_man.assign_entity(ce);
+    auto type_comp = type_man.get_instance_data(ce);
+    *type_comp.type = type;
+
+    physics_man.assign_entity(ce);
+    auto physics = physics_man.get_instance_data(ce);
+    *physics.rigid = nullptr;
+    build_static_physics_rb_mat(&mat, et->phys_shape, physics.rigid);
+
+    /* so that we can get back to the entity from a phys raycast */
+    /* TODO: these should really come from a dense pool rather than the generic allocator */
+    auto per = new phys_ent_ref;
+    per->ce = ce;
+    (*physics.rigid)->setUserPointer(per);
+
+    surface_man.assign_entity(ce);
+    auto surface = surface_man.get_instance_data(ce);
+    *surface.block = p;
+    *surface.face = face;
+
+    pos_man.assign_entity(ce);
+    auto pos = pos_man.get_instance_data(ce);
+    *pos.position = p;
+    *pos.mat = mat;
+
+    /* hack to not render a mesh for the flashlight */
+    /* todo: handle entities that don't need to be rendered*/
+    if (type != 11) {
+        render_man.assign_entity(ce);
+        auto render = render_man.get_instance_data(ce);
+        *render.mesh = et->hw;
+    }
+
+    // door
+    if (type == 0) {
+        power_man.assign_entity(ce);
+        auto power = power_man.get_instance_data(ce);
+        *power.powered = false;
+        *power.required_power = 8;
+        *power.max_required_power = 8;
+
+        door_man.assign_entity(ce);
+        auto door = door_man.get_instance_data(ce);
+        *door.mesh = door_hw;
+        *door.pos = 1.0f;
+        *door.desired_pos = 1.0f;
+        *door.height = et->height;
+
+        reader_man.assign_entity(ce);
+        auto reader = reader_man.get_instance_data(ce);
+        *reader.name = "desired state";
+        reader.source->id = 0;
+        *reader.desc = nullptr;
+        *reader.data = 1.0f;
+    }
+    // frobnicator
+    else if (type == 1) {
+        power_man.assign_entity(ce);
+        auto power = power_man.get_instance_data(ce);
+        *power.powered = false;
+        *power.required_power = 12;
+        *power.max_required_power = 12;
+
+        gas_man.assign_entity(ce);
+        auto gas = gas_man.get_instance_data(ce);
+        *gas.flow_rate = 0.1f;
+        *gas.max_pressure = 1.0f;
+        *gas.enabled = true;
+    }
+    // light
+    else if (type == 2) {
+        power_man.assign_entity(ce);
+        auto power = power_man.get_instance_data(ce);
+        *power.powered = false;
+        *power.required_power = 6;
+        *power.max_required_power = 6;
+
+        light_man.assign_entity(ce);
+        auto light = light_man.get_instance_data(ce);
+        *light.intensity = 1.0f;
+        *light.requested_intensity = 1.0f;
+
+        reader_man.assign_entity(ce);
+        auto reader = reader_man.get_instance_data(ce);
+        *reader.name = "light brightness";
+        reader.source->id = 0;
+        *reader.desc = nullptr;
+        *reader.data = 1.0f;
+    }
+    // warning light
+    else if (type == 3) {
+        power_man.assign_entity(ce);
+        auto power = power_man.get_instance_data(ce);
+        *power.powered = false;
+        *power.required_power = 6;
+        *power.max_required_power = 6;
+
+        light_man.assign_entity(ce);
+        auto light = light_man.get_instance_data(ce);
+        *light.intensity = 1.0f;
+        *light.requested_intensity = 1.0f;
+
+        reader_man.assign_entity(ce);
+        auto reader = reader_man.get_instance_data(ce);
+        *reader.name = "light brightness";
+        reader.source->id = 0;
+        *reader.desc = comms_msg_type_sensor_comparison_state;      // temp until we have discriminator tool
+        *reader.data = 1.0f;
+    }
+    // display panel
+    else if (type == 4) {
+        power_man.assign_entity(ce);
+        auto power = power_man.get_instance_data(ce);
+        *power.powered = false;
+        *power.required_power = 4;
+        *power.max_required_power = 4;
+
+        light_man.assign_entity(ce);
+        auto light = light_man.get_instance_data(ce);
+        *light.intensity = 0.15f;
+        *light.requested_intensity = 0.15f;
+
+        reader_man.assign_entity(ce);
+        auto reader = reader_man.get_instance_data(ce);
+        *reader.name = "light brightness";
+        reader.source->id = 0;
+        *reader.desc = nullptr;
+        *reader.data = 0.15f;
+    }
+    // switch
+    else if (type == 5) {
+        switch_man.assign_entity(ce);
+        auto sw = switch_man.get_instance_data(ce);
+        *sw.enabled = true;
+    }
+    // plaidnicator
+    else if (type == 6) {
+        power_provider_man.assign_entity(ce);
+        auto power_provider = power_provider_man.get_instance_data(ce);
+        *power_provider.max_provided = 12;
+        *power_provider.provided = 12;
+    }
+    // pressure sensor 1
+    else if (type == 7) {
+        pressure_man.assign_entity(ce);
+        auto pressure = pressure_man.get_instance_data(ce);
+        *pressure.pressure = 0.0f;
+        *pressure.type = 1;
+    }
+    // pressure sensor 2
+    else if (type == 8) {
+        pressure_man.assign_entity(ce);
+        auto pressure = pressure_man.get_instance_data(ce);
+        *pressure.pressure = 0.0f;
+        *pressure.type = 2;
+    }
+    // sensor comparator
+    else if (type == 9) {
+        comparator_man.assign_entity(ce);
+        auto comparator = comparator_man.get_instance_data(ce);
+        *comparator.compare_epsilon = 0.0001f;
+    }
+    // proximity sensor
+    else if (type == 10) {
+        power_man.assign_entity(ce);
+        auto power = power_man.get_instance_data(ce);
+        *power.powered = false;
+        *power.required_power = 1;
+        *power.max_required_power = 1;
+
+        proximity_man.assign_entity(ce);
+        auto proximity_sensor = proximity_man.get_instance_data(ce);
+        *proximity_sensor.range = 5;
+        *proximity_sensor.is_detected = false;
+    }
+    // flashlight
+    else if (type == 11) {
+        power_man.assign_entity(ce);
+        auto power = power_man.get_instance_data(ce);
+        *power.powered = false; /* Flashlight starts off */
+        *power.required_power = 0;
+        *power.max_required_power = 0;
+
+        light_man.assign_entity(ce);
+        auto light = light_man.get_instance_data(ce);
+        *light.intensity = 0.75f;
+        *light.requested_intensity = 0.75f;
+
+        reader_man.assign_entity(ce);
+        auto reader = reader_man.get_instance_data(ce);
+        *reader.name = "flashlight brightness";
+        reader.source->id = 0;
+        *reader.desc = nullptr;
+        *reader.data = 0.75f;
+    }
+
+    return ce;
+}
+
+
+bool
+describe_entity(c_entity ce, glm::ivec3 *p, unsigned *type, int *face)
+{
+    if (!type_man.exists(ce) || !surface_man.exists(ce))
+        return false;
+
+    auto surface = surface_man.get_instance_data(ce);
+    *p = *surface.block;
+    *type = *type_man.get_instance_data(ce).type;
+    *face = *surface.face;
+    return true;
+}
+
+
+light_propagator *light_prop;
+std::vector<glm::ivec3> lightfield_updates;
+
+
+void
+mark_lightfield_update(glm::ivec3 p)
+{
+    lightfield_updates.push_back(p);
+}
+
+
+/* past this many changed blocks in one go, relighting the whole ship is
+ * cheaper than relighting around each of them */
+#define LIGHT_REBUILD_UPDATES   1024
+
+bool lightfield_rebuild = true;
+
+
+void
+add_light_sources()
+{
+    for (auto i = 0u; i < light_man.buffer.num; i++) {
+        auto ce = light_man.instance_pool.entity[i];
+        auto pos = get_coord_containing(*pos_man.get_instance_data(ce).position);
+        auto powered = *power_man.get_instance_data(ce).powered;
+        if (powered) {
+            light_prop->add_source(pos, (int)(255 * light_man.instance_pool.intensity[i]));
+        }
+    }
+}
+
+
+void
+update_lightfield()
+{
+    if (lightfield_rebuild || lightfield_updates.size() > LIGHT_REBUILD_UPDATES) {
+        /* start again from the sources alone */
+        lightfield_updates.clear();
+        lightfield_rebuild = false;
+
+        add_light_sources();
+        light_prop->rebuild();
+    }
+    else if (!lightfield_updates.empty()) {
+        /* 1. take out any light which may have passed through the changed blocks */
+        for (auto p : lightfield_updates) {
+            light_prop->invalidate(p);
+        }
+
+        lightfield_updates.clear();
+
+        /* 2. put the sources back. any the invalidation didn't reach are
+         * already lit, and cost nothing */
+        add_light_sources();
+
+        /* 3. spread light back into everything which was darkened */
+        light_prop->propagate();
+    }
+}
+
+
+void
+sim_init(unsigned num_threads)
+{
+    workers = new worker_pool(num_threads);
+
+    /* in the order they ran in when they ran one after another; the
+     * scheduler keeps it wherever two of them touch the same thing. a tick
+     * which looks in comms_wires also reads res_comms_out, so that publishing
+     * can't add to the map under it */
+    tick_scheduler.add("tick_readers", res_wires | res_comms_out, res_readers,
+                       []() { return reader_man.buffer.num; }, TICK_GRAIN,
+                       [](unsigned begin, unsigned end) { tick_readers(ship, begin, end); });
+    tick_scheduler.add("tick_gas_producers",
+                       res_powered | res_positions | res_wires | res_comms_out,
+                       res_gas | res_demand | res_zones | res_particles,
+                       []() { tick_gas_producers(ship); });
+    tick_scheduler.add("tick_power_consumers", res_demand | res_wires, res_powered,
+                       []() { return power_man.buffer.num; }, TICK_GRAIN,
+                       [](unsigned begin, unsigned end) { tick_power_consumers(ship, begin, end); });
+    tick_scheduler.add("tick_light_components",
+                       res_readers | res_powered | res_positions,
+                       res_lights | res_demand | res_lightfield,
+                       []() { tick_light_components(ship); });
+    /* topo_find tidies the zone tree as it goes, so even a look is a write */
+    tick_scheduler.add("tick_pressure_sensors", res_positions | res_wires,
+                       res_zones | res_comms_out,
+                       []() { tick_pressure_sensors(ship); });
+    tick_scheduler.add("tick_sensor_comparators", res_wires,
+                       res_comparators | res_comms_out,
+                       []() { tick_sensor_comparators(ship); });
+    tick_scheduler.add("tick_proximity_sensors",
+                       res_powered | res_positions | res_wires | res_player,
+                       res_proximity | res_comms_out,
+                       []() { tick_proximity_sensors(ship, &pl); });
+    tick_scheduler.add("tick_doors",
+                       res_readers | res_powered | res_positions,
+                       res_doors | res_demand | res_zones | res_lightfield,
+                       []() { tick_doors(ship); });
+
+    gas_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
+    light_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
+    physics_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
+    pos_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
+    power_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
+    power_provider_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
+    render_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
+    surface_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
+    switch_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
+    type_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
+    door_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
+    reader_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
+    proximity_man.create_component_instance_data(INITIAL_MAX_COMPONENTS);
+
+    proj_man.create_projectile_data(1000);
+
+    particle_man = new particle_manager();
+    particle_man->create_particle_data(1000);
+
+    mesher_init();
+
+    scaffold_sw = load_mesh("mesh/initial_scaffold.dae");
+
+    surfs_sw[surface_xp] = load_mesh("mesh/x_quad_p.dae");
+    surfs_sw[surface_xm] = load_mesh("mesh/x_quad.dae");
+    surfs_sw[surface_yp] = load_mesh("mesh/y_quad_p.dae");
+    surfs_sw[surface_ym] = load_mesh("mesh/y_quad.dae");
+    surfs_sw[surface_zp] = load_mesh("mesh/z_quad_p.dae");
+    surfs_sw[surface_zm] = load_mesh("mesh/z_quad.dae");
+
+    for (auto i = 0u; i < num_entity_types; i++) {
+        auto t = &entity_types[i];
+        t->sw = load_mesh(t->mesh);
+        set_mesh_material(t->sw, t->material);
+        build_static_physics_mesh(t->sw, &t->phys_mesh, &t->phys_shape);
+    }
+
+    pl.angle = 0;
+    pl.elev = 0;
+    pl.pos = glm::vec3(3,2,2);
+    pl.selected_slot = 1;
+    pl.ui_dirty = true;
+    pl.disable_gravity = false;
+
+    /* needed before the ship, so that loaded entities can be placed */
+    phy = new physics(&pl);
+}
+
+
+void
+sim_load_ship(char const *filename)
+{
+    ship = ship_space::load(filename, spawn_entity, num_entity_types);
+    if (!ship) {
+        ship = ship_space::mock_ship_space();
+        if( ! ship )
+            errx(1, "Ship_space::mock_ship_space failed\n");
+
+        ship->rebuild_topology();
+        ship->validate();
+    }
+}
+
+
+void
+sim_main_tick()
+{
+    PROFILE_SCOPE("main tick");
+
+    /* remove any air that someone managed to get into the outside */
+    {
+        topo_info *t = topo_find(&ship->outside_topo_info);
+        zone_info *z = ship->get_zone_info(t);
+        if (z) {
+            /* try as hard as you like, you cannot fill space with your air system */
+            z->air_amount = 0;
+        }
+    }
+
+    /* allow the entities to tick. the scheduler profiles each one itself */
+    { PROFILE_SCOPE("entity ticks");            tick_scheduler.run(workers); }
+
+    /* rebuild lighting if needed */
+    { PROFILE_SCOPE("update_lightfield");       update_lightfield(); }
+
+    { PROFILE_SCOPE("power wires");             calculate_power_wires(ship); }
+    { PROFILE_SCOPE("comms wires");             propagate_comms_wires(ship); }
+}
+
+
+void
+sim_fast_tick()
+{
+    PROFILE_SCOPE("fast tick");
+
+    { PROFILE_SCOPE("projectiles");             proj_man.simulate(fast_tick_accum.period); }
+    { PROFILE_SCOPE("particles");               particle_man->simulate(fast_tick_accum.period); }
+
+    { PROFILE_SCOPE("physics");                 phy->tick(fast_tick_accum.period); }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "light_prop.h"
+#include "mesh.h"
+#include "player.h"
+#include "ship_space.h"
+#include "component/c_entity.h"
+#include "projectile/projectile.h"
+
+/* the game world, and everything which ticks it -- all of the game but the
+ * window, the renderer and the input. it needs no GL context, so the same
+ * world runs under main.cc, or alone in headless.cc.
+ */
+
+/* fwd */
+class btTriangleMesh;
+class btCollisionShape;
+struct particle_manager;
+struct physics;
+struct worker_pool;
+
+
+struct entity_type
+{
+    /* static */
+    char const *name;
+    char const *mesh;
+    int material;
+    bool placed_on_surface;
+    int height;
+
+    /* loader loop does these */
+    sw_mesh *sw;
+    hw_mesh *hw;                /* left null without a renderer */
+    btTriangleMesh *phys_mesh;
+    btCollisionShape *phys_shape;
+};
+
+extern entity_type entity_types[];
+extern unsigned const num_entity_types;
+
+
+extern ship_space *ship;
+extern player pl;
+extern physics *phy;
+extern worker_pool *workers;
+extern projectile_linear_manager proj_man;
+extern particle_manager *particle_man;
+
+/* the mesher builds chunks out of these */
+extern sw_mesh *scaffold_sw;
+extern sw_mesh *surfs_sw[6];
+
+/* doors are drawn with this; null without a renderer */
+extern hw_mesh *door_hw;
+
+/* lights the ship. whoever owns the light_grid sets this up, once there
+ * is a ship */
+extern light_propagator *light_prop;
+
+/* the whole ship needs lighting, as when it has just been loaded */
+extern bool lightfield_rebuild;
+
+
+struct time_accumulator
+{
+    float period;
+    float max_period;
+    float accum;
+
+    time_accumulator(float period, float max_period) :
+        period(period), max_period(max_period), accum(0.0f) {}
+
+    void add(float dt) {
+        accum = std::min(accum + dt, max_period);
+    }
+
+    bool tick()
+    {
+        if (accum >= period) {
+            accum -= period;
+            return true;
+        }
+
+        return false;
+    }
+};
+
+extern time_accumulator main_tick_accum;    /* 15Hz tick for game logic */
+extern time_accumulator fast_tick_accum;    /* 60Hz tick for motion */
+
+
+glm::mat4
+mat_block_face(glm::ivec3 p, int face);
+
+c_entity
+spawn_entity(glm::ivec3 p, unsigned type, int face);
+
+/* what spawn_entity needs to recreate ce, for ship_space::save. false for
+ * entities which aren't placed on a surface */
+bool
+describe_entity(c_entity ce, glm::ivec3 *p, unsigned *type, int *face);
+
+/* sets up everything but the ship: the component managers, the meshes the
+ * world is built from, and physics. num_threads is for the worker_pool. */
+void
+sim_init(unsigned num_threads);
+
+/* loads the ship from filename, or makes up the mock ship if there is none.
+ * any renderer must have filled in the entity types' hw meshes by now. */
+void
+sim_load_ship(char const *filename);
+
+/* relights whatever has changed since the last time, on the CPU */
+void
+update_lightfield();
+
+/* one tick of game logic: the entities, the lighting and the wiring */
+void
+sim_main_tick();
+
+/* one tick of motion: projectiles, particles and the physics world */
+void
+sim_fast_tick();
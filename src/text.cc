@@ -4,6 +4,7 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include <stdlib.h>
+#include <string.h>
 
 #ifndef _WIN32
 #include <err.h> /* errx */
@@ -15,6 +16,10 @@
 #define TEXT_ATLAS_WIDTH    512
 #define TEXT_ATLAS_HEIGHT   512
 
+/* texels along each side of the solid patch; bigger than one, so filtering
+ * never reaches past its edge */
+#define SOLID_SIZE          4
+
 
 text_renderer::text_renderer(char const *font, int size)
     : bo(0), bo_vertex_count(0), bo_capacity(0), vao(0), verts()
@@ -50,6 +55,13 @@ text_renderer::text_renderer(char const *font, int size)
         m->yoffset = (float) ft_face->glyph->bitmap_top;
     }
 
+    unsigned char solid[SOLID_SIZE * SOLID_SIZE];
+    memset(solid, 0xff, sizeof(solid));
+    int sx, sy;
+    atlas->add_bitmap(solid, SOLID_SIZE, SOLID_SIZE, SOLID_SIZE, &sx, &sy);
+    solid_u = (sx + SOLID_SIZE / 2) / (float)TEXT_ATLAS_WIDTH;
+    solid_v = (sy + SOLID_SIZE / 2) / (float)TEXT_ATLAS_HEIGHT;
+
     atlas->upload();
 
     glGenVertexArrays(1, &vao);
@@ -111,6 +123,24 @@ text_renderer::add(char const *str, float x, float y, float r, float g, float b)
 }
 
 
+void
+text_renderer::add_rect(float x, float y, float w, float h, float r, float g, float b)
+{
+    text_vertex p0 = { x, y, solid_u, solid_v, r, g, b };
+    text_vertex p1 = { x + w, y, solid_u, solid_v, r, g, b };
+    text_vertex p2 = { x + w, y - h, solid_u, solid_v, r, g, b };
+    text_vertex p3 = { x, y - h, solid_u, solid_v, r, g, b };
+
+    verts.push_back(p0);
+    verts.push_back(p2);
+    verts.push_back(p1);
+
+    verts.push_back(p0);
+    verts.push_back(p3);
+    verts.push_back(p2);
+}
+
+
 void
 text_renderer::measure(char const *str, float *x, float *y)
 {
@@ -53,6 +53,9 @@ struct text_renderer
 
     metrics ms[256];
 
+    /* a solid patch in the atlas, for add_rect */
+    float solid_u, solid_v;
+
     GLuint bo;
     GLuint bo_vertex_count;
     GLuint bo_capacity;
@@ -63,6 +66,8 @@ struct text_renderer
     texture_atlas *atlas;
 
     void add(char const *str, float x, float y, float r, float g, float b);
+    /* a solid box, down and right from x,y */
+    void add_rect(float x, float y, float w, float h, float r, float g, float b);
     void measure(char const *str, float *x, float *y);
     void upload();
     void reset();
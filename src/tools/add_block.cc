@@ -25,13 +25,14 @@ struct add_block_tool : tool
         if (!can_use(rc))
             return; /* n/a */
 
-        /* ensure we can access this x,y,z */
-        ship->ensure_block(rc->p);
+        /* rc->block may not outlive the edit below */
+        auto hit_type = rc->block->type;
 
-        block *bl = ship->get_block(rc->p);
+        /* ensure we can access this x,y,z */
+        block *bl = ship->ensure_block(rc->p);
 
         /* can only build on the side of an existing scaffold */
-        if (bl && rc->block->type == block_support) {
+        if (bl && hit_type == block_support) {
             bl->type = block_support;
             /* dirty the chunk */
             ship->get_chunk_containing(rc->p)->render_chunk.valid = false;
@@ -51,7 +52,7 @@ struct add_block_tool : tool
         if (!can_use(rc))
             return; /* n/a */
 
-        block *bl = ship->get_block(rc->p);
+        block const *bl = ship->get_block(rc->p);
 
         /* can only build on the side of an existing scaffold */
         if ((!bl || bl->type == block_empty) && rc->block->type == block_support) {
@@ -19,7 +19,7 @@ extern void
 remove_ents_from_surface(glm::ivec3 p, int face);
 
 bool
-add_surface_tool::can_use(block *bl, block *other, int index) {
+add_surface_tool::can_use(block const *bl, block const *other, int index) {
     if (bl && bl->surfs[index] != surface_none) return false; /* already a surface here */
     return (bl && bl->type == block_support) || (other && other->type == block_support);
 }
@@ -29,10 +29,10 @@ add_surface_tool::use(raycast_info *rc) {
     if (!rc->hit)
         return;
 
-    block *bl = rc->block;
+    block const *bl = rc->block;
 
     int index = normal_to_surface_index(rc);
-    block *other_side = ship->get_block(rc->p);
+    block const *other_side = ship->get_block(rc->p);
 
     if (can_use(bl, other_side, index)) {
         ship->set_surface(rc->bl, rc->p, (surface_index)index, st);
@@ -75,9 +75,9 @@ add_surface_tool::preview(raycast_info *rc, frame_data *frame) {
     if (!rc->hit)
         return;
 
-    block *bl = ship->get_block(rc->bl);
+    block const *bl = ship->get_block(rc->bl);
     int index = normal_to_surface_index(rc);
-    block *other_side = ship->get_block(rc->p);
+    block const *other_side = ship->get_block(rc->p);
 
     if (can_use(bl, other_side, index)) {
         auto mat = frame->alloc_aligned<glm::mat4>(1);
@@ -29,7 +29,7 @@ struct remove_block_tool : tool
         if (!can_use(rc))
             return;
 
-        block *bl = rc->block;
+        block const *bl = rc->block;
 
         /* if there was a block entity here, find and remove it. block
          * ents are "attached" to the zm surface */
@@ -43,16 +43,17 @@ struct remove_block_tool : tool
         }
 
         /* block removal */
-        bl->type = block_empty;
+        ship->edit_block(rc->bl)->type = block_empty;
 
-        /* strip any orphaned surfaces */
+        /* strip any orphaned surfaces. set_surface and removing ents both
+         * write, so look the block up afresh each time */
         for (int index = 0; index < 6; index++) {
-            if (bl->surfs[index] & surface_phys) {
+            if (ship->get_block(rc->bl)->surfs[index] & surface_phys) {
 
                 auto s = surface_index_to_normal(index);
 
                 auto r = rc->bl + s;
-                block *other_side = ship->get_block(r);
+                block const *other_side = ship->get_block(r);
 
                 if (!other_side) {
                     /* expand: but this should always exist. */
@@ -60,18 +61,13 @@ struct remove_block_tool : tool
                 else if (other_side->type != block_support) {
                     /* if the other side has no scaffold, then there is nothing left to support this
                      * surface pair -- remove it */
-                    bl->surfs[index] = surface_none;
-                    other_side->surfs[index ^ 1] = surface_none;
-                    ship->get_chunk_containing(r)->render_chunk.valid = false;
-                    ship->get_chunk_containing(r)->phys_chunk.valid = false;
+                    ship->set_surface(rc->bl, r, (surface_index)index, surface_none);
 
                     /* pop any dependent ents */
                     remove_ents_from_surface(rc->bl, index);
                     remove_ents_from_surface(r, index ^ 1);
 
                     mark_lightfield_update(r);
-
-                    ship->update_topology_for_remove_surface(rc->bl, r);
                 }
             }
         }
@@ -93,7 +89,7 @@ struct remove_block_tool : tool
         if (!can_use(rc))
             return;
 
-        block *bl = rc->block;
+        block const *bl = rc->block;
         if (bl->type != block_empty) {
             auto mat = frame->alloc_aligned<glm::mat4>(1);
             *mat.ptr = mat_position(rc->bl);
@@ -26,7 +26,7 @@ struct remove_surface_tool : tool
         if (!rc->hit)
             return false;
 
-        block *bl = rc->block;
+        block const *bl = rc->block;
         int index = normal_to_surface_index(rc);
         return bl && bl->surfs[index] & surface_phys;
     }
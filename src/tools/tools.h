@@ -33,7 +33,7 @@ struct add_surface_tool : tool
     surface_type st;
     add_surface_tool() : st(surface_wall) {}
 
-    bool can_use(block *bl, block *other, int index);
+    bool can_use(block const *bl, block const *other, int index);
 
     void use(raycast_info *rc) override;
 
@@ -0,0 +1,195 @@
+#include <algorithm>
+
+#include "ship_space.h"
+#include "visibility.h"
+
+
+frustum::frustum(glm::mat4 const & m)
+{
+    /* Gribb & Hartmann: each plane is the sum or difference of the last
+     * row of the matrix and one of the others */
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        glm::vec4 & pos = planes[i * 2];
+        glm::vec4 & neg = planes[i * 2 + 1];
+        for (int j = 0; j < 4; j++) {
+            pos[j] = rows[3][j] + rows[i][j];
+            neg[j] = rows[3][j] - rows[i][j];
+        }
+    }
+}
+
+
+bool
+frustum::intersects_box(glm::vec3 mins, glm::vec3 maxs) const
+{
+    for (auto const & p : planes) {
+        /* the corner furthest along the plane's normal */
+        glm::vec3 far(p.x > 0 ? maxs.x : mins.x,
+                      p.y > 0 ? maxs.y : mins.y,
+                      p.z > 0 ? maxs.z : mins.z);
+
+        if (glm::dot(glm::vec3(p), far) + p.w < 0)
+            return false;
+    }
+
+    return true;
+}
+
+
+bool
+frustum::intersects_sphere(glm::vec3 center, float radius) const
+{
+    for (auto const & p : planes) {
+        /* planes are not normalized, so scale the radius instead */
+        glm::vec3 n(p);
+        if (glm::dot(n, center) + p.w < -radius * glm::length(n))
+            return false;
+    }
+
+    return true;
+}
+
+
+static bool
+opaque(surface_type s)
+{
+    return s == surface_wall || s == surface_door;
+}
+
+
+uint8_t
+chunk_opaque_faces(chunk_blocks const *blocks)
+{
+    uint8_t mask = 0;
+
+    for (int face = 0; face < face_count; face++) {
+        int axis = face / 2;
+        int slice = (face & 1) ? 0 : CHUNK_SIZE - 1;
+        bool sealed = true;
+
+        for (int u = 0; u < CHUNK_SIZE && sealed; u++) {
+            for (int v = 0; v < CHUNK_SIZE && sealed; v++) {
+                glm::ivec3 p;
+                p[axis] = slice;
+                p[(axis + 1) % 3] = u;
+                p[(axis + 2) % 3] = v;
+
+                sealed = opaque(blocks->contents[p.x][p.y][p.z].surfs[face]);
+            }
+        }
+
+        if (sealed)
+            mask |= 1 << face;
+    }
+
+    return mask;
+}
+
+
+static bool
+chunk_in_frustum(frustum const & f, glm::ivec3 c)
+{
+    glm::vec3 mins = glm::vec3(c * CHUNK_SIZE);
+    return f.intersects_box(mins, mins + glm::vec3(CHUNK_SIZE));
+}
+
+
+void
+chunk_visibility::compute(ship_space *ship, frustum const & f, glm::vec3 eye)
+{
+    mins = ship->mins;
+    maxs = ship->maxs;
+    glm::ivec3 d = maxs - mins + glm::ivec3(1);
+    visible.assign((size_t)d.x * d.y * d.z, 0);
+    num_visible = 0;
+    num_tested = 0;
+
+    glm::ivec3 start = glm::ivec3(glm::floor(eye / (float)CHUNK_SIZE));
+
+    if (start.x < mins.x || start.y < mins.y || start.z < mins.z ||
+        start.x > maxs.x || start.y > maxs.y || start.z > maxs.z) {
+        /* looking at the ship from outside: no walls between us and its
+         * outer hull, so only the frustum can rule anything out */
+        for (auto const & e : ship->chunks) {
+            num_tested++;
+            if (chunk_in_frustum(f, e.first)) {
+                visible[index(e.first)] = 1;
+                num_visible++;
+            }
+        }
+        return;
+    }
+
+    /* breadth-first from the camera. dirs records which directions the walk
+     * to each chunk has moved in; a chunk is only entered once, by the first
+     * walk to reach it */
+    struct step {
+        glm::ivec3 c;
+        uint8_t dirs;
+    };
+
+    std::vector<step> queue;
+    queue.push_back(step{ start, 0 });
+    visible[index(start)] = 1;
+    num_visible++;
+
+    for (size_t head = 0; head < queue.size(); head++) {
+        step s = queue[head];
+
+        /* missing chunks are empty space, and open on every side */
+        chunk *ch = ship->chunks.find(s.c);
+        uint8_t sealed = ch ? ch->render_chunk.opaque_faces : 0;
+
+        for (int face = 0; face < face_count; face++) {
+            if (sealed & (1 << face))
+                continue;
+            if (s.dirs & (1 << (face ^ 1)))
+                continue;
+
+            glm::ivec3 n = s.c + surface_index_to_normal(face);
+            if (n.x < mins.x || n.y < mins.y || n.z < mins.z ||
+                n.x > maxs.x || n.y > maxs.y || n.z > maxs.z) {
+                continue;
+            }
+
+            size_t i = index(n);
+            if (visible[i])
+                continue;
+
+            num_tested++;
+            if (!chunk_in_frustum(f, n))
+                continue;
+
+            visible[i] = 1;
+            num_visible++;
+            queue.push_back(step{ n, (uint8_t)(s.dirs | (1 << face)) });
+        }
+    }
+}
+
+
+bool
+chunk_visibility::sphere_visible(frustum const & f, glm::vec3 center, float radius) const
+{
+    if (!f.intersects_sphere(center, radius))
+        return false;
+
+    glm::ivec3 lo = glm::ivec3(glm::floor((center - glm::vec3(radius)) / (float)CHUNK_SIZE));
+    glm::ivec3 hi = glm::ivec3(glm::floor((center + glm::vec3(radius)) / (float)CHUNK_SIZE));
+
+    for (int z = lo.z; z <= hi.z; z++) {
+        for (int y = lo.y; y <= hi.y; y++) {
+            for (int x = lo.x; x <= hi.x; x++) {
+                if (chunk_visible(glm::ivec3(x, y, z)))
+                    return true;
+            }
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <vector>
+
+#include "chunk.h"
+
+struct ship_space;
+
+/* the six planes of a view volume, pulled out of a view-projection matrix.
+ * normals face inward, so a point is inside when it is in front of all six.
+ */
+struct frustum {
+    glm::vec4 planes[6];
+
+    frustum() {}
+    explicit frustum(glm::mat4 const & view_proj);
+
+    /* false only if the box is entirely outside; boxes which straddle a
+     * corner of the frustum may still be reported as intersecting */
+    bool intersects_box(glm::vec3 mins, glm::vec3 maxs) const;
+    bool intersects_sphere(glm::vec3 center, float radius) const;
+};
+
+/* a mask of the faces of a chunk which are opaque from one side to the
+ * other: every block along that side has a wall or door on its outer face.
+ * bit n is surface_index n.
+ */
+uint8_t chunk_opaque_faces(chunk_blocks const *blocks);
+
+/* which chunks of a ship can be seen from a point, this frame.
+ *
+ * a chunk is visible if it is in the frustum and can be reached from the
+ * camera's chunk by a walk through other such chunks which never crosses a
+ * fully walled chunk face, and never turns back on a direction it has
+ * already moved in. the second rule keeps the walk from wrapping around
+ * bulkheads into rooms which are behind them.
+ *
+ * this is coarse -- a chunk face with a single hole in it lets everything
+ * through -- but the interior of one deck is usually walled off from the
+ * next on chunk boundaries.
+ */
+struct chunk_visibility {
+    glm::ivec3 mins;
+    glm::ivec3 maxs;
+    std::vector<uint8_t> visible;   /* one per chunk in mins..maxs */
+
+    unsigned num_visible;
+    unsigned num_tested;
+
+    chunk_visibility() : mins(0), maxs(-1), num_visible(0), num_tested(0) {}
+
+    void compute(ship_space *ship, frustum const & f, glm::vec3 eye);
+
+    bool chunk_visible(glm::ivec3 c) const
+    {
+        if (c.x < mins.x || c.y < mins.y || c.z < mins.z ||
+            c.x > maxs.x || c.y > maxs.y || c.z > maxs.z) {
+            return false;
+        }
+
+        return visible[index(c)] != 0;
+    }
+
+    /* whether anything within radius of center could be seen: it must be
+     * in the frustum, and overlap some visible chunk */
+    bool sphere_visible(frustum const & f, glm::vec3 center, float radius) const;
+
+private:
+    size_t index(glm::ivec3 c) const
+    {
+        glm::ivec3 d = maxs - mins + glm::ivec3(1);
+        glm::ivec3 o = c - mins;
+        return ((size_t)o.z * d.y + o.y) * d.x + o.x;
+    }
+};
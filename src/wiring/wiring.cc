@@ -349,6 +349,18 @@ attach_topo_find(ship_space *ship, wire_type type, unsigned p) {
 }
 
 
+unsigned
+attach_topo_peek(ship_space const *ship, wire_type type, unsigned p) {
+    auto const & wire_attachments = ship->wire_attachments[type];
+
+    while (wire_attachments[p].parent != p) {
+        p = wire_attachments[p].parent;
+    }
+
+    return p;
+}
+
+
 unsigned
 attach_topo_unite(ship_space *ship, wire_type type, unsigned from, unsigned to) {
     auto & wire_attachments = ship->wire_attachments[type];
@@ -471,7 +483,7 @@ publish_msg(ship_space *ship, c_entity ce, comms_msg msg)
 
     std::unordered_set<unsigned> visited_wires;
     for (auto sea : attaches->second) {
-        auto wire_index = attach_topo_find(ship, wire_type_comms, sea);
+        auto wire_index = attach_topo_peek(ship, wire_type_comms, sea);
         if (visited_wires.find(wire_index) != visited_wires.end()) {
             continue;
         }
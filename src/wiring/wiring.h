@@ -52,6 +52,11 @@ calc_segment_matrix(const wire_attachment &start, const wire_attachment &end);
 unsigned
 attach_topo_find(ship_space *ship, wire_type type, unsigned p);
 
+/* as attach_topo_find, but leaves the tree alone, so that any number of
+ * threads may look at once */
+unsigned
+attach_topo_peek(ship_space const *ship, wire_type type, unsigned p);
+
 unsigned
 attach_topo_unite(ship_space *ship, wire_type type, unsigned from, unsigned to);
 
@@ -0,0 +1,103 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+
+
+worker_pool::worker_pool(unsigned num_threads)
+    : busy(0), stopping(false)
+{
+    if (!num_threads) {
+        num_threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+
+    for (unsigned i = 0; i < num_threads; i++) {
+        threads.emplace_back(&worker_pool::work, this);
+    }
+}
+
+
+worker_pool::~worker_pool()
+{
+    {
+        std::lock_guard<std::mutex> g(lock);
+        stopping = true;
+    }
+
+    work_ready.notify_all();
+
+    for (auto & t : threads) {
+        t.join();
+    }
+}
+
+
+void
+worker_pool::submit(task job, task completion)
+{
+    {
+        std::lock_guard<std::mutex> g(lock);
+        jobs.push_back(std::make_pair(std::move(job), std::move(completion)));
+    }
+
+    work_ready.notify_one();
+}
+
+
+void
+worker_pool::run_completions()
+{
+    std::vector<task> done;
+    {
+        std::lock_guard<std::mutex> g(lock);
+        done.swap(completions);
+    }
+
+    /* completions may submit more jobs, so run them without the lock */
+    for (auto & c : done) {
+        c();
+    }
+}
+
+
+void
+worker_pool::wait()
+{
+    {
+        std::unique_lock<std::mutex> g(lock);
+        work_done.wait(g, [this]() { return jobs.empty() && !busy; });
+    }
+
+    run_completions();
+}
+
+
+void
+worker_pool::work()
+{
+    std::unique_lock<std::mutex> g(lock);
+
+    for (;;) {
+        work_ready.wait(g, [this]() { return stopping || !jobs.empty(); });
+        if (jobs.empty()) {
+            /* only stopping once the queue has drained */
+            return;
+        }
+
+        auto j = std::move(jobs.front());
+        jobs.pop_front();
+        busy++;
+
+        g.unlock();
+        j.first();
+        g.lock();
+
+        if (j.second) {
+            completions.push_back(std::move(j.second));
+        }
+
+        busy--;
+        if (jobs.empty() && !busy) {
+            work_done.notify_all();
+        }
+    }
+}
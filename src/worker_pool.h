@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* a fixed set of background threads which run jobs submitted from the main thread.
+ *
+ * a job may come with a completion, which is run back on the main thread by
+ * run_completions() once the job has finished. this is where results get handed
+ * to anything which is not thread-safe -- GL, the physics world.
+ *
+ * jobs must not touch anything the main thread might be changing; copy what
+ * they need up front.
+ */
+struct worker_pool {
+    typedef std::function<void()> task;
+
+    /* num_threads == 0 means one per core, less one for the main thread */
+    worker_pool(unsigned num_threads = 0);
+    ~worker_pool();
+
+    void submit(task job, task completion = task());
+
+    /* runs the completions of every job which has finished so far */
+    void run_completions();
+
+    /* waits for every job submitted so far, then runs their completions */
+    void wait();
+
+    unsigned num_threads() const { return (unsigned)threads.size(); }
+
+private:
+    std::vector<std::thread> threads;
+
+    std::mutex lock;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+
+    std::deque<std::pair<task, task>> jobs;
+    std::vector<task> completions;
+    unsigned busy;      /* jobs taken by a worker but not yet finished */
+    bool stopping;
+
+    void work();
+};
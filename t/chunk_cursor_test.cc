@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <assert.h>
+#include "../src/common.h"
+#include "../src/ship_space.h"
+#include "../src/chunk_cursor.h"
+
+
+static glm::ivec3 dirs[] = {
+    glm::ivec3(1, 0, 0),
+    glm::ivec3(-1, 0, 0),
+    glm::ivec3(0, 1, 0),
+    glm::ivec3(0, -1, 0),
+    glm::ivec3(0, 0, 1),
+    glm::ivec3(0, 0, -1),
+};
+
+/* the cursor must visit every block of the chunk exactly once, and
+ * agree with ship_space about where each one is */
+void
+walk(void)
+{
+    ship_space *ss = ship_space::mock_ship_space();
+    int n = 0;
+
+    for (chunk_cursor c(ss, glm::ivec3(0, 0, 0)); c.valid(); c.next()) {
+        assert(c.get_block() == ss->get_block(c.pos()));
+        assert(c.get_topo() == ss->get_topo_info(c.pos()));
+        n++;
+    }
+
+    assert(n == CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE);
+
+    /* no chunk, no walk */
+    chunk_cursor none(ss, glm::ivec3(100, 100, 100));
+    assert(!none.valid());
+}
+
+
+/* neighbours must match ship_space lookups, both within the chunk and across
+ * chunk boundaries, including into chunks which do not exist */
+void
+neighbors(void)
+{
+    ship_space *ss = ship_space::mock_ship_space();
+
+    for (auto it : ss->chunks) {
+        for (chunk_cursor c(ss, it.first); c.valid(); c.next()) {
+            for (int face = 0; face < 6; face++) {
+                glm::ivec3 p = c.pos() + dirs[face];
+                assert(c.neighbor_block(face) == ss->get_block(p));
+                assert(c.neighbor_topo(face) == ss->get_topo_info(p));
+            }
+        }
+    }
+}
+
+
+void
+at_block(void)
+{
+    ship_space *ss = ship_space::mock_ship_space();
+
+    glm::ivec3 p(-1, 3, 9);
+    ss->ensure_block(p);
+
+    chunk_cursor c = chunk_cursor::at_block(ss, p);
+    assert(c.valid());
+    assert(c.pos() == p);
+    assert(c.get_block() == ss->get_block(p));
+}
+
+
+int
+main(void)
+{
+    walk();
+    neighbors();
+    at_block();
+}
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <assert.h>
+#include "../src/chunk.h"
+#include "../src/chunk_index.h"
+
+
+/* fill a box of chunks straddling the origin, forcing several grows */
+void
+fill(void)
+{
+    chunk_index index;
+    chunk *chunks = new chunk[10 * 10 * 10];
+    int n = 0;
+
+    for (int k = -5; k < 5; k++) {
+        for (int j = -5; j < 5; j++) {
+            for (int i = -5; i < 5; i++) {
+                assert(index.get(glm::ivec3(i, j, k)) == 0);
+                index.insert(glm::ivec3(i, j, k), &chunks[n++]);
+            }
+        }
+    }
+
+    assert(index.size() == 1000);
+
+    n = 0;
+    for (int k = -5; k < 5; k++) {
+        for (int j = -5; j < 5; j++) {
+            for (int i = -5; i < 5; i++) {
+                assert(index.get(glm::ivec3(i, j, k)) == &chunks[n]);
+                /* and again, from the cache */
+                assert(index.get(glm::ivec3(i, j, k)) == &chunks[n]);
+                assert(index.find(glm::ivec3(i, j, k)) == &chunks[n]);
+                n++;
+            }
+        }
+    }
+
+    assert(index.get(glm::ivec3(5, 0, 0)) == 0);
+    assert(index.get(glm::ivec3(0, -6, 0)) == 0);
+
+    /* every entry is visited exactly once */
+    int visited = 0;
+    for (auto it : index) {
+        assert(index.find(it.first) == it.second);
+        visited++;
+    }
+    assert(visited == 1000);
+
+    delete [] chunks;
+}
+
+
+int
+main(void)
+{
+    fill();
+}
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <assert.h>
+#include "../src/component/c_entity.h"
+#include "../src/component/power_component.h"
+
+
+/* instances are found by entity, and stay found as others are destroyed
+ * around them */
+void
+lookups(void)
+{
+    power_component_manager m;
+    m.create_component_instance_data(2);
+
+    c_entity e[8];
+    for (int i = 0; i < 8; i++) {
+        e[i] = c_entity::spawn();
+        assert(e[i].id);
+        assert(!m.exists(e[i]));
+
+        /* past what was allocated, to grow the pool */
+        m.assign_entity(e[i]);
+        *m.get_instance_data(e[i]).required_power = (float)i;
+    }
+    assert(m.buffer.num == 8);
+
+    /* the last, one in the middle, and the first */
+    m.destroy_entity_instance(e[7]);
+    m.destroy_entity_instance(e[3]);
+    m.destroy_entity_instance(e[0]);
+    m.destroy_entity_instance(e[0]);    /* does nothing */
+    assert(m.buffer.num == 5);
+
+    for (int i = 0; i < 8; i++) {
+        bool gone = i == 0 || i == 3 || i == 7;
+        assert(m.exists(e[i]) == !gone);
+        if (!gone) {
+            auto d = m.get_instance_data(e[i]);
+            assert(*d.entity == e[i]);
+            assert(*d.required_power == (float)i);
+        }
+    }
+
+    /* no entity is never there */
+    c_entity none = { 0 };
+    assert(!m.exists(none));
+}
+
+
+/* a destroyed entity's index comes back with a new generation, and the old
+ * handle doesn't find the new entity's instances */
+void
+reuse(void)
+{
+    power_component_manager m;
+    m.create_component_instance_data(4);
+
+    auto a = c_entity::spawn();
+    m.assign_entity(a);
+    m.destroy_entity_instance(a);
+    c_entity::destroy(a);
+
+    auto b = c_entity::spawn();
+    assert(b.index() == a.index());
+    assert(b.generation() != a.generation());
+    assert(!(a == b));
+
+    m.assign_entity(b);
+    assert(m.exists(b));
+    assert(!m.exists(a));
+
+    /* destroying a again gives nothing back */
+    c_entity::destroy(a);
+    auto c = c_entity::spawn();
+    assert(c.index() != b.index());
+}
+
+
+int
+main(void)
+{
+    lookups();
+    reuse();
+}
@@ -0,0 +1,362 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <vector>
+#include "../src/common.h"
+#include "../src/ship_space.h"
+#include "../src/light_kernel.h"
+#include "../src/light_prop.h"
+
+
+struct source {
+    glm::ivec3 p;
+    int level;
+};
+
+
+/* sets one side of a surface only, so light may pass one way */
+static void
+set_face(ship_space *ss, glm::ivec3 p, int face, surface_type st)
+{
+    glm::ivec3 bl, ch;
+    split_block_coord(p, &bl, &ch);
+    ss->get_chunk(ch)->set_surface(bl.x, bl.y, bl.z, face, st);
+}
+
+
+/* flips one side of a surface between nothing and wall */
+static void
+toggle_face(ship_space *ss, glm::ivec3 p, int face)
+{
+    set_face(ss, p, face, ss->get_block(p)->surfs[face] ? surface_none : surface_wall);
+}
+
+
+/* lights the whole ship from scratch the slow way -- sweeping until
+ * nothing changes -- into a plain box of levels over the ship's extent, for
+ * the incremental version to be checked against */
+static std::vector<int>
+relight_everything(ship_space *ss, std::vector<source> const & sources)
+{
+    glm::ivec3 lo = ss->mins * CHUNK_SIZE;
+    glm::ivec3 hi = (ss->maxs + glm::ivec3(1)) * CHUNK_SIZE;
+    glm::ivec3 size = hi - lo;
+
+    std::vector<int> levels(size.x * size.y * size.z);
+    auto level_at = [&](glm::ivec3 p) -> int {
+        glm::ivec3 o = p - lo;
+        if (o.x < 0 || o.y < 0 || o.z < 0 || o.x >= size.x || o.y >= size.y || o.z >= size.z)
+            return 0;
+        return levels[o.x + size.x * (o.y + size.y * o.z)];
+    };
+
+    for (auto const & s : sources) {
+        glm::ivec3 o = s.p - lo;
+        int & l = levels[o.x + size.x * (o.y + size.y * o.z)];
+        l = std::max(l, s.level);
+    }
+
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (int z = lo.z; z < hi.z; z++) {
+            for (int y = lo.y; y < hi.y; y++) {
+                for (int x = lo.x; x < hi.x; x++) {
+                    glm::ivec3 p(x, y, z);
+                    block const *b = ss->get_block(p);
+                    int level = level_at(p);
+
+                    for (int face = 0; face < face_count; face++) {
+                        if (light_permeable(b->surfs[face])) {
+                            level = std::max(level, level_at(p + surface_index_to_normal(face)) - LIGHT_ATTEN);
+                        }
+                    }
+
+                    if (level != level_at(p)) {
+                        glm::ivec3 o = p - lo;
+                        levels[o.x + size.x * (o.y + size.y * o.z)] = level;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+
+    return levels;
+}
+
+
+static void
+check_matches(ship_space *ss, light_grid *grid, std::vector<int> const & expected)
+{
+    glm::ivec3 lo = ss->mins * CHUNK_SIZE;
+    glm::ivec3 hi = (ss->maxs + glm::ivec3(1)) * CHUNK_SIZE;
+
+    size_t i = 0;
+    for (int z = lo.z; z < hi.z; z++) {
+        for (int y = lo.y; y < hi.y; y++) {
+            for (int x = lo.x; x < hi.x; x++) {
+                assert(grid->get(glm::ivec3(x, y, z)) == expected[i++]);
+            }
+        }
+    }
+}
+
+
+static void
+relight(light_propagator *prop, std::vector<source> const & sources)
+{
+    for (auto const & s : sources) {
+        prop->add_source(s.p, s.level);
+    }
+
+    prop->propagate();
+}
+
+
+/* one light in open space falls off by LIGHT_ATTEN per block, and stops at walls */
+void
+single_light(void)
+{
+    ship_space *ss = new ship_space();
+    ss->ensure_chunk(glm::ivec3(0, 0, 0));
+
+    light_grid levels(ss);
+    light_propagator prop(&levels);
+
+    std::vector<source> sources;
+    sources.push_back(source{ glm::ivec3(4, 4, 4), 255 });
+    relight(&prop, sources);
+
+    assert(prop.get(glm::ivec3(4, 4, 4)) == 255);
+    assert(prop.get(glm::ivec3(5, 4, 4)) == 255 - LIGHT_ATTEN);
+    assert(prop.get(glm::ivec3(5, 5, 4)) == 255 - 2 * LIGHT_ATTEN);
+    assert(prop.get(glm::ivec3(4, 4, 0)) == 255 - 4 * LIGHT_ATTEN);
+
+    /* nothing outside the ship is lit */
+    assert(prop.get(glm::ivec3(4, 4, 8)) == 0);
+
+    /* wall off 5,4,4 from the light */
+    set_face(ss, glm::ivec3(5, 4, 4), surface_xm, surface_wall);
+    prop.invalidate(glm::ivec3(5, 4, 4));
+    relight(&prop, sources);
+
+    /* it's still lit the long way round */
+    assert(prop.get(glm::ivec3(5, 4, 4)) == 255 - 3 * LIGHT_ATTEN);
+
+    /* turn the light off */
+    sources.clear();
+    prop.invalidate(glm::ivec3(4, 4, 4));
+    relight(&prop, sources);
+
+    for (auto const & l : ss->get_chunk(glm::ivec3(0, 0, 0))->light_chunk.levels.contents) {
+        for (auto const & row : l) {
+            for (auto v : row) {
+                assert(v == 0);
+            }
+        }
+    }
+}
+
+
+/* after any sequence of edits, the incremental result must match lighting
+ * everything from scratch. the ship spans more than 128 blocks, and reaches
+ * into negative space. */
+void
+random_edits(void)
+{
+    srand(7);
+
+    ship_space *ss = new ship_space();
+    for (int x = -10; x < 8; x++) {
+        for (int y = -1; y < 1; y++) {
+            ss->ensure_chunk(glm::ivec3(x, y, 0));
+        }
+    }
+
+    glm::ivec3 lo = ss->mins * CHUNK_SIZE;
+    glm::ivec3 size = (ss->maxs - ss->mins + glm::ivec3(1)) * CHUNK_SIZE;
+
+    light_grid levels(ss);
+    light_propagator prop(&levels);
+    std::vector<source> sources;
+
+    for (int step = 0; step < 300; step++) {
+        glm::ivec3 p = lo + glm::ivec3(rand() % size.x, rand() % size.y, rand() % size.z);
+
+        if (rand() % 4 == 0) {
+            /* a light goes on, off, or changes brightness */
+            bool found = false;
+            for (auto it = sources.begin(); it != sources.end(); ++it) {
+                if (it->p == p) {
+                    sources.erase(it);
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found || rand() % 2)
+                sources.push_back(source{ p, 50 + rand() % 206 });
+        }
+        else {
+            /* a surface comes or goes. only one side, so light may pass one way only */
+            toggle_face(ss, p, rand() % face_count);
+        }
+
+        prop.invalidate(p);
+        relight(&prop, sources);
+
+        check_matches(ss, &levels, relight_everything(ss, sources));
+    }
+}
+
+
+/* only the chunks around a change are marked for upload */
+void
+dirty_chunks(void)
+{
+    ship_space *ss = new ship_space();
+    for (int x = 0; x < 4; x++) {
+        ss->ensure_chunk(glm::ivec3(x, 0, 0));
+    }
+
+    light_grid levels(ss);
+    light_propagator prop(&levels);
+
+    std::vector<source> sources;
+    sources.push_back(source{ glm::ivec3(4, 4, 4), 255 });
+    relight(&prop, sources);
+    assert(levels.dirty_chunks.size() == 2);
+    levels.clear_dirty();
+
+    /* relighting what is already lit changes nothing */
+    relight(&prop, sources);
+    assert(levels.dirty_chunks.empty());
+
+    /* a light at the far end only reaches the last two */
+    sources.push_back(source{ glm::ivec3(28, 4, 4), 255 });
+    prop.invalidate(glm::ivec3(28, 4, 4));
+    relight(&prop, sources);
+    assert(levels.dirty_chunks.size() == 2);
+    assert(levels.dirty_chunks[0] == glm::ivec3(3, 0, 0) || levels.dirty_chunks[1] == glm::ivec3(3, 0, 0));
+    assert(levels.dirty_chunks[0] == glm::ivec3(2, 0, 0) || levels.dirty_chunks[1] == glm::ivec3(2, 0, 0));
+}
+
+
+/* relighting everything at once gets the same light as doing it a piece at
+ * a time, and the incremental path carries on from it */
+void
+rebuild_everything(void)
+{
+    /* light crosses into a neighbour on each side by itself */
+    for (int face = 0; face < face_count; face++) {
+        ship_space *ss = new ship_space();
+        glm::ivec3 n = surface_index_to_normal(face);
+        ss->ensure_chunk(glm::ivec3(0, 0, 0));
+        ss->ensure_chunk(n);
+
+        std::vector<source> sources;
+        sources.push_back(source{ glm::ivec3(4, 4, 4) + 3 * n, 255 });
+
+        light_grid levels(ss);
+        light_propagator prop(&levels);
+        for (auto const & s : sources) {
+            prop.add_source(s.p, s.level);
+        }
+
+        prop.rebuild();
+        assert(prop.get(glm::ivec3(4, 4, 4) + 4 * n) == 255 - LIGHT_ATTEN);
+        check_matches(ss, &levels, relight_everything(ss, sources));
+    }
+
+    srand(13);
+
+    ship_space *ss = new ship_space();
+    for (int x = -3; x < 3; x++) {
+        for (int y = -2; y < 2; y++) {
+            for (int z = -1; z < 1; z++) {
+                ss->ensure_chunk(glm::ivec3(x, y, z));
+            }
+        }
+    }
+
+    glm::ivec3 lo = ss->mins * CHUNK_SIZE;
+    glm::ivec3 size = (ss->maxs - ss->mins + glm::ivec3(1)) * CHUNK_SIZE;
+
+    std::vector<source> sources;
+    for (int i = 0; i < 400; i++) {
+        glm::ivec3 q = lo + glm::ivec3(rand() % size.x, rand() % size.y, rand() % size.z);
+        set_face(ss, q, rand() % face_count, surface_wall);
+    }
+
+    for (int i = 0; i < 30; i++) {
+        glm::ivec3 p = lo + glm::ivec3(rand() % size.x, rand() % size.y, rand() % size.z);
+        sources.push_back(source{ p, 50 + rand() % 206 });
+    }
+
+    light_grid levels(ss);
+    light_propagator prop(&levels);
+
+    /* stale light from before is thrown away */
+    prop.add_source(lo, 255);
+    prop.propagate();
+
+    for (auto const & s : sources) {
+        prop.add_source(s.p, s.level);
+    }
+
+    prop.rebuild();
+    check_matches(ss, &levels, relight_everything(ss, sources));
+
+    for (int step = 0; step < 20; step++) {
+        glm::ivec3 p = lo + glm::ivec3(rand() % size.x, rand() % size.y, rand() % size.z);
+        toggle_face(ss, p, rand() % face_count);
+
+        prop.invalidate(p);
+        relight(&prop, sources);
+        check_matches(ss, &levels, relight_everything(ss, sources));
+    }
+}
+
+
+/* the vector and scalar sweeps settle on the same light */
+void
+sweep_kernels_agree(void)
+{
+    srand(17);
+
+    for (int round = 0; round < 50; round++) {
+        chunk_faces faces;
+        for (unsigned i = 0; i < CHUNK_VOLUME; i++) {
+            for (int f = 0; f < face_count; f++) {
+                faces.set(i, f, rand() % 4 ? surface_none : surface_wall);
+            }
+        }
+
+        static light_pad a, b;
+        memset(&a, 0, sizeof(a));
+        for (int i = 0; i < LIGHT_PAD_VOLUME; i++) {
+            a.levels[i] = rand() % 8 ? 0 : rand() % 256;
+        }
+        a.load_faces(&faces);
+        b = a;
+
+        while (light_sweep(&a))
+            ;
+        while (light_sweep_scalar(&b))
+            ;
+
+        assert(!memcmp(a.levels, b.levels, sizeof(a.levels)));
+    }
+}
+
+
+int
+main(void)
+{
+    single_light();
+    random_edits();
+    dirty_chunks();
+    rebuild_everything();
+    sweep_kernels_agree();
+}
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <assert.h>
+#include "../src/block.h"
+#include "../src/palette_cube.h"
+
+
+typedef palette_cube<block, 8> cube;
+
+
+/* a new cube is a single zeroed block, however it is read */
+void
+uniform(void)
+{
+    cube c;
+    assert(c.uniform());
+    assert(c.heap_size() == sizeof(block));
+
+    for (unsigned i = 0; i < cube::volume; i++) {
+        assert(c.at(i)->type == block_empty);
+        assert(c.at(i) == c.at(0));
+    }
+
+    assert(c.get(7, 7, 7) == c.at(cube::volume - 1));
+}
+
+
+/* writing expands; compacting keeps every cell and picks the smallest form */
+void
+round_trip(void)
+{
+    cube c;
+    c.edit(1, 2, 3)->type = block_support;
+    c.edit(7, 0, 0)->surfs[surface_xp] = surface_wall;
+    assert(c.full());
+
+    static fixed_cube<block, 8> before, after;
+    c.store(&before.contents[0][0][0]);
+
+    c.compact();
+    assert(!c.full() && !c.uniform());
+    assert(c.get(1, 2, 3)->type == block_support);
+    assert(c.get(7, 0, 0)->surfs[surface_xp] == surface_wall);
+    assert(c.get(0, 0, 0)->type == block_empty);
+
+    c.store(&after.contents[0][0][0]);
+    assert(!memcmp(&before, &after, sizeof(before)));
+
+    /* put back as it was, it is uniform again */
+    c.edit(1, 2, 3)->type = block_empty;
+    c.edit(7, 0, 0)->surfs[surface_xp] = surface_none;
+    c.compact();
+    assert(c.uniform());
+}
+
+
+/* more distinct cells than a palette can index stay full */
+void
+too_varied(void)
+{
+    static fixed_cube<block, 8> src, out;
+    for (unsigned i = 0; i < cube::volume; i++) {
+        block *b = &src.contents[0][0][0] + i;
+        b->surf_space[0] = (unsigned short)i;
+    }
+
+    cube c;
+    c.load(&src.contents[0][0][0]);
+    assert(c.full());
+
+    c.store(&out.contents[0][0][0]);
+    assert(!memcmp(&src, &out, sizeof(src)));
+}
+
+
+int
+main(void)
+{
+    uniform();
+    round_trip();
+    too_varied();
+}
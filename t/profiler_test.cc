@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <chrono>
+#include "../src/profiler.h"
+
+
+/* spins for at least the given time, so that zones have some length */
+static void
+spin(double ms)
+{
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() < ms)
+        ;
+}
+
+
+/* zones nest, and are closed in the frame they began in */
+void
+nesting(void)
+{
+    profiler *p = new profiler();
+
+    /* nothing is kept until the first frame */
+    p->begin("early");
+    p->end();
+    p->begin_frame();
+    assert(!p->get_frame(0));
+
+    p->begin("a");
+    p->begin("b");
+    spin(1);
+    p->end();
+    p->begin("c");
+    p->end();
+    p->end();
+    p->begin("d");          /* left open */
+    p->begin_frame();
+
+    auto f = p->get_frame(0);
+    assert(f);
+    assert(!p->get_frame(1));
+    assert(f->num_zones == 4);
+    assert(!strcmp(f->zones[0].name, "a") && f->zones[0].depth == 0);
+    assert(!strcmp(f->zones[1].name, "b") && f->zones[1].depth == 1);
+    assert(!strcmp(f->zones[2].name, "c") && f->zones[2].depth == 1);
+    assert(!strcmp(f->zones[3].name, "d") && f->zones[3].depth == 0);
+
+    assert(f->zones[1].end - f->zones[1].start >= 1000000);
+    assert(f->zones[0].start <= f->zones[1].start);
+    assert(f->zones[0].end >= f->zones[2].end);
+    assert(f->zones[3].end == f->end);
+
+    /* closing d now does nothing to the next frame */
+    p->end();
+    p->begin("e");
+    p->end();
+    p->begin_frame();
+    assert(p->get_frame(0)->num_zones == 1);
+    assert(p->get_frame(1) == f);
+
+    delete p;
+}
+
+
+/* the ring keeps the newest frames, and drops zones which don't fit */
+void
+ring_and_overflow(void)
+{
+    profiler *p = new profiler();
+    p->begin_frame();
+
+    for (unsigned i = 0; i < 3 * PROFILE_FRAMES; i++) {
+        for (unsigned j = 0; j <= i % 4; j++) {
+            p->begin("z");
+            p->end();
+        }
+        p->begin_frame();
+    }
+
+    assert(p->num_frames == PROFILE_FRAMES - 1);
+    assert(!p->get_frame(PROFILE_FRAMES - 1));
+    for (unsigned age = 0; age < PROFILE_FRAMES - 1; age++) {
+        unsigned i = 3 * PROFILE_FRAMES - 1 - age;
+        assert(p->get_frame(age)->num_zones == i % 4 + 1);
+    }
+    assert(p->dropped == 0);
+
+    /* too many zones */
+    for (unsigned i = 0; i < PROFILE_MAX_ZONES + 10; i++) {
+        p->begin("z");
+        p->end();
+    }
+
+    /* too deep: the outer zones still close in the right order */
+    p->begin("outer");
+    for (unsigned i = 0; i < PROFILE_MAX_DEPTH + 5; i++) {
+        p->begin("deep");
+    }
+    for (unsigned i = 0; i < PROFILE_MAX_DEPTH + 5; i++) {
+        p->end();
+    }
+    assert(p->depth == 1);
+    p->end();
+    assert(p->depth == 0);
+
+    p->begin_frame();
+    assert(p->get_frame(0)->num_zones == PROFILE_MAX_ZONES);
+    assert(p->dropped == 10 + 1 + PROFILE_MAX_DEPTH + 5);
+
+    delete p;
+}
+
+
+/* zones are matched across frames by name and depth, summed within one, and
+ * listed even if the newest frame doesn't have them */
+void
+summary(void)
+{
+    profiler *p = new profiler();
+    p->begin_frame();
+
+    for (int i = 0; i < 4; i++) {
+        p->begin("tick");
+        p->begin("part");
+        p->end();
+        p->begin("part");
+        p->end();
+        p->end();
+
+        /* only in the older frames */
+        if (i < 2) {
+            p->begin("rare");
+            p->end();
+        }
+        p->begin_frame();
+    }
+
+    /* and one only in the newest */
+    p->begin("new");
+    p->end();
+    p->begin_frame();
+
+    profile_stat stats[8];
+    unsigned n = p->summarize(stats, 8);
+    assert(n == 4);
+    assert(!strcmp(stats[0].name, "tick") && stats[0].depth == 0);
+    assert(!strcmp(stats[1].name, "part") && stats[1].depth == 1);
+    assert(!strcmp(stats[2].name, "rare") && stats[2].depth == 0);
+    assert(!strcmp(stats[3].name, "new") && stats[3].depth == 0);
+    assert(stats[2].last_ms == 0);
+
+    for (unsigned k = 0; k < n; k++) {
+        assert(stats[k].avg_ms >= 0);
+        assert(stats[k].max_ms >= stats[k].avg_ms);
+        assert(stats[k].max_ms >= stats[k].last_ms);
+    }
+    assert(stats[0].avg_ms >= stats[1].avg_ms);
+
+    /* a short out */
+    assert(p->summarize(stats, 1) == 1);
+
+    delete p;
+}
+
+
+/* the trace is one event per zone, plus one per frame */
+void
+trace(void)
+{
+    profiler *p = new profiler();
+    p->begin_frame();
+    p->begin("say \"hi\"");
+    p->end();
+    p->begin_frame();
+
+    char const *filename = "profiler_test.json";
+    assert(p->dump_trace(filename));
+
+    FILE *f = fopen(filename, "r");
+    assert(f);
+    char buf[1024];
+    size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[len] = 0;
+    fclose(f);
+    remove(filename);
+
+    assert(strstr(buf, "\"traceEvents\""));
+    assert(strstr(buf, "\"name\":\"frame\""));
+    assert(strstr(buf, "\"name\":\"say \\\"hi\\\"\""));
+    assert(!strstr(buf, "},\n]"));
+
+    delete p;
+}
+
+
+int
+main(void)
+{
+    nesting();
+    ring_and_overflow();
+    summary();
+    trace();
+}
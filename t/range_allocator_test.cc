@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <assert.h>
+#include "../src/range_allocator.h"
+
+
+/* ranges are handed out first-fit, and come back out of the same holes */
+void
+first_fit(void)
+{
+    range_allocator r(100);
+
+    unsigned a = r.alloc(10);
+    unsigned b = r.alloc(20);
+    unsigned c = r.alloc(30);
+    assert(a == 0);
+    assert(b == 10);
+    assert(c == 30);
+    assert(r.get_used() == 60);
+
+    /* too big for anything left */
+    assert(r.alloc(41) == range_allocator::invalid);
+
+    /* the hole b leaves is reused before the tail */
+    r.free(b, 20);
+    assert(r.alloc(15) == 10);
+    assert(r.alloc(10) == 60);
+    assert(r.alloc(5) == 25);
+    assert(r.get_used() == 70);
+}
+
+
+/* returned ranges merge with their neighbours, whichever order they come back in */
+void
+coalescing(void)
+{
+    range_allocator r(100);
+
+    unsigned a = r.alloc(25);
+    unsigned b = r.alloc(25);
+    unsigned c = r.alloc(25);
+    unsigned d = r.alloc(25);
+    assert(r.num_free_ranges() == 0);
+
+    r.free(a, 25);
+    r.free(c, 25);
+    assert(r.num_free_ranges() == 2);
+
+    /* fills the gap between two holes */
+    r.free(b, 25);
+    assert(r.num_free_ranges() == 1);
+
+    /* joins onto the end of the hole */
+    r.free(d, 25);
+    assert(r.num_free_ranges() == 1);
+    assert(r.get_used() == 0);
+
+    /* the whole space is one range again */
+    assert(r.alloc(100) == 0);
+}
+
+
+/* growing adds space at the end without moving anything */
+void
+growing(void)
+{
+    range_allocator r;
+    assert(r.alloc(1) == range_allocator::invalid);
+
+    r.grow(10);
+    assert(r.alloc(8) == 0);
+    assert(r.alloc(4) == range_allocator::invalid);
+
+    /* the new space joins onto the two units left at the end */
+    r.grow(20);
+    assert(r.num_free_ranges() == 1);
+    assert(r.alloc(12) == 8);
+    assert(r.get_used() == 20);
+    assert(r.get_capacity() == 20);
+}
+
+
+int
+main(void)
+{
+    first_fit();
+    coalescing();
+    growing();
+}
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include "../src/scheduler.h"
+#include "../src/worker_pool.h"
+
+
+enum {
+    res_a = 1 << 0,
+    res_b = 1 << 1,
+    res_c = 1 << 2,
+};
+
+
+/* conflicting systems keep their order: writers before readers, readers
+ * before the next writer, writers before writers */
+void
+ordering(worker_pool *pool)
+{
+    system_scheduler s;
+    int a = 0, b = 0;
+    int seen_a = -1, seen_b = -1, seen_a2 = -1;
+
+    s.add("write a", 0, res_a, [&]() { a = 1; });
+    s.add("write b", 0, res_b, [&]() { b = 1; });
+    s.add("read a", res_a, 0, [&]() { seen_a = a; });
+    s.add("rewrite a", 0, res_a, [&]() { a = 2; });
+    s.add("read a and b", res_a | res_b, 0, [&]() { seen_a2 = a; seen_b = b; });
+
+    assert(s.systems[0].num_deps == 0);
+    assert(s.systems[1].num_deps == 0);
+    assert(s.systems[2].num_deps == 1);     /* write a */
+    assert(s.systems[3].num_deps == 2);     /* write a, read a */
+    assert(s.systems[4].num_deps == 3);     /* write a, write b, rewrite a */
+
+    for (int i = 0; i < 200; i++) {
+        a = b = 0;
+        seen_a = seen_b = seen_a2 = -1;
+
+        s.run(pool);
+
+        assert(seen_a == 1);
+        assert(seen_a2 == 2);
+        assert(seen_b == 1);
+    }
+}
+
+
+/* a split system sees each of its items once, in grain-sized pieces, and
+ * everything after it sees all of them done */
+void
+ranges(worker_pool *pool)
+{
+    system_scheduler s;
+    std::vector<std::atomic<int>> items(1000);
+    unsigned n = 1000;
+    bool all_done = false;
+    std::atomic<unsigned> biggest(0);
+
+    s.add("items", 0, res_a, [&]() { return n; }, 64,
+          [&](unsigned begin, unsigned end) {
+              assert(begin < end && end <= n);
+              assert(end - begin <= 64);
+              if (end - begin > biggest)
+                  biggest = end - begin;
+              for (unsigned i = begin; i < end; i++) {
+                  items[i]++;
+              }
+          });
+
+    s.add("check", res_a, 0, [&]() {
+        all_done = true;
+        for (unsigned i = 0; i < n; i++) {
+            all_done = all_done && items[i] == 1;
+        }
+    });
+
+    s.run(pool);
+    assert(all_done);
+    assert(biggest == 64);
+
+    /* the count is taken at each run */
+    n = 10;
+    for (auto & i : items) {
+        i = 0;
+    }
+    s.run(pool);
+    assert(all_done);
+    assert(items[10] == 0);
+}
+
+
+/* a system with no items finishes at once, and holds nothing up */
+void
+empty(worker_pool *pool)
+{
+    system_scheduler s;
+    bool ran = false, after = false;
+
+    s.add("nothing", 0, res_a, []() { return 0u; }, 16,
+          [&](unsigned, unsigned) { ran = true; });
+    s.add("after", res_a, res_c, [&]() { after = true; });
+
+    s.run(pool);
+    assert(!ran);
+    assert(after);
+
+    /* nor does an empty scheduler */
+    system_scheduler none;
+    none.run(pool);
+}
+
+
+/* independent systems may overlap: two which each wait to see the other
+ * start can only both finish on two threads at once */
+void
+overlap(worker_pool *pool)
+{
+    system_scheduler s;
+    std::atomic<int> started(0);
+    bool met[2] = { false, false };
+
+    for (int i = 0; i < 2; i++) {
+        s.add(i ? "second" : "first", 0, i ? res_b : res_a, [&, i]() {
+            started++;
+            auto start = std::chrono::steady_clock::now();
+            while (started < 2 && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+                ;
+            met[i] = started == 2;
+        });
+    }
+
+    s.run(pool);
+    assert(met[0] && met[1]);
+}
+
+
+int
+main(void)
+{
+    ordering(nullptr);
+    ranges(nullptr);
+    empty(nullptr);
+
+    worker_pool pool(4);
+    ordering(&pool);
+    ranges(&pool);
+    empty(&pool);
+    overlap(&pool);
+
+    /* the pool is still good for anything else */
+    std::atomic<int> ran(0);
+    pool.submit([&ran]() { ran++; });
+    pool.wait();
+    assert(ran == 1);
+}
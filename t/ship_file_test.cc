@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <vector>
+#include "../src/common.h"
+#include "../src/ship_space.h"
+#include "../src/ship_file.h"
+
+#define TEST_SHIP_FILE "ship_file_test.en"
+
+
+static float
+air_at(ship_space *ss, glm::ivec3 p)
+{
+    zone_info *z = ss->get_zone_info(topo_find(ss->get_topo_info(p)));
+    return z ? z->air_amount : 0.0f;
+}
+
+
+/* write the mock ship out, map it back in, and check nothing was lost */
+void
+round_trip(void)
+{
+    ship_space *ss = ship_space::mock_ship_space();
+    ss->rebuild_topology();
+
+    /* the mock rooms vent through their floor grates; seal the first one */
+    for (int x = 2; x < 6; x++) {
+        for (int y = 2; y < 6; y++) {
+            ss->set_surface(glm::ivec3(x, y, 0), glm::ivec3(x, y, 1), surface_zp, surface_wall);
+        }
+    }
+
+    /* put some air in it */
+    topo_info *room = topo_find(ss->get_topo_info(glm::ivec3(3, 3, 3)));
+    ss->insert_zone(room, new zone_info(42.0f));
+
+    assert(ss->save(TEST_SHIP_FILE, nullptr));
+
+    ship_space *loaded = ship_space::load(TEST_SHIP_FILE, nullptr, 0);
+    assert(loaded);
+    assert(loaded->mins == ss->mins);
+    assert(loaded->maxs == ss->maxs);
+
+    /* nothing has been paged in yet */
+    assert(loaded->chunks.size() == 0);
+
+    /* touching a block pages in just its chunk */
+    assert(loaded->get_block(glm::ivec3(3, 3, 3)));
+    assert(loaded->chunks.size() == 1);
+
+    /* zones come back without a rebuild */
+    assert(loaded->num_full_rebuilds == 0);
+    assert(air_at(loaded, glm::ivec3(3, 3, 3)) == 42.0f);
+    assert(air_at(loaded, glm::ivec3(11, 11, 3)) == 0.0f);
+    assert(topo_find(loaded->get_topo_info(glm::ivec3(3, 3, 3)))->size ==
+           topo_find(ss->get_topo_info(glm::ivec3(3, 3, 3)))->size);
+    assert(topo_find(loaded->get_topo_info(glm::ivec3(3, 3, 3))) !=
+           topo_find(loaded->get_topo_info(glm::ivec3(11, 11, 3))));
+    assert(topo_find(loaded->get_topo_info(glm::ivec3(-1, 0, 0))) ==
+           topo_find(&loaded->outside_topo_info));
+
+    /* every block matches */
+    static chunk_blocks saved, restored;
+    for (auto it : ss->chunks) {
+        chunk *other = loaded->get_chunk(it.first);
+        assert(other);
+        it.second->blocks.store(&saved.contents[0][0][0]);
+        other->blocks.store(&restored.contents[0][0][0]);
+        assert(!memcmp(&saved.contents, &restored.contents, sizeof(saved.contents)));
+    }
+
+    assert(loaded->chunks.size() == ss->chunks.size());
+    assert(loaded->validate());
+
+    /* a full rebuild must carry the zones across from the file */
+    loaded->rebuild_topology();
+    assert(air_at(loaded, glm::ivec3(3, 3, 3)) == 42.0f);
+    assert(topo_find(loaded->get_topo_info(glm::ivec3(3, 3, 3)))->size ==
+           topo_find(ss->get_topo_info(glm::ivec3(3, 3, 3)))->size);
+
+    remove(TEST_SHIP_FILE);
+}
+
+
+void
+missing(void)
+{
+    assert(ship_space::load("does_not_exist.en", nullptr, 0) == nullptr);
+}
+
+
+static void
+write_file(char const *filename, std::vector<char> const & bytes, size_t len)
+{
+    FILE *f = fopen(filename, "wb");
+    assert(f);
+    fwrite(bytes.data(), 1, len, f);
+    fclose(f);
+}
+
+
+/* a damaged file is turned away, rather than read past its end */
+void
+corrupt(void)
+{
+    ship_space *ss = ship_space::mock_ship_space();
+    ss->rebuild_topology();
+    assert(ss->save(TEST_SHIP_FILE, nullptr));
+
+    std::vector<char> good;
+    FILE *f = fopen(TEST_SHIP_FILE, "rb");
+    assert(f);
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        good.insert(good.end(), buf, buf + n);
+    }
+    fclose(f);
+
+    auto h = (ship_file_header const *)good.data();
+    assert(h->num_chunks > 0);
+    assert(h->num_entities == 0);
+    auto chunk_dir = (ship_file_chunk const *)(good.data() + h->chunk_dir_offset);
+
+    /* the untouched file is fine */
+    write_file(TEST_SHIP_FILE, good, good.size());
+    assert(ship_space::load(TEST_SHIP_FILE, nullptr, 0));
+
+    /* cut off partway through the block payloads */
+    write_file(TEST_SHIP_FILE, good, (size_t)chunk_dir[h->num_chunks - 1].blocks_offset + 16);
+    assert(!ship_space::load(TEST_SHIP_FILE, nullptr, 0));
+
+    /* a table starting past the end */
+    auto bad = good;
+    ((ship_file_header *)bad.data())->zone_offset = bad.size() + 64;
+    write_file(TEST_SHIP_FILE, bad, bad.size());
+    assert(!ship_space::load(TEST_SHIP_FILE, nullptr, 0));
+
+    /* a block in a zone past the end of the zone table */
+    bad = good;
+    ((uint32_t *)(bad.data() + chunk_dir[0].zones_offset))[7] = h->num_zones;
+    write_file(TEST_SHIP_FILE, bad, bad.size());
+    assert(!ship_space::load(TEST_SHIP_FILE, nullptr, 0));
+
+    /* an entity attach naming an entity which isn't there. the padding
+     * after the wiring reads as entity 0 */
+    bad = good;
+    ((ship_file_header *)bad.data())->num_entity_attaches[0] = 1;
+    write_file(TEST_SHIP_FILE, bad, bad.size());
+    assert(!ship_space::load(TEST_SHIP_FILE, nullptr, 0));
+
+    /* a block with a type and a surface nothing knows. the file loads, and
+     * the block is emptied as its chunk pages in */
+    bad = good;
+    auto b = (block *)(bad.data() + chunk_dir[0].blocks_offset);
+    memset(&b->type, 0x7f, sizeof(b->type));
+    memset(&b->surfs[surface_zp], 0x13, 1);
+    write_file(TEST_SHIP_FILE, bad, bad.size());
+    ship_space *damaged = ship_space::load(TEST_SHIP_FILE, nullptr, 0);
+    assert(damaged);
+    auto p = glm::ivec3(chunk_dir[0].x, chunk_dir[0].y, chunk_dir[0].z) * CHUNK_SIZE;
+    assert(damaged->get_block(p)->type == block_empty);
+    assert(damaged->get_block(p)->surfs[surface_zp] == surface_none);
+
+    remove(TEST_SHIP_FILE);
+}
+
+
+static std::vector<glm::ivec3> spawned;
+
+static c_entity
+test_spawn(glm::ivec3 p, unsigned type, int face)
+{
+    assert(type == 5 && face == surface_zm);
+    spawned.push_back(p);
+    return c_entity::spawn();
+}
+
+static bool
+test_describe(c_entity ce, glm::ivec3 *p, unsigned *type, int *face)
+{
+    *p = glm::ivec3(3, 3, 1);
+    *type = 5;
+    *face = surface_zm;
+    return true;
+}
+
+
+/* entities go out through describe and come back through spawn, as long as
+ * their type is one the game has */
+void
+entities(void)
+{
+    ship_space *ss = ship_space::mock_ship_space();
+    ss->rebuild_topology();
+    ss->get_chunk_containing(glm::ivec3(3, 3, 1))->entities.push_back(c_entity::spawn());
+    assert(ss->save(TEST_SHIP_FILE, test_describe));
+
+    assert(!ship_space::load(TEST_SHIP_FILE, test_spawn, 5));
+    assert(spawned.empty());
+
+    ship_space *loaded = ship_space::load(TEST_SHIP_FILE, test_spawn, 6);
+    assert(loaded);
+    assert(spawned.size() == 1 && spawned[0] == glm::ivec3(3, 3, 1));
+    assert(loaded->get_chunk_containing(glm::ivec3(3, 3, 1))->entities.size() == 1);
+
+    /* nor does the type matter when nothing is spawned */
+    assert(ship_space::load(TEST_SHIP_FILE, nullptr, 0));
+
+    remove(TEST_SHIP_FILE);
+}
+
+
+int
+main(void)
+{
+    round_trip();
+    missing();
+    corrupt();
+    entities();
+}
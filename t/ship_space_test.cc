@@ -7,6 +7,7 @@ void
 simple(void)
 {
     block *b;
+    block const *cb;
     ship_space space;
 
     for (int i = 0; i < 2; i++) {
@@ -19,36 +20,114 @@ simple(void)
 
     assert( space.get_block(glm::ivec3(2*CHUNK_SIZE)) == 0 );
 
-    assert( space.get_block(glm::ivec3(0,0,0)) != space.get_block(glm::ivec3(0,0,1)) );
+    assert( space.edit_block(glm::ivec3(0,0,0)) != space.edit_block(glm::ivec3(0,0,1)) );
 
 
 
     /* write some data */
-    b = space.get_block(glm::ivec3(0, 0, 0));
+    b = space.edit_block(glm::ivec3(0, 0, 0));
     assert(b != 0);
     b->type = block_empty;
 
-    b = space.get_block(glm::ivec3(0, 0, 1));
+    b = space.edit_block(glm::ivec3(0, 0, 1));
     assert(b != 0);
     b->type = block_support;
 
-    b = space.get_block(glm::ivec3(0, 8, 0));
+    b = space.edit_block(glm::ivec3(0, 8, 0));
     assert(b != 0);
     b->type = block_support;
 
 
     /* read some data */
-    b = space.get_block(glm::ivec3(0, 0, 0));
-    assert(b != 0);
-    assert(b->type == block_empty);
+    cb = space.get_block(glm::ivec3(0, 0, 0));
+    assert(cb != 0);
+    assert(cb->type == block_empty);
 
-    b = space.get_block(glm::ivec3(0, 0, 1));
-    assert(b != 0);
-    assert(b->type == block_support);
+    cb = space.get_block(glm::ivec3(0, 0, 1));
+    assert(cb != 0);
+    assert(cb->type == block_support);
 
-    b = space.get_block(glm::ivec3(0, 8, 0));
-    assert(b != 0);
-    assert(b->type == block_support);
+    cb = space.get_block(glm::ivec3(0, 8, 0));
+    assert(cb != 0);
+    assert(cb->type == block_support);
+}
+
+
+/* empty chunks stay compressed until something is built in them */
+void
+compression(void)
+{
+    ship_space space;
+    chunk *ch = space.ensure_chunk(glm::ivec3(0, 0, 0));
+    chunk *other = space.ensure_chunk(glm::ivec3(1, 0, 0));
+
+    assert(ch->blocks.uniform());
+    assert(!ch->topo);
+    assert(ch->blocks.heap_size() == sizeof(block));
+    assert(space.get_topo_info(glm::ivec3(0, 0, 0)) == space.get_topo_info(glm::ivec3(7, 7, 7)));
+
+    /* reading leaves it alone */
+    assert(space.get_block(glm::ivec3(3, 3, 3))->type == block_empty);
+    assert(ch->blocks.uniform());
+
+    /* scaffolding doesn't divide the air, so the blocks expand but the topology doesn't */
+    space.ensure_block(glm::ivec3(7, 3, 3))->type = block_support;
+    assert(ch->blocks.full());
+    assert(!ch->topo);
+
+    /* a wall might */
+    space.set_surface(glm::ivec3(7, 3, 3), glm::ivec3(8, 3, 3), surface_xp, surface_wall);
+    assert(ch->topo);
+    assert(other->topo);
+    assert(other->blocks.full());
+    assert(topo_find(space.get_topo_info(glm::ivec3(7, 3, 3))) ==
+           topo_find(space.get_topo_info(glm::ivec3(8, 3, 3))));
+
+    /* squeezing it back down keeps what was written */
+    ch->blocks.compact();
+    assert(!ch->blocks.uniform() && !ch->blocks.full());
+    assert(ch->blocks.heap_size() < sizeof(chunk_blocks) / 4);
+    assert(space.get_block(glm::ivec3(7, 3, 3))->type == block_support);
+    assert(space.get_block(glm::ivec3(7, 3, 3))->surfs[surface_xp] == surface_wall);
+    assert(space.get_block(glm::ivec3(4, 3, 3))->type == block_empty);
+
+    space.rebuild_topology();
+    assert(space.validate());
+}
+
+/* a block read from a compressed chunk lives in its palette, which the
+ * chunk's first edit throws away. the tools copy what they need out of a
+ * block first, and look it up again after */
+void
+edit_while_held(void)
+{
+    ship_space space;
+    chunk *ch = space.ensure_chunk(glm::ivec3(0, 0, 0));
+    space.ensure_block(glm::ivec3(7, 3, 3))->type = block_support;
+    ch->blocks.compact();
+    assert(!ch->blocks.full());
+
+    /* as add_block_tool: the scaffold hit, and the empty block beside it */
+    block const *held = space.get_block(glm::ivec3(7, 3, 3));
+    auto held_type = held->type;
+    assert(held_type == block_support);
+
+    block *bl = space.ensure_block(glm::ivec3(6, 3, 3));
+    assert(ch->blocks.full());
+    assert(space.get_block(glm::ivec3(7, 3, 3)) != held);
+    bl->type = held_type;
+
+    assert(space.get_block(glm::ivec3(6, 3, 3))->type == block_support);
+    assert(space.get_block(glm::ivec3(7, 3, 3))->type == block_support);
+
+    /* and across set_surface, which edits both sides */
+    ch->blocks.compact();
+    held = space.get_block(glm::ivec3(7, 3, 3));
+    auto held_surf = held->surfs[surface_xm];
+    space.set_surface(glm::ivec3(7, 3, 3), glm::ivec3(6, 3, 3), surface_xm, surface_wall);
+    assert(held_surf == surface_none);
+    assert(space.get_block(glm::ivec3(7, 3, 3))->surfs[surface_xm] == surface_wall);
+    assert(space.get_block(glm::ivec3(6, 3, 3))->surfs[surface_xp] == surface_wall);
 }
 
 void
@@ -108,6 +187,46 @@ ensure(void)
 
 }
 
+/* missing chunks which can reach the edge of the ship's bounds are left
+ * missing; ones which are closed off get filled in */
+void
+enclosed(void)
+{
+    ship_space space;
+
+    /* a ring: the hole in the middle is open above and below */
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            if (i != 1 || j != 1)
+                space.ensure_chunk(glm::ivec3(i, j, 0));
+        }
+    }
+
+    assert(!space.has_chunk(glm::ivec3(1, 1, 0)));
+    assert(space.chunk_coords.size() == 8);
+
+    /* a hollow cube with one face missing is still open */
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            if (i != 1 || j != 1)
+                space.ensure_chunk(glm::ivec3(i, j, 1));
+            space.ensure_chunk(glm::ivec3(i, j, 2));
+        }
+    }
+
+    assert(!space.has_chunk(glm::ivec3(1, 1, 1)));
+    assert(space.chunk_coords.size() == 25);
+
+    /* plugging the bottom closes off the middle, and nothing else */
+    space.ensure_chunk(glm::ivec3(1, 1, 0));
+    assert(space.has_chunk(glm::ivec3(1, 1, 1)));
+    assert(space.get_chunk(glm::ivec3(1, 1, 1)));
+    assert(space.chunk_coords.size() == 27);
+
+    assert(space.mins == glm::ivec3(0, 0, 0));
+    assert(space.maxs == glm::ivec3(2, 2, 2));
+}
+
 /* some more quick and dirty 'testing'
  * mostly checking we compile and nothing
  * blows up obviously
@@ -117,4 +236,7 @@ main(void)
 {
     simple();
     ensure();
+    enclosed();
+    compression();
+    edit_while_held();
 }
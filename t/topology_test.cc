@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <unordered_map>
+#include <vector>
+#include "../src/common.h"
+#include "../src/ship_space.h"
+
+
+/* the mock rooms vent through their floor grates; seal the first one */
+static void
+seal_room(ship_space *ss)
+{
+    for (int x = 2; x < 6; x++) {
+        for (int y = 2; y < 6; y++) {
+            ss->set_surface(glm::ivec3(x, y, 0), glm::ivec3(x, y, 1), surface_zp, surface_wall);
+        }
+    }
+}
+
+
+/* wall off the first room down the middle, between x=3 and x=4 */
+static void
+divide_room(ship_space *ss)
+{
+    for (int y = 1; y < 7; y++) {
+        for (int z = 1; z < 7; z++) {
+            ss->set_surface(glm::ivec3(3, y, z), glm::ivec3(4, y, z), surface_xp, surface_wall);
+        }
+    }
+}
+
+
+/* the incrementally-maintained topology of a must carve space up exactly
+ * as a from-scratch rebuild of b does */
+static void
+check_same_topology(ship_space *a, ship_space *b)
+{
+    std::unordered_map<topo_info *, topo_info *> a_to_b, b_to_a;
+
+    for (auto it : a->chunks) {
+        for (int z = 0; z < CHUNK_SIZE; z++) {
+            for (int y = 0; y < CHUNK_SIZE; y++) {
+                for (int x = 0; x < CHUNK_SIZE; x++) {
+                    glm::ivec3 p = CHUNK_SIZE * it.first + glm::ivec3(x, y, z);
+                    topo_info *ra = topo_find(a->get_topo_info(p));
+                    topo_info *rb = topo_find(b->get_topo_info(p));
+
+                    assert(ra->size == rb->size);
+
+                    auto ab = a_to_b.insert(std::make_pair(ra, rb)).first;
+                    auto ba = b_to_a.insert(std::make_pair(rb, ra)).first;
+                    assert(ab->second == rb);
+                    assert(ba->second == ra);
+                }
+            }
+        }
+    }
+}
+
+
+static glm::ivec3 dirs[] = {
+    glm::ivec3(1, 0, 0),
+    glm::ivec3(-1, 0, 0),
+    glm::ivec3(0, 1, 0),
+    glm::ivec3(0, -1, 0),
+    glm::ivec3(0, 0, 1),
+    glm::ivec3(0, 0, -1),
+};
+
+
+static float
+air_at(ship_space *ss, glm::ivec3 p)
+{
+    zone_info *z = ss->get_zone_info(topo_find(ss->get_topo_info(p)));
+    return z ? z->air_amount : 0.0f;
+}
+
+
+/* closing off a room, then splitting it in two, must not need a full rebuild */
+void
+local_split(void)
+{
+    ship_space *ss = ship_space::mock_ship_space();
+    ss->rebuild_topology();
+    assert(ss->num_full_rebuilds == 1);
+
+    seal_room(ss);
+    assert(ss->num_full_rebuilds == 1);
+    assert(ss->num_fast_splits == 1);
+
+    ship_space *ref = ship_space::mock_ship_space();
+    seal_room(ref);
+    ref->rebuild_topology();
+    check_same_topology(ss, ref);
+
+    topo_info *room = topo_find(ss->get_topo_info(glm::ivec3(3, 3, 3)));
+    assert(room != topo_find(&ss->outside_topo_info));
+    ss->insert_zone(room, new zone_info(42.0f));
+
+    divide_room(ss);
+    assert(ss->num_full_rebuilds == 1);
+    assert(ss->num_fast_splits == 2);
+
+    divide_room(ref);
+    ref->rebuild_topology();
+    check_same_topology(ss, ref);
+
+    /* both halves are the same size, so the air is shared evenly */
+    assert(air_at(ss, glm::ivec3(2, 3, 3)) == 21.0f);
+    assert(air_at(ss, glm::ivec3(5, 3, 3)) == 21.0f);
+
+    /* and knocking a hole back through brings it together again */
+    ss->set_surface(glm::ivec3(3, 3, 3), glm::ivec3(4, 3, 3), surface_xp, surface_none);
+    assert(air_at(ss, glm::ivec3(2, 3, 3)) == 42.0f);
+    assert(ss->num_full_rebuilds == 1);
+}
+
+
+/* a ship big enough to spread the rebuild over several threads, riddled with
+ * random walls, must come out the same as a plain flood fill says it should */
+void
+threaded_rebuild(void)
+{
+    ship_space *ss = new ship_space;
+    for (int x = 0; x < 6; x++) {
+        for (int y = 0; y < 6; y++) {
+            for (int z = 0; z < 3; z++) {
+                ss->ensure_chunk(glm::ivec3(x, y, z));
+            }
+        }
+    }
+
+    srand(1234);
+    glm::ivec3 lo = CHUNK_SIZE * ss->mins;
+    glm::ivec3 hi = CHUNK_SIZE * (ss->maxs + glm::ivec3(1, 1, 1));
+    for (int x = lo.x; x < hi.x; x++) {
+        for (int y = lo.y; y < hi.y; y++) {
+            for (int z = lo.z; z < hi.z; z++) {
+                glm::ivec3 p(x, y, z);
+                for (int i = 0; i < 6; i += 2) {
+                    block *other = ss->edit_block(p + dirs[i]);
+                    if (other && rand() % 3 != 0) {
+                        ss->edit_block(p)->surfs[i] = surface_wall;
+                        other->surfs[i ^ 1] = surface_wall;
+                    }
+                }
+            }
+        }
+    }
+
+    /* the walls went straight into the blocks */
+    for (auto ch : ss->chunks) {
+        ch.second->refresh_faces();
+    }
+
+    ss->rebuild_topology();
+
+    /* label every block with a flood fill; -1 is the outside */
+    std::unordered_map<glm::ivec3, int, ivec3_hash> label;
+    std::vector<int> sizes;
+    for (int x = lo.x; x < hi.x; x++) {
+        for (int y = lo.y; y < hi.y; y++) {
+            for (int z = lo.z; z < hi.z; z++) {
+                glm::ivec3 start(x, y, z);
+                if (label.find(start) != label.end()) {
+                    continue;
+                }
+
+                int l = (int)sizes.size();
+                bool outside = false;
+                std::vector<glm::ivec3> queue(1, start);
+                label[start] = l;
+
+                for (size_t head = 0; head < queue.size(); head++) {
+                    glm::ivec3 p = queue[head];
+                    for (int i = 0; i < 6; i++) {
+                        if (ss->get_block(p)->surfs[i] != surface_none) {
+                            continue;
+                        }
+
+                        glm::ivec3 q = p + dirs[i];
+                        if (!ss->get_block(q)) {
+                            outside = true;
+                        }
+                        else if (label.find(q) == label.end()) {
+                            label[q] = l;
+                            queue.push_back(q);
+                        }
+                    }
+                }
+
+                sizes.push_back((int)queue.size());
+                if (outside) {
+                    for (auto q : queue) {
+                        label[q] = -1;
+                    }
+                }
+            }
+        }
+    }
+
+    std::unordered_map<topo_info *, int> root_to_label;
+    std::unordered_map<int, topo_info *> label_to_root;
+    for (auto it : label) {
+        topo_info *t = ss->get_topo_info(it.first);
+        topo_info *r = topo_find(t);
+
+        /* every block links straight to its root */
+        assert(t->p == r);
+
+        if (it.second == -1) {
+            assert(r == &ss->outside_topo_info);
+        }
+        else {
+            assert(r->size == sizes[it.second]);
+        }
+
+        auto rl = root_to_label.insert(std::make_pair(r, it.second)).first;
+        auto lr = label_to_root.insert(std::make_pair(it.second, r)).first;
+        assert(rl->second == it.second);
+        assert(lr->second == r);
+    }
+
+    /* there should be plenty of enclosed pockets, or this didn't test much */
+    assert(label_to_root.size() > 100);
+}
+
+
+int
+main(void)
+{
+    local_split();
+    threaded_rebuild();
+}
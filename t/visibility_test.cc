@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <assert.h>
+#include "../src/common.h"
+#include "../src/ship_space.h"
+#include "../src/visibility.h"
+
+
+/* a GL-style perspective projection looking down -z, 90 degrees each way,
+ * near 1, far 100 */
+static glm::mat4
+test_projection(void)
+{
+    glm::mat4 m;
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            m[i][j] = 0;
+        }
+    }
+
+    m[0][0] = 1;
+    m[1][1] = 1;
+    m[2][2] = -101.0f / 99.0f;
+    m[2][3] = -1;
+    m[3][2] = -200.0f / 99.0f;
+    return m;
+}
+
+
+/* a frustum with every plane facing everything: nothing is outside it */
+static frustum
+everything(void)
+{
+    frustum f;
+    for (auto & p : f.planes) {
+        p = glm::vec4(0, 0, 0, 1);
+    }
+    return f;
+}
+
+
+void
+frustum_planes(void)
+{
+    frustum f(test_projection());
+
+    /* straight ahead, between the near and far planes */
+    assert(f.intersects_box(glm::vec3(-1, -1, -11), glm::vec3(1, 1, -9)));
+    assert(f.intersects_sphere(glm::vec3(0, 0, -50), 1));
+
+    /* behind the camera */
+    assert(!f.intersects_box(glm::vec3(-1, -1, 9), glm::vec3(1, 1, 11)));
+    assert(!f.intersects_sphere(glm::vec3(0, 0, 10), 1));
+
+    /* off to the side, and beyond the far plane */
+    assert(!f.intersects_box(glm::vec3(20, -1, -11), glm::vec3(22, 1, -9)));
+    assert(!f.intersects_sphere(glm::vec3(0, 0, -150), 1));
+
+    /* straddling a side plane */
+    assert(f.intersects_box(glm::vec3(5, -1, -11), glm::vec3(15, 1, -9)));
+    assert(f.intersects_sphere(glm::vec3(12, 0, -10), 3));
+}
+
+
+/* as the mesher sees the chunk */
+static uint8_t
+opaque_faces_of(chunk *ch)
+{
+    static chunk_blocks blocks;
+    ch->blocks.store(&blocks.contents[0][0][0]);
+    return chunk_opaque_faces(&blocks);
+}
+
+
+static void
+wall_off(ship_space *ss, glm::ivec3 c, int face)
+{
+    chunk *ch = ss->get_chunk(c);
+    int axis = face / 2;
+    int slice = (face & 1) ? 0 : CHUNK_SIZE - 1;
+
+    for (int u = 0; u < CHUNK_SIZE; u++) {
+        for (int v = 0; v < CHUNK_SIZE; v++) {
+            glm::ivec3 p;
+            p[axis] = slice;
+            p[(axis + 1) % 3] = u;
+            p[(axis + 2) % 3] = v;
+            ch->set_surface(p.x, p.y, p.z, face, surface_wall);
+        }
+    }
+
+    /* normally done when the chunk is remeshed */
+    ch->render_chunk.opaque_faces = opaque_faces_of(ch);
+}
+
+
+void
+opaque_faces(void)
+{
+    ship_space *ss = new ship_space();
+    chunk *ch = ss->ensure_chunk(glm::ivec3(0, 0, 0));
+    assert(opaque_faces_of(ch) == 0);
+
+    wall_off(ss, glm::ivec3(0, 0, 0), surface_yp);
+    assert(opaque_faces_of(ch) == 1 << surface_yp);
+
+    /* one hole is enough to see through */
+    ch->set_surface(3, CHUNK_SIZE - 1, 5, surface_yp, surface_glass);
+    assert(opaque_faces_of(ch) == 0);
+}
+
+
+/* walls on chunk boundaries hide what is behind them, and the walk from the
+ * camera does not bend back around them */
+void
+occlusion(void)
+{
+    ship_space *ss = new ship_space();
+    for (int x = 0; x < 3; x++) {
+        for (int y = 0; y < 2; y++) {
+            ss->ensure_chunk(glm::ivec3(x, y, 0));
+        }
+    }
+
+    frustum f = everything();
+    glm::vec3 eye(4, 4, 4);     /* in chunk 0,0,0 */
+    chunk_visibility vis;
+
+    vis.compute(ss, f, eye);
+    assert(vis.num_visible == 6);
+
+    /* a bulkhead between 0,0 and 1,0 */
+    wall_off(ss, glm::ivec3(0, 0, 0), surface_xp);
+    vis.compute(ss, f, eye);
+    assert(vis.chunk_visible(glm::ivec3(0, 0, 0)));
+    assert(vis.chunk_visible(glm::ivec3(0, 1, 0)));
+    assert(vis.chunk_visible(glm::ivec3(1, 1, 0)));
+    assert(vis.chunk_visible(glm::ivec3(2, 1, 0)));
+
+    /* only reachable by going +y and then back -y */
+    assert(!vis.chunk_visible(glm::ivec3(1, 0, 0)));
+    assert(!vis.chunk_visible(glm::ivec3(2, 0, 0)));
+    assert(vis.num_visible == 4);
+
+    /* entities follow the chunks they are in */
+    assert(vis.sphere_visible(f, glm::vec3(12, 12, 4), 1));
+    assert(!vis.sphere_visible(f, glm::vec3(12, 4, 4), 1));
+    /* ... or any visible chunk they reach into */
+    assert(vis.sphere_visible(f, glm::vec3(12, 7.5f, 4), 1));
+
+    /* from outside the ship, nothing is hidden behind walls */
+    vis.compute(ss, f, glm::vec3(-20, 4, 4));
+    assert(vis.num_visible == 6);
+
+    /* but the frustum still culls */
+    vis.compute(ss, frustum(test_projection()), glm::vec3(-20, 4, 4));
+    assert(vis.num_visible == 0);
+}
+
+
+int
+main(void)
+{
+    frustum_planes();
+    opaque_faces();
+    occlusion();
+}
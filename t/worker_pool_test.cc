@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <assert.h>
+#include <atomic>
+#include "../src/worker_pool.h"
+
+
+/* every job runs once, and its completion runs on the thread which asked for it */
+void
+jobs_and_completions(void)
+{
+    worker_pool pool(4);
+    std::atomic<int> ran(0);
+    int completed = 0;
+    std::thread::id main_thread = std::this_thread::get_id();
+
+    for (int i = 0; i < 1000; i++) {
+        pool.submit(
+            [&ran]() { ran++; },
+            [&completed, main_thread]() {
+                assert(std::this_thread::get_id() == main_thread);
+                completed++;
+            });
+    }
+
+    pool.wait();
+    assert(ran == 1000);
+    assert(completed == 1000);
+
+    /* nothing left over */
+    pool.run_completions();
+    assert(completed == 1000);
+}
+
+
+/* a completion may queue more work */
+void
+chained(void)
+{
+    worker_pool pool(2);
+    int stage = 0;
+
+    pool.submit([]() {}, [&pool, &stage]() {
+        stage = 1;
+        pool.submit([]() {}, [&stage]() { stage = 2; });
+    });
+
+    pool.wait();
+    assert(stage == 1);
+    pool.wait();
+    assert(stage == 2);
+}
+
+
+/* jobs without completions still count towards wait() */
+void
+no_completion(void)
+{
+    std::atomic<int> ran(0);
+    {
+        worker_pool pool(3);
+        for (int i = 0; i < 100; i++) {
+            pool.submit([&ran]() { ran++; });
+        }
+        pool.wait();
+        assert(ran == 100);
+    }
+}
+
+
+int
+main(void)
+{
+    jobs_and_completions();
+    chained();
+    no_completion();
+}
@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+#include "../src/mesh.h"
+
+
+/* positions must survive packing to within the fixed-point step, over the
+ * whole of a chunk */
+void
+positions(void)
+{
+    assert(sizeof(world_vertex) == 12);
+
+    for (float p = 0; p <= 8.0f; p += 0.1f) {
+        world_vertex w(vertex(p, 8.0f - p, p * 0.5f, 0, 0, 1, 0));
+        assert(fabsf(w.x / WORLD_VERTEX_SCALE - p) <= 0.5f / WORLD_VERTEX_SCALE);
+        assert(fabsf(w.y / WORLD_VERTEX_SCALE - (8.0f - p)) <= 0.5f / WORLD_VERTEX_SCALE);
+        assert(fabsf(w.z / WORLD_VERTEX_SCALE - p * 0.5f) <= 0.5f / WORLD_VERTEX_SCALE);
+    }
+
+    /* the corners blocks share must pack identically, or the mesh will crack */
+    world_vertex a(vertex(3.0f, 0, 0, 0, 0, 1, 0));
+    world_vertex b(vertex(2.0f + 1.0f, 0, 0, 0, 0, 1, 0));
+    assert(a.x == b.x);
+}
+
+
+void
+normals_and_material(void)
+{
+    world_vertex w(vertex(0, 0, 0, 0.7071068f, -0.7071068f, 0, 16));
+    assert(w.nx == 90 && w.ny == -90 && w.nz == 0);
+    assert(w.mat == 16);
+
+    world_vertex axis(vertex(0, 0, 0, 0, 0, -1, 2));
+    assert(axis.nx == 0 && axis.ny == 0 && axis.nz == -127);
+}
+
+
+int
+main(void)
+{
+    positions();
+    normals_and_material();
+}